@@ -0,0 +1,561 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "AMBE2AMBE.h"
+
+#include "AMBEFileWriter.h"
+#include "BatchScheduler.h"
+#include "JitterBuffer.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Utils.h"
+#include "Version.h"
+
+#include <thread>
+
+#include <cassert>
+#include <cstring>
+
+// The decoded audio waiting to be encoded, one second of it
+const unsigned int AUDIO_BUFFER_BLOCKS = 50U;
+
+#if defined(_WIN32) || defined(_WIN64)
+char* optarg = NULL;
+int optind = 1;
+
+int getopt(int argc, char* const argv[], const char* optstring)
+{
+	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][1] == 0))
+		return -1;
+
+	int opt = argv[optind][1];
+	const char *p = strchr(optstring, opt);
+
+	if (p == NULL) {
+		return '?';
+	}
+
+	if (p[1] == ':') {
+		optind++;
+		if (optind >= argc)
+			return '?';
+
+		optarg = argv[optind];
+	}
+
+	optind++;
+
+	return opt;
+}
+#else
+#include <unistd.h>
+#endif
+
+static AMBE_MODE getMode(const char* text)
+{
+	if (::strcmp(text, "dstar") == 0)
+		return MODE_DSTAR;
+	else if (::strcmp(text, "dmr") == 0)
+		return MODE_DMR;
+	else if (::strcmp(text, "p25") == 0)
+		return MODE_P25;
+	else if (::strcmp(text, "nxdn") == 0)
+		return MODE_DMR;
+	else if (::strcmp(text, "m17-3200") == 0)
+		return MODE_M17_3200;
+	else if (::strcmp(text, "m17-1600") == 0)
+		return MODE_M17_1600;
+	else
+		return MODE_UNKNOWN;
+}
+
+int main(int argc, char** argv)
+{
+	float amplitude = 1.0F;
+	std::string inSignature;
+	std::string outSignature;
+	AMBE_MODE inMode = MODE_DSTAR;
+	AMBE_MODE outMode = MODE_UNKNOWN;
+	bool inFEC = true;
+	bool outFEC = true;
+	bool container = false;
+	bool append = false;
+	std::string inPort = "/dev/ttyUSB0";
+	std::string outPort;
+	unsigned int speed = 460800U;
+	bool reset = false;
+	bool debug = false;
+	bool paced = false;
+	bool live = false;
+	bool batch = false;
+	unsigned int jobs = 0U;
+	bool metrics = false;
+	std::string metricsLog;
+	std::string trace;
+
+	int c;
+	while ((c = ::getopt(argc, argv, "Aa:bCD:dF:f:G:g:j:L:lM:m:P:p:RrSs:v")) != -1) {
+		switch (c) {
+		case 'A':
+			container = true;
+			append = true;
+			break;
+		case 'a':
+			amplitude = float(::atof(optarg));
+			break;
+		case 'b':
+			batch = true;
+			break;
+		case 'C':
+			container = true;
+			break;
+		case 'D':
+			trace = std::string(optarg);
+			break;
+		case 'd':
+			debug = true;
+			break;
+		case 'F':
+			outFEC = ::atoi(optarg) != 0;
+			break;
+		case 'f':
+			inFEC = ::atoi(optarg) != 0;
+			break;
+		case 'G':
+			outSignature = std::string(optarg);
+			break;
+		case 'g':
+			inSignature = std::string(optarg);
+			break;
+		case 'j':
+			jobs = (unsigned int)::atoi(optarg);
+			break;
+		case 'L':
+			metricsLog = std::string(optarg);
+			break;
+		case 'M':
+			outMode = getMode(optarg);
+			break;
+		case 'm':
+			inMode = getMode(optarg);
+			break;
+		case 'P':
+			outPort = std::string(optarg);
+			break;
+		case 'p':
+			inPort = std::string(optarg);
+			break;
+		case 'l':
+			paced = true;
+			live = true;
+			break;
+		case 'R':
+			paced = true;
+			break;
+		case 'r':
+			reset = true;
+			break;
+		case 'S':
+			metrics = true;
+			break;
+		case 's':
+			speed = (unsigned int)::atoi(optarg);
+			break;
+		case 'v':
+			printf("Version: %s\n", version);
+			return 0;
+		case '?':
+			break;
+		default:
+			fprintf(stderr, "Usage: AMBE2AMBE [-v] [-a amplitude] [-C|-A] [-b] [-j <jobs>] [-g <signature>] [-m <mode>] [-f 0|1] [-p <port>] [-G <signature>] -M <mode> [-F 0|1] [-P <port>] [-s <speed>] [-R] [-l] [-r] [-S] [-L <file>] [-D <file>] [-d] <input> <output>\n");
+			break;
+		}
+	}
+
+	if (optind > (argc - 2)) {
+		fprintf(stderr, "Usage: AMBE2AMBE [-v] [-a amplitude] [-C|-A] [-b] [-j <jobs>] [-g <signature>] [-m <mode>] [-f 0|1] [-p <port>] [-G <signature>] -M <mode> [-F 0|1] [-P <port>] [-s <speed>] [-R] [-l] [-r] [-S] [-L <file>] [-D <file>] [-d] <input> <output>\n");
+		return 1;
+	}
+
+	if (inMode == MODE_UNKNOWN || outMode == MODE_UNKNOWN) {
+		::fprintf(stderr, "AMBE2AMBE: unknown mode specified\n");
+		return 1;
+	}
+
+	if (outPort.empty())
+		outPort = inPort;
+
+	// Each AMBE chip can only be set up for one mode
+	if (CVocoder::usesHardware(inMode) && CVocoder::usesHardware(outMode) && inPort == outPort) {
+		::fprintf(stderr, "AMBE2AMBE: both modes need an AMBE chip, use -P to give a second one\n");
+		return 1;
+	}
+
+	if (batch && paced) {
+		::fprintf(stderr, "AMBE2AMBE: real time mode can't be used in batch mode\n");
+		return 1;
+	}
+
+	if (metrics)
+		CMetrics::enable();
+
+	if (!metricsLog.empty() && !CMetrics::startLog(metricsLog, METRICS_LOG_INTERVAL_MS))
+		return 1;
+
+	if (!trace.empty() && !CTrace::open(trace)) {
+		CMetrics::finish();
+		return 1;
+	}
+
+	if (batch) {
+		// The hardware vocoders can only do one conversion at a time
+		std::string device;
+		if (CVocoder::usesHardware(inMode))
+			device = inPort;
+		if (CVocoder::usesHardware(outMode))
+			device += device.empty() ? outPort : "+" + outPort;
+
+		CBatchScheduler scheduler(jobs);
+		if (!scheduler.add(std::string(argv[argc - 2]), "", std::string(argv[argc - 1]), ".ambe", device)) {
+			CTrace::close();
+			CMetrics::finish();
+			return 1;
+		}
+
+		unsigned int failed = scheduler.run([&](const std::string& input, const std::string& output) {
+			CAMBE2AMBE ambe2ambe(inSignature, inMode, inFEC, inPort, outSignature, outMode, outFEC, outPort, container, append, speed, amplitude, paced, live, reset, debug, input, output);
+			return ambe2ambe.run();
+		});
+
+		CTrace::close();
+		CMetrics::finish();
+
+		return (failed > 0U) ? 1 : 0;
+	}
+
+	CAMBE2AMBE* ambe2ambe = new CAMBE2AMBE(inSignature, inMode, inFEC, inPort, outSignature, outMode, outFEC, outPort, container, append, speed, amplitude, paced, live, reset, debug, std::string(argv[argc - 2]), std::string(argv[argc - 1]));
+
+	int ret = ambe2ambe->run();
+
+	delete ambe2ambe;
+
+	CTrace::close();
+	CMetrics::finish();
+
+	return ret;
+}
+
+CAMBE2AMBE::CAMBE2AMBE(const std::string& inSignature, AMBE_MODE inMode, bool inFEC, const std::string& inPort, const std::string& outSignature, AMBE_MODE outMode, bool outFEC, const std::string& outPort, bool container, bool append, unsigned int speed, float amplitude, bool paced, bool live, bool reset, bool debug, const std::string& input, const std::string& output) :
+m_inSignature(inSignature),
+m_inMode(inMode),
+m_inFEC(inFEC),
+m_inPort(inPort),
+m_outSignature(outSignature),
+m_outMode(outMode),
+m_outFEC(outFEC),
+m_outPort(outPort),
+m_container(container),
+m_append(append),
+m_speed(speed),
+m_amplitude(amplitude),
+m_paced(paced),
+m_live(live),
+m_reset(reset),
+m_debug(debug),
+m_input(input),
+m_output(output),
+m_audio(NULL),
+m_mutex(),
+m_cond(),
+m_decoded(false),
+m_stop(false),
+m_failed(false)
+{
+}
+
+CAMBE2AMBE::~CAMBE2AMBE()
+{
+	delete m_audio;
+}
+
+int CAMBE2AMBE::run()
+{
+	CAMBEFileReader reader(m_input, m_inSignature);
+	bool ret = reader.open();
+	if (!ret)
+		return 1;
+
+	AMBE_MODE inMode = m_inMode;
+	bool inFEC = m_inFEC;
+	unsigned int inFrameSize = 0U;
+
+	// A container describes its own frames
+	if (reader.isContainer()) {
+		if (reader.getCallCount() == 0U) {
+			::fprintf(stderr, "AMBE2AMBE: the input has no calls\n");
+			reader.close();
+			return 1;
+		}
+
+		const CAMBESegment& segment = reader.getCall(0U);
+		inMode      = AMBE_MODE(segment.m_mode);
+		inFEC       = segment.m_fec;
+		inFrameSize = segment.m_frameSize;
+	} else if (reader.isDVTOOL()) {
+		// Which only ever holds D-Star
+		inMode = MODE_DSTAR;
+		inFEC  = true;
+	}
+
+	if (CVocoder::usesHardware(inMode) && CVocoder::usesHardware(m_outMode) && m_inPort == m_outPort) {
+		::fprintf(stderr, "AMBE2AMBE: both modes need an AMBE chip, use -P to give a second one\n");
+		reader.close();
+		return 1;
+	}
+
+	CAMBEFileWriter writer(m_output, m_outSignature);
+	if (m_container)
+		writer.setContainer(m_outMode, m_outFEC, (m_outMode == MODE_M17_1600) ? 40U : 20U, m_append);
+
+	ret = writer.open();
+	if (!ret) {
+		reader.close();
+		return 1;
+	}
+
+	CVocoder* decoder = CVocoder::create(inMode, inFEC, m_inPort, m_speed, m_reset, m_debug);
+	assert(decoder != NULL);
+
+	if (inFrameSize > 0U && inFrameSize != decoder->getFrameLength()) {
+		::fprintf(stderr, "AMBE2AMBE: the container has %u byte frames but the mode has %u\n", inFrameSize, decoder->getFrameLength());
+		delete decoder;
+		writer.close();
+		reader.close();
+		return 1;
+	}
+
+	CVocoder* encoder = CVocoder::create(m_outMode, m_outFEC, m_outPort, m_speed, m_reset, m_debug);
+	assert(encoder != NULL);
+
+	ret = decoder->open();
+	if (ret) {
+		ret = encoder->open();
+		if (!ret)
+			decoder->close();
+	}
+
+	if (!ret) {
+		delete encoder;
+		delete decoder;
+		writer.close();
+		reader.close();
+		return 1;
+	}
+
+	if (m_audio == NULL)
+		m_audio = new CRingBuffer<int16_t>(AUDIO_BUFFER_BLOCKS * AUDIO_BLOCK_SIZE);
+
+	m_audio->clear();
+
+	m_decoded = false;
+	m_stop    = false;
+	m_failed  = false;
+
+	// In real time the frames are taken from the input as they arrive, and
+	// the output is kept to the real rate
+	CJitterBuffer* jitter = NULL;
+	if (m_paced) {
+		jitter = new CJitterBuffer(&reader, decoder->getFrameLength(), decoder->getFrameBlocks() * 20U, m_live);
+		jitter->start();
+	}
+
+	// The frames are decoded on a separate thread while the audio before them is encoded here
+	std::thread thread(&CAMBE2AMBE::decoder, this, &reader, jitter, decoder);
+
+	unsigned int frameLength = encoder->getFrameLength();
+
+	unsigned int count = 0U;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this] { return m_decoded || m_audio->dataSize() >= AUDIO_BLOCK_SIZE; });
+		}
+
+		// The decoder only ever adds whole blocks
+		int16_t audio[AUDIO_BLOCK_SIZE];
+		if (m_audio->getData(audio, AUDIO_BLOCK_SIZE) < AUDIO_BLOCK_SIZE)
+			break;
+
+		notify();
+
+		CTrace::event(TRACE_AUDIO_IN, (uint8_t*)audio, AUDIO_BLOCK_SIZE * sizeof(int16_t));
+
+		uint64_t start = CMetrics::start();
+
+		uint8_t frame[VOCODER_MAX_FRAME_LENGTH];
+		ENCODE_RESULT result = encoder->encode(audio, frame);
+
+		CMetrics::stop(STAGE_VOCODER, start);
+
+		if (result == ENCODE_ERROR) {
+			::fprintf(stderr, "AMBE2AMBE: unable to encode block %u\n", count);
+			m_failed = true;
+			break;
+		}
+
+		if (result == ENCODE_FRAME) {
+			CTrace::event(TRACE_FRAME_OUT, frame, frameLength);
+
+			start = CMetrics::start();
+
+			if (writer.write(frame, frameLength) != frameLength) {
+				::fprintf(stderr, "AMBE2AMBE: could not write to %s\n", m_output.c_str());
+				m_failed = true;
+				break;
+			}
+
+			CMetrics::stop(STAGE_WRITE, start);
+			CMetrics::add(COUNTER_FRAMES_OUT);
+		}
+
+		count++;
+	}
+
+	m_stop = true;
+	notify();
+
+	thread.join();
+
+	printf("Transcoding: %u frames (%.2fs)\n", count, float(count) / 50.0F);
+
+	if (jitter != NULL) {
+		jitter->stop();
+		jitter->printStats();
+		delete jitter;
+	}
+
+	encoder->close();
+	decoder->close();
+	delete encoder;
+	delete decoder;
+
+	writer.close();
+	reader.close();
+
+	return m_failed ? 1 : 0;
+}
+
+// With a jitter buffer the frames come from it, and silence is encoded when it has none
+void CAMBE2AMBE::decoder(CAMBEFileReader* reader, CJitterBuffer* jitter, CVocoder* vocoder)
+{
+	assert(reader != NULL);
+	assert(vocoder != NULL);
+
+	unsigned int frameLength = vocoder->getFrameLength();
+	unsigned int samples     = vocoder->getFrameBlocks() * AUDIO_BLOCK_SIZE;
+
+	unsigned int count = 0U;
+
+	while (!m_stop) {
+		uint8_t frame[VOCODER_MAX_FRAME_LENGTH];
+		JITTER_FRAME type = JITTER_FRAME_OK;
+
+		if (jitter != NULL) {
+			type = jitter->get(frame);
+			if (type == JITTER_END)
+				break;
+			if (type == JITTER_WAIT)
+				continue;
+		} else {
+			uint64_t start = CMetrics::start();
+
+			if (reader->read(frame, frameLength) != frameLength)
+				break;
+
+			CMetrics::stop(STAGE_READ, start);
+			CMetrics::add(COUNTER_FRAMES_IN);
+		}
+
+		int16_t audio[VOCODER_MAX_FRAME_BLOCKS * AUDIO_BLOCK_SIZE];
+
+		if (type != JITTER_SILENCE) {
+			CTrace::event(TRACE_FRAME_IN, frame, frameLength);
+
+			uint64_t start = CMetrics::start();
+
+			// In real time the gap is filled rather than stopping, but it is still an error
+			if (!vocoder->decode(frame, audio)) {
+				::fprintf(stderr, "AMBE2AMBE: unable to decode frame %u\n", count);
+				m_failed = true;
+
+				if (jitter == NULL)
+					break;
+
+				type = JITTER_SILENCE;
+			}
+
+			CMetrics::stop(STAGE_VOCODER, start);
+		}
+
+		count++;
+
+		if (type == JITTER_SILENCE)
+			::memset(audio, 0x00, samples * sizeof(int16_t));
+
+		if (m_amplitude != 1.0F) {
+			for (unsigned int i = 0U; i < samples; i++) {
+				float sample = float(audio[i]) * m_amplitude;
+				if (sample > 32767.0F)
+					sample = 32767.0F;
+				else if (sample < -32768.0F)
+					sample = -32768.0F;
+
+				audio[i] = int16_t((sample < 0.0F) ? sample - 0.5F : sample + 0.5F);
+			}
+		}
+
+		CTrace::event(TRACE_AUDIO_OUT, (uint8_t*)audio, samples * sizeof(int16_t));
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this, samples] { return m_stop || m_audio->freeSpace() >= samples; });
+		}
+
+		if (m_stop)
+			break;
+
+		m_audio->addData(audio, samples);
+
+		notify();
+	}
+
+	m_decoded = true;
+	notify();
+}
+
+// Taking the lock, even briefly, means that a notification can't be lost
+// between the other thread testing its condition and starting to wait
+void CAMBE2AMBE::notify()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+
+	m_cond.notify_all();
+}
@@ -0,0 +1,70 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(AMBE2AMBE_H)
+#define	AMBE2AMBE_H
+
+#include "AMBEFileReader.h"
+#include "JitterBuffer.h"
+#include "RingBuffer.h"
+#include "Vocoder.h"
+
+#include <condition_variable>
+#include <atomic>
+#include <string>
+#include <mutex>
+
+class CAMBE2AMBE
+{
+public:
+	CAMBE2AMBE(const std::string& inSignature, AMBE_MODE inMode, bool inFEC, const std::string& inPort, const std::string& outSignature, AMBE_MODE outMode, bool outFEC, const std::string& outPort, bool container, bool append, unsigned int speed, float amplitude, bool paced, bool live, bool reset, bool debug, const std::string& input, const std::string& output);
+	~CAMBE2AMBE();
+
+	int run();
+
+private:
+	std::string  m_inSignature;
+	AMBE_MODE    m_inMode;
+	bool         m_inFEC;
+	std::string  m_inPort;
+	std::string  m_outSignature;
+	AMBE_MODE    m_outMode;
+	bool         m_outFEC;
+	std::string  m_outPort;
+	bool         m_container;
+	bool         m_append;
+	unsigned int m_speed;
+	float        m_amplitude;
+	bool         m_paced;
+	bool         m_live;
+	bool         m_reset;
+	bool         m_debug;
+	std::string  m_input;
+	std::string  m_output;
+	CRingBuffer<int16_t>*   m_audio;
+	std::mutex              m_mutex;
+	std::condition_variable m_cond;
+	std::atomic<bool>       m_decoded;
+	std::atomic<bool>       m_stop;
+	std::atomic<bool>       m_failed;
+
+	void decoder(CAMBEFileReader* reader, CJitterBuffer* jitter, CVocoder* vocoder);
+	void notify();
+};
+
+#endif
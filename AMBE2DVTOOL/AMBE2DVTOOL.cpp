@@ -18,6 +18,7 @@
 
 #include "AMBE2DVTOOL.h"
 
+#include "Vocoder.h"
 #include "DVTOOLFileWriter.h"
 #include "AMBEFileReader.h"
 #include "Version.h"
@@ -27,13 +28,16 @@
 // The length of the D-Star AMBE audio in one 20ms frame, including FEC
 const unsigned int BUFFER_LENGTH = 9U;
 
+// The number of frames read at a time when the input isn't mapped
+const unsigned int READ_FRAMES = 1024U;
+
 #if defined(_WIN32) || defined(_WIN64)
 char* optarg = NULL;
 int optind = 1;
 
 int getopt(int argc, char* const argv[], const char* optstring)
 {
-	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][0] == 0))
+	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][1] == 0))
 		return -1;
 
 	int opt = argv[optind][1];
@@ -117,20 +121,51 @@ int CAMBE2DVTOOL::run()
 	if (!ret)
 		return 1;
 
+	if (reader.isContainer() && (reader.getCallCount() == 0U || reader.getCall(0U).m_mode != MODE_DSTAR || !reader.getCall(0U).m_fec)) {
+		::fprintf(stderr, "AMBE2DVTOOL: the container doesn't hold D-Star AMBE with FEC\n");
+		reader.close();
+		return 1;
+	}
+
+	// Knowing the length up front means that the output doesn't need to be
+	// seekable, the last frame may be a partial one
+	unsigned int frames = 0U;
+	if (reader.isMapped())
+		frames = (unsigned int)((reader.frames(1U) + BUFFER_LENGTH - 1U) / BUFFER_LENGTH);
+
 	CDVTOOLFileWriter writer(m_output);
-	ret = writer.open();
+	ret = writer.open(frames);
 	if (!ret) {
 		reader.close();
 		return 1;
 	}
 
-	uint8_t buffer[BUFFER_LENGTH];
-	unsigned int n = reader.read(buffer, BUFFER_LENGTH);
-
-	while (n > 0U) {
-		writer.write(buffer, n);
+	if (reader.isMapped() && !reader.isContainer()) {
+		// Straight from the mapping, followed by any partial last frame
+		uint64_t whole = reader.frames(BUFFER_LENGTH);
+		if (whole > 0U)
+			writer.write(reader.frame(BUFFER_LENGTH, 0U), BUFFER_LENGTH, (unsigned int)whole);
+
+		unsigned int left = (unsigned int)(reader.frames(1U) - whole * BUFFER_LENGTH);
+		if (left > 0U)
+			writer.write(reader.frame(1U, whole * BUFFER_LENGTH), left);
+	} else {
+		uint8_t* buffer = new uint8_t[READ_FRAMES * BUFFER_LENGTH];
+
+		unsigned int n = reader.read(buffer, READ_FRAMES * BUFFER_LENGTH);
+		while (n > 0U) {
+			unsigned int whole = n / BUFFER_LENGTH;
+			if (whole > 0U)
+				writer.write(buffer, BUFFER_LENGTH, whole);
+
+			unsigned int left = n % BUFFER_LENGTH;
+			if (left > 0U)
+				writer.write(buffer + whole * BUFFER_LENGTH, left);
+
+			n = reader.read(buffer, READ_FRAMES * BUFFER_LENGTH);
+		}
 
-		n = reader.read(buffer, BUFFER_LENGTH);
+		delete[] buffer;
 	}
 
 	writer.close();
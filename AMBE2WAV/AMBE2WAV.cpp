@@ -20,29 +20,23 @@
 
 #include "AMBEFileReader.h"
 #include "WAVFileWriter.h"
-#include "Version.h"
+#include "BatchScheduler.h"
+#include "JitterBuffer.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "Utils.h"
-#if !defined(HAVE_USB3000_P25)
-#include "imbe_vocoder.h"
-#include "IMBEFEC.h"
-#endif
-#include "codec2/codec2.h"
+#include "Version.h"
 
+#include <cassert>
 #include <cstring>
 
-const uint8_t  BIT_MASK_TABLE8[]  = { 0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02U, 0x01U };
-
-#define WRITE_BIT8(p,i,b)   p[(i)>>3] = (b) ? (p[(i)>>3] | BIT_MASK_TABLE8[(i)&7]) : (p[(i)>>3] & ~BIT_MASK_TABLE8[(i)&7])
-#define READ_BIT8(p,i)     (p[(i)>>3] & BIT_MASK_TABLE8[(i)&7])
-
-
 #if defined(_WIN32) || defined(_WIN64)
 char* optarg = NULL;
 int optind = 1;
 
 int getopt(int argc, char* const argv[], const char* optstring)
 {
-	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][0] == 0))
+	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][1] == 0))
 		return -1;
 
 	int opt = argv[optind][1];
@@ -78,13 +72,32 @@ int main(int argc, char** argv)
 	unsigned int speed = 460800U;
 	bool reset = false;
 	bool debug = false;
+	bool paced = false;
+	bool live = false;
+	bool batch = false;
+	unsigned int jobs = 0U;
+	bool metrics = false;
+	std::string metricsLog;
+	std::string trace;
+	int call = -1;
+	float start = 0.0F;
+	float end = 0.0F;
 
 	int c;
-	while ((c = ::getopt(argc, argv, "a:df:g:m:p:rs:v")) != -1) {
+	while ((c = ::getopt(argc, argv, "a:bc:D:df:g:j:L:lm:p:RrSs:t:v")) != -1) {
 		switch (c) {
 		case 'a':
 			amplitude = float(::atof(optarg));
 			break;
+		case 'b':
+			batch = true;
+			break;
+		case 'c':
+			call = ::atoi(optarg);
+			break;
+		case 'D':
+			trace = std::string(optarg);
+			break;
 		case 'd':
 			debug = true;
 			break;
@@ -94,6 +107,12 @@ int main(int argc, char** argv)
 		case 'g':
 			signature = std::string(optarg);
 			break;
+		case 'j':
+			jobs = (unsigned int)::atoi(optarg);
+			break;
+		case 'L':
+			metricsLog = std::string(optarg);
+			break;
 		case 'm':
 			if (::strcmp(optarg, "dstar") == 0)
 				mode = MODE_DSTAR;
@@ -113,25 +132,43 @@ int main(int argc, char** argv)
 		case 'p':
 			port = std::string(optarg);
 			break;
+		case 'l':
+			paced = true;
+			live = true;
+			break;
+		case 'R':
+			paced = true;
+			break;
 		case 'r':
 			reset = true;
 			break;
+		case 'S':
+			metrics = true;
+			break;
 		case 's':
 			speed = (unsigned int)::atoi(optarg);
 			break;
+		case 't': {
+				// <start>[-<end>] in seconds
+				char* p = NULL;
+				start = float(::strtod(optarg, &p));
+				if (*p == '-')
+					end = float(::strtod(p + 1, NULL));
+			}
+			break;
 		case 'v':
 			printf("Version: %s\n", version);
 			return 0;
 		case '?':
 			break;
 		default:
-			fprintf(stderr, "Usage: AMBE2WAV [-v] [-a amplitude] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-p <port>] [-s <speed>] [-r] [-d] <input> <output>\n");
+			fprintf(stderr, "Usage: AMBE2WAV [-v] [-a amplitude] [-b] [-j <jobs>] [-c <call>] [-t <start>[-<end>]] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-p <port>] [-s <speed>] [-R] [-l] [-r] [-S] [-L <file>] [-D <file>] [-d] <input> <output>\n");
 			break;
 		}
 	}
 
 	if (optind > (argc - 2)) {
-		fprintf(stderr, "Usage: AMBE2WAV [-v] [-a amplitude] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-p <port>] [-s <speed>] [-r] [-d] <input> <output>\n");
+		fprintf(stderr, "Usage: AMBE2WAV [-v] [-a amplitude] [-b] [-j <jobs>] [-c <call>] [-t <start>[-<end>]] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-p <port>] [-s <speed>] [-R] [-l] [-r] [-S] [-L <file>] [-D <file>] [-d] <input> <output>\n");
 		return 1;
 	}
 
@@ -140,22 +177,75 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
-	CAMBE2WAV* ambe2wav = new CAMBE2WAV(signature, mode, fec, port, speed, amplitude, reset, debug, std::string(argv[argc - 2]), std::string(argv[argc - 1]));
+	if (start < 0.0F || (end > 0.0F && end <= start)) {
+		::fprintf(stderr, "AMBE2WAV: invalid time range specified\n");
+		return 1;
+	}
+
+	if (batch && paced) {
+		::fprintf(stderr, "AMBE2WAV: real time mode can't be used in batch mode\n");
+		return 1;
+	}
+
+	if (metrics)
+		CMetrics::enable();
+
+	if (!metricsLog.empty() && !CMetrics::startLog(metricsLog, METRICS_LOG_INTERVAL_MS))
+		return 1;
+
+	if (!trace.empty() && !CTrace::open(trace)) {
+		CMetrics::finish();
+		return 1;
+	}
+
+	if (batch) {
+		// The hardware vocoder can only do one conversion at a time
+		std::string device;
+		if (CVocoder::usesHardware(mode))
+			device = port;
+
+		CBatchScheduler scheduler(jobs);
+		if (!scheduler.add(std::string(argv[argc - 2]), "", std::string(argv[argc - 1]), ".wav", device)) {
+			CTrace::close();
+			CMetrics::finish();
+			return 1;
+		}
+
+		unsigned int failed = scheduler.run([&](const std::string& input, const std::string& output) {
+			CAMBE2WAV ambe2wav(signature, mode, fec, port, speed, amplitude, call, start, end, paced, live, reset, debug, input, output);
+			return ambe2wav.run();
+		});
+
+		CTrace::close();
+		CMetrics::finish();
+
+		return (failed > 0U) ? 1 : 0;
+	}
+
+	CAMBE2WAV* ambe2wav = new CAMBE2WAV(signature, mode, fec, port, speed, amplitude, call, start, end, paced, live, reset, debug, std::string(argv[argc - 2]), std::string(argv[argc - 1]));
 
 	int ret = ambe2wav->run();
 
 	delete ambe2wav;
 
+	CTrace::close();
+	CMetrics::finish();
+
     return ret;
 }
 
-CAMBE2WAV::CAMBE2WAV(const std::string& signature, AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, float amplitude, bool reset, bool debug, const std::string& input, const std::string& output) :
+CAMBE2WAV::CAMBE2WAV(const std::string& signature, AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, float amplitude, int call, float start, float end, bool paced, bool live, bool reset, bool debug, const std::string& input, const std::string& output) :
 m_signature(signature),
 m_mode(mode),
 m_fec(fec),
 m_port(port),
 m_speed(speed),
 m_amplitude(amplitude),
+m_call(call),
+m_start(start),
+m_end(end),
+m_paced(paced),
+m_live(live),
 m_reset(reset),
 m_debug(debug),
 m_input(input),
@@ -174,133 +264,156 @@ int CAMBE2WAV::run()
 	if (!ret)
 		return 1;
 
-	CWAVFileWriter writer(m_output, AUDIO_SAMPLE_RATE, 1U, 16U, AUDIO_BLOCK_SIZE);
+	AMBE_MODE mode = m_mode;
+	bool fec = m_fec;
+	unsigned int frameSize = 0U;
+
+	// A container describes its own frames
+	if (reader.isContainer()) {
+		unsigned int call = (m_call >= 0) ? (unsigned int)m_call : 0U;
+		if (call >= reader.getCallCount()) {
+			::fprintf(stderr, "AMBE2WAV: the input has only %u calls\n", reader.getCallCount());
+			reader.close();
+			return 1;
+		}
+
+		const CAMBESegment& segment = reader.getCall(call);
+		mode      = AMBE_MODE(segment.m_mode);
+		fec       = segment.m_fec;
+		frameSize = segment.m_frameSize;
+
+		if (m_call >= 0 || m_start > 0.0F || m_end > 0.0F) {
+			ret = reader.select(call, uint32_t(m_start * 1000.0F + 0.5F), uint32_t(m_end * 1000.0F + 0.5F));
+			if (!ret) {
+				reader.close();
+				return 1;
+			}
+		}
+	} else if (reader.isDVTOOL()) {
+		// Which only ever holds D-Star
+		mode = MODE_DSTAR;
+		fec  = true;
+	}
+
+	if (!reader.isContainer() && (m_call >= 0 || m_start > 0.0F || m_end > 0.0F)) {
+		::fprintf(stderr, "AMBE2WAV: calls and times can only be selected from a container\n");
+		reader.close();
+		return 1;
+	}
+
+	CWAVFileWriter writer(m_output, AUDIO_SAMPLE_RATE, 1U, 16U, VOCODER_MAX_FRAME_BLOCKS * AUDIO_BLOCK_SIZE);
 	ret = writer.open();
 	if (!ret) {
 		reader.close();
 		return 1;
 	}
 
-	if (m_mode == MODE_M17_3200 || m_mode == MODE_M17_1600) {
-		CCodec2 codec2(m_mode == MODE_M17_3200);
+	CVocoder* vocoder = CVocoder::create(mode, fec, m_port, m_speed, m_reset, m_debug);
+	assert(vocoder != NULL);
 
-		unsigned int count = 0U;
+	if (frameSize > 0U && frameSize != vocoder->getFrameLength()) {
+		::fprintf(stderr, "AMBE2WAV: the container has %u byte frames but the mode has %u\n", frameSize, vocoder->getFrameLength());
+		delete vocoder;
+		writer.close();
+		reader.close();
+		return 1;
+	}
+
+	ret = vocoder->open();
+	if (!ret) {
+		delete vocoder;
+		writer.close();
+		reader.close();
+		return 1;
+	}
 
-		unsigned int blockSize = (m_mode == MODE_M17_3200) ? 8U : 4U;
+	unsigned int frameLength = vocoder->getFrameLength();
+	unsigned int samples     = vocoder->getFrameBlocks() * AUDIO_BLOCK_SIZE;
 
-		unsigned char frame[8U];
-		while (reader.read(frame, blockSize) == blockSize) {
-			if (m_debug)
-				CUtils::dump("decodeIn", frame, blockSize);
+	// In real time the frames are taken from the input as they arrive, and
+	// the output is kept to the real rate
+	CJitterBuffer* jitter = NULL;
+	if (m_paced) {
+		jitter = new CJitterBuffer(&reader, frameLength, vocoder->getFrameBlocks() * 20U, m_live);
+		jitter->start();
+	}
 
-			short audioInt[AUDIO_BLOCK_SIZE];
-			codec2.codec2_decode(audioInt, frame);
+	unsigned int count = 0U;
+	bool failed = false;
 
-			float audioFloat[AUDIO_BLOCK_SIZE];
-			for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++)
-				audioFloat[i] = (float(audioInt[i]) / 32767.0F) * m_amplitude;
+	for (;;) {
+		uint8_t frame[VOCODER_MAX_FRAME_LENGTH];
+		JITTER_FRAME type = JITTER_FRAME_OK;
 
-			if (m_debug)
-				CUtils::dump("decodeOut", (unsigned char*)audioFloat, AUDIO_BLOCK_SIZE * sizeof(float));
+		if (jitter != NULL) {
+			type = jitter->get(frame);
+			if (type == JITTER_END)
+				break;
+			if (type == JITTER_WAIT)
+				continue;
+		} else {
+			uint64_t start = CMetrics::start();
 
-			writer.write(audioFloat, AUDIO_BLOCK_SIZE);
+			if (reader.read(frame, frameLength) != frameLength)
+				break;
 
-			count++;
+			CMetrics::stop(STAGE_READ, start);
+			CMetrics::add(COUNTER_FRAMES_IN);
 		}
 
-		printf("Decoding: %u frames (%.2fs)\n", count, float(count) / 50.0F);
-#if !defined(HAVE_USB3000_P25)
-	} else if (m_mode == MODE_P25) {
-		printf("Using open source IMBE vocoder by Pavel Yazev\n");
-
-		unsigned int blockSize = m_fec ? 18U : 11U;
+		int16_t audioInt[VOCODER_MAX_FRAME_BLOCKS * AUDIO_BLOCK_SIZE];
 
-		imbe_vocoder vocoder;
-		unsigned int count = 0U;
+		if (type != JITTER_SILENCE) {
+			CTrace::event(TRACE_FRAME_IN, frame, frameLength);
 
-		uint8_t imbe[18U];
-		while (reader.read(imbe, blockSize) == blockSize) {
-			if (m_debug)
-				CUtils::dump("decodeIn", imbe, blockSize);
+			uint64_t start = CMetrics::start();
 
-			if (m_fec) {
-				uint8_t data[11U];
+			// In real time the gap is filled rather than stopping, but it is still an error
+			if (!vocoder->decode(frame, audioInt)) {
+				::fprintf(stderr, "AMBE2WAV: unable to decode the frame at %.2fs\n", float(count) / 50.0F);
+				failed = true;
 
-				CIMBEFEC fec;
-				fec.decode(imbe, data);
+				if (jitter == NULL)
+					break;
 
-				::memcpy(imbe, data, 11U);
+				type = JITTER_SILENCE;
 			}
 
-			int16_t frame[8U] = {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000};
-			unsigned int offset = 0U;
-
-			int16_t mask = 0x0800;
-			for (unsigned int i = 0U; i < 12U; i++, mask >>= 1, offset++)
-				frame[0U] |= READ_BIT8(imbe, offset) != 0x00U ? mask : 0x0000;
-
-			mask = 0x0800;
-			for (unsigned int i = 0U; i < 12U; i++, mask >>= 1, offset++)
-				frame[1U] |= READ_BIT8(imbe, offset) != 0x00U ? mask : 0x0000;
-
-			mask = 0x0800;
-			for (unsigned int i = 0U; i < 12U; i++, mask >>= 1, offset++)
-				frame[2U] |= READ_BIT8(imbe, offset) != 0x00U ? mask : 0x0000;
-
-			mask = 0x0800;
-			for (unsigned int i = 0U; i < 12U; i++, mask >>= 1, offset++)
-				frame[3U] |= READ_BIT8(imbe, offset) != 0x00U ? mask : 0x0000;
-
-			mask = 0x0400;
-			for (unsigned int i = 0U; i < 11U; i++, mask >>= 1, offset++)
-				frame[4U] |= READ_BIT8(imbe, offset) != 0x00U ? mask : 0x0000;
-
-			mask = 0x0400;
-			for (unsigned int i = 0U; i < 11U; i++, mask >>= 1, offset++)
-				frame[5U] |= READ_BIT8(imbe, offset) != 0x00U ? mask : 0x0000;
-
-			mask = 0x0400;
-			for (unsigned int i = 0U; i < 11U; i++, mask >>= 1, offset++)
-				frame[6U] |= READ_BIT8(imbe, offset) != 0x00U ? mask : 0x0000;
-
-			mask = 0x0040;
-			for (unsigned int i = 0U; i < 7U; i++, mask >>= 1, offset++)
-				frame[7U] |= READ_BIT8(imbe, offset) != 0x00U ? mask : 0x0000;
+			CMetrics::stop(STAGE_VOCODER, start);
+		}
 
-			int16_t audioInt[AUDIO_BLOCK_SIZE];
+		if (type == JITTER_SILENCE)
+			::memset(audioInt, 0x00, samples * sizeof(int16_t));
 
-			vocoder.imbe_decode(frame, audioInt);
+		float audioFloat[VOCODER_MAX_FRAME_BLOCKS * AUDIO_BLOCK_SIZE];
+		for (unsigned int i = 0U; i < samples; i++)
+			audioFloat[i] = (float(audioInt[i]) / 32768.0F) * m_amplitude;
 
-			float audioFloat[AUDIO_BLOCK_SIZE];
-			for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++)
-				audioFloat[i] = (float(audioInt[i]) / 4000.0F) * m_amplitude;
+		CTrace::event(TRACE_AUDIO_OUT, (uint8_t*)audioFloat, samples * sizeof(float));
 
-			if (m_debug)
-				CUtils::dump("decodeOut", (unsigned char*)audioFloat, AUDIO_BLOCK_SIZE * sizeof(float));
+		uint64_t start = CMetrics::start();
 
-			writer.write(audioFloat, AUDIO_BLOCK_SIZE);
+		writer.write(audioFloat, samples);
 
-			count++;
-		}
+		CMetrics::stop(STAGE_WRITE, start);
+		CMetrics::add(COUNTER_FRAMES_OUT, vocoder->getFrameBlocks());
 
-		printf("Decoding: %u frames (%.2fs)\n", count, float(count) / 50.0F);
-#endif
-	} else {
-		CDV3000SerialController controller(m_port, m_speed, m_mode, m_fec, m_amplitude, m_reset, m_debug, &reader, &writer);
-		ret = controller.open();
-		if (!ret) {
-			writer.close();
-			reader.close();
-			return 1;
-		}
+		count += vocoder->getFrameBlocks();
+	}
 
-		controller.process();
+	printf("Decoding: %u frames (%.2fs)\n", count, float(count) / 50.0F);
 
-		controller.close();
+	if (jitter != NULL) {
+		jitter->stop();
+		jitter->printStats();
+		delete jitter;
 	}
 
+	vocoder->close();
+	delete vocoder;
+
 	writer.close();
 	reader.close();
 
-	return 0;
+	return failed ? 1 : 0;
 }
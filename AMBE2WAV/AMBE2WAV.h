@@ -19,14 +19,14 @@
 #if !defined(AMBE2WAV_H)
 #define	AMBE2WAV_H
 
-#include "DV3000SerialController.h"
+#include "Vocoder.h"
 
 #include <string>
 
 class CAMBE2WAV
 {
 public:
-	CAMBE2WAV(const std::string& signature, AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, float amplitude, bool reset, bool debug, const std::string& input, const std::string& output);
+	CAMBE2WAV(const std::string& signature, AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, float amplitude, int call, float start, float end, bool paced, bool live, bool reset, bool debug, const std::string& input, const std::string& output);
 	~CAMBE2WAV();
 
 	int run();
@@ -38,6 +38,11 @@ private:
 	std::string  m_port;
 	unsigned int m_speed;
 	float        m_amplitude;
+	int          m_call;
+	float        m_start;
+	float        m_end;
+	bool         m_paced;
+	bool         m_live;
 	bool         m_reset;
 	bool         m_debug;
 	std::string  m_input;
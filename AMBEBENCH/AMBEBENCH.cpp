@@ -0,0 +1,701 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "AMBEBENCH.h"
+
+#include "Version.h"
+
+#include "DV3000Emulator.h"
+#include "DVTOOLFileReader.h"
+#include "DVTOOLFileWriter.h"
+#include "DVTOOLChecksum.h"
+#include "AMBEFileReader.h"
+#include "AMBEFileWriter.h"
+#include "WAVFileReader.h"
+#include "WAVFileWriter.h"
+#include "IMBEFEC.h"
+
+#include "codec2/kiss_fft.h"
+#include "codec2/radix4_fft.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+// The revision that the benchmark was built from, given by the Makefile
+#if defined(GIT_REV)
+const char* revision = GIT_REV;
+#else
+const char* revision = version;
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+char* optarg = NULL;
+int optind = 1;
+
+int getopt(int argc, char* const argv[], const char* optstring)
+{
+	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][0] == 0))
+		return -1;
+
+	int opt = argv[optind][1];
+	const char *p = strchr(optstring, opt);
+
+	if (p == NULL) {
+		return '?';
+	}
+
+	if (p[1] == ':') {
+		optind++;
+		if (optind >= argc)
+			return '?';
+
+		optarg = argv[optind];
+	}
+
+	optind++;
+
+	return opt;
+}
+#else
+#include <unistd.h>
+#endif
+
+// Stops the compiler from discarding the work being timed
+volatile float sink = 0.0F;
+
+// Times n calls of f, after a short warm up, and returns the mean in nanoseconds
+template <typename F>
+static double timeIt(unsigned int n, F f)
+{
+	for (unsigned int i = 0U; i < 100U; i++)
+		f();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0U; i < n; i++)
+		f();
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / double(n);
+}
+
+// Times a single call of f, which handles n frames, and returns the mean per
+// frame in nanoseconds. Used where the work, such as opening and closing a
+// file, can't be split into repeated calls.
+template <typename F>
+static double timeAll(unsigned int n, F f)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	f();
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / double(n);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int iterations = 100000U;
+	std::string filter;
+	std::string input;
+	std::string port;
+	unsigned int speed = 460800U;
+
+	int c;
+	while ((c = ::getopt(argc, argv, "b:i:n:p:s:v")) != -1) {
+		switch (c) {
+		case 'b':
+			filter = std::string(optarg);
+			break;
+		case 'i':
+			input = std::string(optarg);
+			break;
+		case 'n':
+			iterations = (unsigned int)::atoi(optarg);
+			break;
+		case 'p':
+			port = std::string(optarg);
+			break;
+		case 's':
+			speed = (unsigned int)::atoi(optarg);
+			break;
+		case 'v':
+			printf("Version: %s\n", version);
+			return 0;
+		case '?':
+			break;
+		default:
+			fprintf(stderr, "Usage: AMBEBENCH [-v] [-n <iterations>] [-b <benchmark>] [-i <input>] [-p <port>] [-s <speed>]\n");
+			break;
+		}
+	}
+
+	if (iterations == 0U) {
+		fprintf(stderr, "Usage: AMBEBENCH [-v] [-n <iterations>] [-b <benchmark>] [-i <input>] [-p <port>] [-s <speed>]\n");
+		return 1;
+	}
+
+	CAMBEBENCH* ambebench = new CAMBEBENCH(iterations, filter, input, port, speed);
+
+	int ret = ambebench->run();
+
+	delete ambebench;
+
+	return ret;
+}
+
+CAMBEBENCH::CAMBEBENCH(unsigned int iterations, const std::string& filter, const std::string& input, const std::string& port, unsigned int speed) :
+m_iterations(iterations),
+m_filter(filter),
+m_input(input),
+m_port(port),
+m_speed(speed),
+m_audio()
+{
+}
+
+CAMBEBENCH::~CAMBEBENCH()
+{
+}
+
+int CAMBEBENCH::run()
+{
+	if (m_input.empty())
+		synthesise();
+	else if (!readAudio())
+		return 1;
+
+	benchFFT();
+	benchCRC();
+	benchFEC();
+
+	// The vocoders are much slower than the rest, and the AMBE chip works in real time
+	unsigned int iterations = std::max(1U, m_iterations / 100U);
+
+	benchVocoder("codec2.3200", MODE_M17_3200, iterations);
+	benchVocoder("codec2.1600", MODE_M17_1600, iterations);
+	benchVocoder("imbe", MODE_P25, iterations);
+
+	// Without a port the DV3000 is emulated, which times the serial protocol
+	// and the controller rather than the chip
+#if !defined(_WIN32) && !defined(_WIN64)
+	CDV3000Emulator emulator;
+	if (m_port.empty() && emulator.start())
+		m_port = emulator.getPort();
+#endif
+
+	if (!m_port.empty()) {
+		iterations = std::max(1U, m_iterations / 1000U);
+
+		benchVocoder("dv3000.dstar", MODE_DSTAR, iterations);
+		benchVocoder("dv3000.dmr", MODE_DMR, iterations);
+	}
+
+	benchWAV();
+	benchAMBE("ambe", false);
+	benchAMBE("ambe.container", true);
+	benchDVTOOL();
+
+	return 0;
+}
+
+// The speech is read from a WAV file, converted to mono 8kHz if needed
+bool CAMBEBENCH::readAudio()
+{
+	CWAVFileReader reader(m_input, AUDIO_BLOCK_SIZE);
+	if (!reader.open())
+		return false;
+
+	if (reader.getSampleRate() != AUDIO_SAMPLE_RATE || reader.getChannels() > 1U)
+		reader.setConversion(AUDIO_SAMPLE_RATE);
+
+	float audio[AUDIO_BLOCK_SIZE];
+	while (reader.read(audio, AUDIO_BLOCK_SIZE) == AUDIO_BLOCK_SIZE) {
+		for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++) {
+			float sample = audio[i] * 32767.0F;
+			if (sample > 32767.0F)
+				sample = 32767.0F;
+			else if (sample < -32767.0F)
+				sample = -32767.0F;
+
+			m_audio.push_back(int16_t(sample));
+		}
+	}
+
+	reader.close();
+
+	if (m_audio.empty()) {
+		::fprintf(stderr, "AMBEBENCH: %s holds less than one block of audio\n", m_input.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+// Ten seconds of a rough imitation of speech, a pitch which wanders around
+// 120Hz with its harmonics shaped by two formants that move from syllable
+// to syllable, with a pause after every third one and a little noise
+void CAMBEBENCH::synthesise()
+{
+	const unsigned int SAMPLES          = 10U * AUDIO_SAMPLE_RATE;
+	const unsigned int SYLLABLE_SAMPLES = AUDIO_SAMPLE_RATE / 5U;
+
+	const float F1[] = {500.0F, 700.0F, 300.0F, 650.0F, 400.0F};
+	const float F2[] = {1500.0F, 1100.0F, 2200.0F, 1800.0F, 900.0F};
+
+	m_audio.resize(SAMPLES);
+
+	float phase = 0.0F;
+	uint32_t seed = 1U;
+
+	for (unsigned int n = 0U; n < SAMPLES; n++) {
+		float t = float(n) / float(AUDIO_SAMPLE_RATE);
+
+		unsigned int syllable = n / SYLLABLE_SAMPLES;
+		float envelope = ((syllable % 4U) == 3U) ? 0.0F : ::sinf(float(M_PI) * float(n % SYLLABLE_SAMPLES) / float(SYLLABLE_SAMPLES));
+
+		float f0 = 120.0F + 20.0F * ::sinf(2.0F * float(M_PI) * 0.7F * t);
+		phase += 2.0F * float(M_PI) * f0 / float(AUDIO_SAMPLE_RATE);
+		if (phase > 2.0F * float(M_PI))
+			phase -= 2.0F * float(M_PI);
+
+		float f1 = F1[syllable % 5U];
+		float f2 = F2[syllable % 5U];
+
+		float sample = 0.0F;
+		for (unsigned int k = 1U; float(k) * f0 < 3800.0F; k++) {
+			float f = float(k) * f0;
+			float a = ::expf(-((f - f1) * (f - f1)) / 40000.0F) + 0.6F * ::expf(-((f - f2) * (f - f2)) / 90000.0F) + 0.05F;
+			sample += a * ::sinf(float(k) * phase);
+		}
+
+		seed = seed * 1103515245U + 12345U;
+		float noise = float(int32_t(seed >> 16) - 32768) / 32768.0F;
+
+		m_audio[n] = int16_t(envelope * 3000.0F * sample + 200.0F * noise);
+	}
+}
+
+// The benchmark files are written to the temporary directory and removed afterwards
+std::string CAMBEBENCH::tempName(const std::string& extension) const
+{
+#if defined(_WIN32) || defined(_WIN64)
+	const char* dir = ::getenv("TEMP");
+	if (dir == NULL)
+		dir = ".";
+
+	return std::string(dir) + "\\ambebench." + extension;
+#else
+	const char* dir = ::getenv("TMPDIR");
+	if (dir == NULL)
+		dir = "/tmp";
+
+	return std::string(dir) + "/ambebench." + extension;
+#endif
+}
+
+// A benchmark is run when no filter is given or its name starts with the filter
+bool CAMBEBENCH::wanted(const std::string& name) const
+{
+	return name.compare(0U, m_filter.size(), m_filter) == 0;
+}
+
+// One JSON object per line, so the output can be collected and compared
+// between builds. For the vocoder and file benchmarks an operation is a frame.
+void CAMBEBENCH::report(const std::string& name, unsigned int iterations, double ns) const
+{
+	::fprintf(stdout, "{\"name\":\"%s\",\"version\":\"%s\",\"input\":\"%s\",\"iterations\":%u,\"ns_per_op\":%.1f,\"ops_per_s\":%.1f}\n",
+		name.c_str(), revision, m_input.empty() ? "synthetic" : m_input.c_str(), iterations, ns, (ns > 0.0) ? 1.0E9 / ns : 0.0);
+	::fflush(stdout);
+}
+
+void CAMBEBENCH::benchFFT()
+{
+	const int N = 512;
+
+	std::vector<std::complex<float>> in(N);
+	std::vector<std::complex<float>> out(N);
+	std::vector<float> real(N);
+
+	for (int i = 0; i < N; i++) {
+		in[i]   = std::complex<float>(float(i % 17) - 8.0F, float(i % 11) - 5.0F);
+		real[i] = float(i % 13) - 6.0F;
+	}
+
+	CKissFFT   kiss;
+	CRadix4FFT radix4;
+
+	FFT_STATE kissFwd, radix4Fwd;
+	kiss.fft_alloc(kissFwd, N, false);
+	radix4.fft_alloc(radix4Fwd, N, false);
+
+	FFTR_STATE kissRealFwd, radix4RealFwd, kissRealInv, radix4RealInv;
+	kiss.fftr_alloc(kissRealFwd, N, false);
+	radix4.fftr_alloc(radix4RealFwd, N, false);
+	kiss.fftr_alloc(kissRealInv, N, true);
+	radix4.fftr_alloc(radix4RealInv, N, true);
+
+	if (wanted("fft.kiss.512"))
+		report("fft.kiss.512", m_iterations, timeIt(m_iterations, [&]() { kiss.fft(kissFwd, in.data(), out.data()); sink = out[1].real(); }));
+
+	if (wanted("fft.radix4.512"))
+		report("fft.radix4.512", m_iterations, timeIt(m_iterations, [&]() { radix4.fft(radix4Fwd, in.data(), out.data()); sink = out[1].real(); }));
+
+	if (wanted("fftr.kiss.512"))
+		report("fftr.kiss.512", m_iterations, timeIt(m_iterations, [&]() { kiss.fftr(kissRealFwd, real.data(), out.data()); sink = out[1].real(); }));
+
+	if (wanted("fftr.radix4.512"))
+		report("fftr.radix4.512", m_iterations, timeIt(m_iterations, [&]() { radix4.fftr(radix4RealFwd, real.data(), out.data()); sink = out[1].real(); }));
+
+	if (wanted("fftri.kiss.512"))
+		report("fftri.kiss.512", m_iterations, timeIt(m_iterations, [&]() { kiss.fftri(kissRealInv, out.data(), real.data()); sink = real[1]; }));
+
+	if (wanted("fftri.radix4.512"))
+		report("fftri.radix4.512", m_iterations, timeIt(m_iterations, [&]() { radix4.fftri(radix4RealInv, out.data(), real.data()); sink = real[1]; }));
+}
+
+void CAMBEBENCH::benchCRC()
+{
+	// A D-Star radio header is 39 bytes followed by its checksum
+	const unsigned int HEADER_LENGTH = 41U;
+	const unsigned int HEADER_COUNT  = 1024U;
+	const unsigned int BLOCK_LENGTH  = 65536U;
+
+	std::vector<uint8_t> data(HEADER_LENGTH * HEADER_COUNT);
+	for (unsigned int i = 0U; i < data.size(); i++)
+		data[i] = uint8_t(i * 7U + 3U);
+
+	for (unsigned int i = 0U; i < HEADER_COUNT; i++) {
+		CDVTOOLChecksum csum;
+		csum.update(&data[i * HEADER_LENGTH], HEADER_LENGTH - 2U);
+		csum.result(&data[i * HEADER_LENGTH + HEADER_LENGTH - 2U]);
+	}
+
+	std::vector<uint8_t> block(BLOCK_LENGTH);
+	for (unsigned int i = 0U; i < BLOCK_LENGTH; i++)
+		block[i] = uint8_t(i * 13U + 1U);
+
+	if (wanted("crc.dvtool.header"))
+		report("crc.dvtool.header", m_iterations, timeIt(m_iterations, [&]() { CDVTOOLChecksum csum; csum.update(data.data(), HEADER_LENGTH - 2U); sink = float(csum.check(data.data() + HEADER_LENGTH - 2U)); }));
+
+	if (wanted("crc.dvtool.checkblock.1024")) {
+		unsigned int iterations = std::max(1U, m_iterations / HEADER_COUNT);
+		report("crc.dvtool.checkblock.1024", iterations, timeIt(iterations, [&]() { sink = float(CDVTOOLChecksum::checkBlock(data.data(), HEADER_LENGTH, HEADER_COUNT)); }));
+	}
+
+	if (wanted("crc.dvtool.64k")) {
+		unsigned int iterations = std::max(1U, m_iterations / 100U);
+		report("crc.dvtool.64k", iterations, timeIt(iterations, [&]() { CDVTOOLChecksum csum; csum.update(block.data(), BLOCK_LENGTH); uint8_t sum[2U]; csum.result(sum); sink = float(sum[0U]); }));
+	}
+}
+
+void CAMBEBENCH::benchFEC()
+{
+	const unsigned int FRAME_COUNT = 256U;
+
+	// Eleven bytes of IMBE and the eighteen bytes with FEC
+	std::vector<uint8_t> imbe(FRAME_COUNT * 11U);
+	for (unsigned int i = 0U; i < imbe.size(); i++)
+		imbe[i] = uint8_t(i * 29U + 5U);
+
+	std::vector<uint8_t> data(FRAME_COUNT * 18U);
+
+	CIMBEFEC fec;
+	for (unsigned int i = 0U; i < FRAME_COUNT; i++)
+		fec.encode(&data[i * 18U], &imbe[i * 11U]);
+
+	unsigned int n = 0U;
+
+	if (wanted("imbefec.encode"))
+		report("imbefec.encode", m_iterations, timeIt(m_iterations, [&]() { uint8_t out[18U]; fec.encode(out, &imbe[n * 11U]); n = (n + 1U) % FRAME_COUNT; sink = float(out[0U]); }));
+
+	if (wanted("imbefec.decode"))
+		report("imbefec.decode", m_iterations, timeIt(m_iterations, [&]() { uint8_t out[11U]; fec.decode(&data[n * 18U], out); n = (n + 1U) % FRAME_COUNT; sink = float(out[0U]); }));
+}
+
+// Encoding and decoding the speech a frame at a time, on the AMBE chip for the D-Star and DMR modes
+void CAMBEBENCH::benchVocoder(const std::string& name, AMBE_MODE mode, unsigned int iterations)
+{
+	bool encode = wanted(name + ".encode");
+	bool decode = wanted(name + ".decode");
+	if (!encode && !decode)
+		return;
+
+	CVocoder* vocoder = CVocoder::create(mode, false, m_port, m_speed, false, false);
+	assert(vocoder != NULL);
+
+	if (!vocoder->open()) {
+		::fprintf(stderr, "AMBEBENCH: could not open the vocoder for %s\n", name.c_str());
+		delete vocoder;
+		return;
+	}
+
+	unsigned int frameBlocks = vocoder->getFrameBlocks();
+	unsigned int frameLength = vocoder->getFrameLength();
+	unsigned int blockCount  = (unsigned int)(m_audio.size() / AUDIO_BLOCK_SIZE);
+
+	// The whole of the speech is encoded first, so that decoding uses real frames
+	std::vector<uint8_t> frames;
+	for (unsigned int i = 0U; i < blockCount; i++) {
+		uint8_t frame[VOCODER_MAX_FRAME_LENGTH];
+		ENCODE_RESULT result = vocoder->encode(&m_audio[i * AUDIO_BLOCK_SIZE], frame);
+		if (result == ENCODE_ERROR) {
+			::fprintf(stderr, "AMBEBENCH: the vocoder for %s failed\n", name.c_str());
+			vocoder->close();
+			delete vocoder;
+			return;
+		}
+
+		if (result == ENCODE_FRAME)
+			frames.insert(frames.end(), frame, frame + frameLength);
+	}
+
+	unsigned int frameCount = (unsigned int)(frames.size() / frameLength);
+
+	if (encode) {
+		unsigned int n = 0U;
+		report(name + ".encode", iterations, timeIt(iterations, [&]() {
+			uint8_t frame[VOCODER_MAX_FRAME_LENGTH];
+			for (unsigned int i = 0U; i < frameBlocks; i++) {
+				vocoder->encode(&m_audio[n * AUDIO_BLOCK_SIZE], frame);
+				n = (n + 1U) % blockCount;
+			}
+			sink = float(frame[0U]);
+		}));
+	}
+
+	if (decode && frameCount > 0U) {
+		unsigned int n = 0U;
+		report(name + ".decode", iterations, timeIt(iterations, [&]() {
+			int16_t audio[VOCODER_MAX_FRAME_BLOCKS * AUDIO_BLOCK_SIZE];
+			vocoder->decode(&frames[n * frameLength], audio);
+			n = (n + 1U) % frameCount;
+			sink = float(audio[0U]);
+		}));
+	}
+
+	vocoder->close();
+	delete vocoder;
+}
+
+// A file of the speech is written and then read back, including the opening and closing
+void CAMBEBENCH::benchWAV()
+{
+	bool write = wanted("wav.write");
+	bool read  = wanted("wav.read");
+	if (!write && !read)
+		return;
+
+	std::string fileName = tempName("wav");
+
+	unsigned int blockCount = (unsigned int)(m_audio.size() / AUDIO_BLOCK_SIZE);
+	unsigned int count = std::max(blockCount, m_iterations / 10U);
+
+	std::vector<float> audio(m_audio.size());
+	for (unsigned int i = 0U; i < m_audio.size(); i++)
+		audio[i] = float(m_audio[i]) / 32768.0F;
+
+	bool ok = true;
+
+	double ns = timeAll(count, [&]() {
+		CWAVFileWriter writer(fileName, AUDIO_SAMPLE_RATE, 1U, 16U, AUDIO_BLOCK_SIZE);
+		ok = writer.open();
+		if (!ok)
+			return;
+
+		for (unsigned int i = 0U; i < count && ok; i++)
+			ok = writer.write(&audio[(i % blockCount) * AUDIO_BLOCK_SIZE], AUDIO_BLOCK_SIZE);
+
+		writer.close();
+	});
+
+	if (!ok) {
+		::fprintf(stderr, "AMBEBENCH: could not write %s\n", fileName.c_str());
+		::remove(fileName.c_str());
+		return;
+	}
+
+	if (write)
+		report("wav.write", count, ns);
+
+	if (read) {
+		unsigned int blocks = 0U;
+
+		ns = timeAll(count, [&]() {
+			CWAVFileReader reader(fileName, AUDIO_BLOCK_SIZE);
+			if (!reader.open())
+				return;
+
+			float block[AUDIO_BLOCK_SIZE];
+			while (reader.read(block, AUDIO_BLOCK_SIZE) == AUDIO_BLOCK_SIZE)
+				blocks++;
+
+			reader.close();
+		});
+
+		if (blocks == count)
+			report("wav.read", count, ns);
+		else
+			::fprintf(stderr, "AMBEBENCH: read %u of the %u blocks written to %s\n", blocks, count, fileName.c_str());
+	}
+
+	::remove(fileName.c_str());
+}
+
+// D-Star frames with FEC, either after a signature or in a container
+void CAMBEBENCH::benchAMBE(const std::string& name, bool container)
+{
+	const unsigned int FRAME_LENGTH = 9U;
+
+	bool write = wanted(name + ".write");
+	bool read  = wanted(name + ".read");
+	if (!write && !read)
+		return;
+
+	std::string fileName = tempName(container ? "amb" : "ambe");
+	const std::string signature = container ? "" : "AMBE";
+
+	unsigned int count = m_iterations;
+
+	uint8_t frame[FRAME_LENGTH];
+	for (unsigned int i = 0U; i < FRAME_LENGTH; i++)
+		frame[i] = uint8_t(i * 37U + 11U);
+
+	bool ok = true;
+
+	double ns = timeAll(count, [&]() {
+		CAMBEFileWriter writer(fileName, signature);
+		if (container)
+			writer.setContainer(MODE_DSTAR, true, 20U);
+
+		ok = writer.open();
+		if (!ok)
+			return;
+
+		for (unsigned int i = 0U; i < count && ok; i++) {
+			frame[0U] = uint8_t(i);
+			ok = writer.write(frame, FRAME_LENGTH) == FRAME_LENGTH;
+		}
+
+		writer.close();
+	});
+
+	if (!ok) {
+		::fprintf(stderr, "AMBEBENCH: could not write %s\n", fileName.c_str());
+		::remove(fileName.c_str());
+		return;
+	}
+
+	if (write)
+		report(name + ".write", count, ns);
+
+	if (read) {
+		unsigned int frames = 0U;
+
+		ns = timeAll(count, [&]() {
+			CAMBEFileReader reader(fileName, signature);
+			if (!reader.open())
+				return;
+
+			while (reader.read(frame, FRAME_LENGTH) == FRAME_LENGTH)
+				frames++;
+
+			reader.close();
+		});
+
+		if (frames == count)
+			report(name + ".read", count, ns);
+		else
+			::fprintf(stderr, "AMBEBENCH: read %u of the %u frames written to %s\n", frames, count, fileName.c_str());
+	}
+
+	::remove(fileName.c_str());
+}
+
+void CAMBEBENCH::benchDVTOOL()
+{
+	const unsigned int FRAME_LENGTH = 9U;
+
+	bool write = wanted("dvtool.write");
+	bool read  = wanted("dvtool.read");
+	if (!write && !read)
+		return;
+
+	std::string fileName = tempName("dvtool");
+
+	unsigned int count = m_iterations;
+
+	uint8_t frame[FRAME_LENGTH];
+	for (unsigned int i = 0U; i < FRAME_LENGTH; i++)
+		frame[i] = uint8_t(i * 37U + 11U);
+
+	bool ok = true;
+
+	double ns = timeAll(count, [&]() {
+		CDVTOOLFileWriter writer(fileName);
+		ok = writer.open(count);
+		if (!ok)
+			return;
+
+		for (unsigned int i = 0U; i < count && ok; i++) {
+			frame[0U] = uint8_t(i);
+			ok = writer.write(frame, FRAME_LENGTH);
+		}
+
+		writer.close();
+	});
+
+	if (!ok) {
+		::fprintf(stderr, "AMBEBENCH: could not write %s\n", fileName.c_str());
+		::remove(fileName.c_str());
+		return;
+	}
+
+	if (write)
+		report("dvtool.write", count, ns);
+
+	if (read) {
+		unsigned int frames = 0U;
+
+		ns = timeAll(count, [&]() {
+			CDVTOOLFileReader reader(fileName);
+			if (!reader.open())
+				return;
+
+			while (reader.read(frame, FRAME_LENGTH) == FRAME_LENGTH)
+				frames++;
+
+			reader.close();
+		});
+
+		if (frames == count)
+			report("dvtool.read", count, ns);
+		else
+			::fprintf(stderr, "AMBEBENCH: read %u of the %u frames written to %s\n", frames, count, fileName.c_str());
+	}
+
+	::remove(fileName.c_str());
+}
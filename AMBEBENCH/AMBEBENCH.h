@@ -0,0 +1,62 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(AMBEBENCH_H)
+#define	AMBEBENCH_H
+
+#include "Vocoder.h"
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+class CAMBEBENCH
+{
+public:
+	CAMBEBENCH(unsigned int iterations, const std::string& filter, const std::string& input, const std::string& port, unsigned int speed);
+	~CAMBEBENCH();
+
+	int run();
+
+private:
+	unsigned int         m_iterations;
+	std::string          m_filter;
+	std::string          m_input;
+	std::string          m_port;
+	unsigned int         m_speed;
+	std::vector<int16_t> m_audio;
+
+	bool wanted(const std::string& name) const;
+	void report(const std::string& name, unsigned int iterations, double ns) const;
+
+	bool readAudio();
+	void synthesise();
+
+	std::string tempName(const std::string& extension) const;
+
+	void benchFFT();
+	void benchCRC();
+	void benchFEC();
+	void benchVocoder(const std::string& name, AMBE_MODE mode, unsigned int iterations);
+	void benchWAV();
+	void benchAMBE(const std::string& name, bool container);
+	void benchDVTOOL();
+};
+
+#endif
@@ -0,0 +1,447 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "AMBECOMPARE.h"
+
+#include "AMBEFileReader.h"
+#include "WAVFileReader.h"
+#include "Version.h"
+
+#include "codec2/kiss_fft.h"
+
+#include <complex>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+// How far behind the reference the test audio may be, 100ms
+const unsigned int MAX_DELAY = 800U;
+
+// Only the first ten seconds are used to find the delay
+const unsigned int DELAY_SAMPLES = 10U * AUDIO_SAMPLE_RATE;
+
+// Blocks quieter than -60dBFS aren't counted as speech
+const float SILENCE_POWER = 1.0E-6F;
+
+// The usual limits on the SNR of a single block
+const float MIN_BLOCK_SNR = -10.0F;
+const float MAX_BLOCK_SNR = 35.0F;
+
+const unsigned int FFT_LENGTH = 256U;
+
+#if defined(_WIN32) || defined(_WIN64)
+char* optarg = NULL;
+int optind = 1;
+
+int getopt(int argc, char* const argv[], const char* optstring)
+{
+	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][1] == 0))
+		return -1;
+
+	int opt = argv[optind][1];
+	const char *p = strchr(optstring, opt);
+
+	if (p == NULL) {
+		return '?';
+	}
+
+	if (p[1] == ':') {
+		optind++;
+		if (optind >= argc)
+			return '?';
+
+		optarg = argv[optind];
+	}
+
+	optind++;
+
+	return opt;
+}
+#else
+#include <unistd.h>
+#endif
+
+int main(int argc, char** argv)
+{
+	std::string signature;
+	AMBE_MODE mode = MODE_DSTAR;
+	bool fec = true;
+	float minSNR = -HUGE_VALF;
+	float maxLSD = HUGE_VALF;
+
+	int c;
+	while ((c = ::getopt(argc, argv, "f:g:l:m:n:v")) != -1) {
+		switch (c) {
+		case 'f':
+			fec = ::atoi(optarg) != 0;
+			break;
+		case 'g':
+			signature = std::string(optarg);
+			break;
+		case 'l':
+			maxLSD = float(::atof(optarg));
+			break;
+		case 'm':
+			if (::strcmp(optarg, "dstar") == 0)
+				mode = MODE_DSTAR;
+			else if (::strcmp(optarg, "dmr") == 0)
+				mode = MODE_DMR;
+			else if (::strcmp(optarg, "p25") == 0)
+				mode = MODE_P25;
+			else if (::strcmp(optarg, "nxdn") == 0)
+				mode = MODE_DMR;
+			else if (::strcmp(optarg, "m17-3200") == 0)
+				mode = MODE_M17_3200;
+			else if (::strcmp(optarg, "m17-1600") == 0)
+				mode = MODE_M17_1600;
+			else
+				mode = MODE_UNKNOWN;
+			break;
+		case 'n':
+			minSNR = float(::atof(optarg));
+			break;
+		case 'v':
+			printf("Version: %s\n", version);
+			return 0;
+		case '?':
+			break;
+		default:
+			fprintf(stderr, "Usage: AMBECOMPARE [-v] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-n <min SNR>] [-l <max distortion>] <reference> <test>\n");
+			break;
+		}
+	}
+
+	if (optind > (argc - 2)) {
+		fprintf(stderr, "Usage: AMBECOMPARE [-v] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-n <min SNR>] [-l <max distortion>] <reference> <test>\n");
+		return 1;
+	}
+
+	if (mode == MODE_UNKNOWN) {
+		::fprintf(stderr, "AMBECOMPARE: unknown mode specified\n");
+		return 1;
+	}
+
+	CAMBECOMPARE* ambecompare = new CAMBECOMPARE(signature, mode, fec, minSNR, maxLSD, std::string(argv[argc - 2]), std::string(argv[argc - 1]));
+
+	int ret = ambecompare->run();
+
+	delete ambecompare;
+
+	return ret;
+}
+
+CAMBECOMPARE::CAMBECOMPARE(const std::string& signature, AMBE_MODE mode, bool fec, float minSNR, float maxLSD, const std::string& reference, const std::string& test) :
+m_signature(signature),
+m_mode(mode),
+m_fec(fec),
+m_minSNR(minSNR),
+m_maxLSD(maxLSD),
+m_reference(reference),
+m_test(test)
+{
+}
+
+CAMBECOMPARE::~CAMBECOMPARE()
+{
+}
+
+// WAV files are compared as audio and anything else as encoded frames, the
+// result is a line of JSON and the exit status is 0 if the test passes
+int CAMBECOMPARE::run()
+{
+	bool wav1 = isWAV(m_reference);
+	bool wav2 = isWAV(m_test);
+
+	if (wav1 != wav2) {
+		::fprintf(stderr, "AMBECOMPARE: only one of %s and %s is a WAV file\n", m_reference.c_str(), m_test.c_str());
+		return 1;
+	}
+
+	return wav1 ? compareAudio() : compareFrames();
+}
+
+// The frames must be identical, the bit errors show how far apart they are
+int CAMBECOMPARE::compareFrames()
+{
+	std::vector<uint8_t> reference;
+	std::vector<uint8_t> test;
+	unsigned int length1, length2;
+
+	if (!readFrames(m_reference, reference, length1))
+		return 1;
+
+	if (!readFrames(m_test, test, length2))
+		return 1;
+
+	if (length1 != length2) {
+		::fprintf(stderr, "AMBECOMPARE: the frames are of %u and %u bytes\n", length1, length2);
+		return 1;
+	}
+
+	unsigned int frames1 = (unsigned int)(reference.size() / length1);
+	unsigned int frames2 = (unsigned int)(test.size() / length2);
+	unsigned int frames  = (frames1 < frames2) ? frames1 : frames2;
+
+	unsigned int differentFrames = 0U;
+	uint64_t differentBits = 0U;
+	int first = -1;
+
+	for (unsigned int i = 0U; i < frames; i++) {
+		const uint8_t* p = &reference[i * length1];
+		const uint8_t* q = &test[i * length1];
+
+		if (::memcmp(p, q, length1) == 0)
+			continue;
+
+		if (first < 0)
+			first = int(i);
+
+		differentFrames++;
+
+		for (unsigned int j = 0U; j < length1; j++) {
+			uint8_t bits = p[j] ^ q[j];
+			for (; bits != 0U; bits &= bits - 1U)
+				differentBits++;
+		}
+	}
+
+	double ber = (frames > 0U) ? double(differentBits) / (double(frames) * double(length1) * 8.0) : 0.0;
+
+	::fprintf(stdout, "{\"type\":\"frames\",\"frame_length\":%u,\"frames_reference\":%u,\"frames_test\":%u,\"frames_different\":%u,\"bits_different\":%llu,\"ber\":%.6f,\"first_different\":%d}\n",
+		length1, frames1, frames2, differentFrames, (unsigned long long)differentBits, ber, first);
+
+	return (frames1 == frames2 && differentFrames == 0U) ? 0 : 1;
+}
+
+// The segmental SNR and the log spectral distortion of the test against the
+// reference, over the blocks of the reference which aren't silent. The test
+// audio is first lined up with the reference so that the original speech can
+// be compared with its decoded version.
+int CAMBECOMPARE::compareAudio()
+{
+	std::vector<float> reference;
+	std::vector<float> test;
+
+	if (!readAudio(m_reference, reference))
+		return 1;
+
+	if (!readAudio(m_test, test))
+		return 1;
+
+	unsigned int delay = findDelay(reference, test);
+
+	unsigned int samples = (unsigned int)reference.size();
+	if (test.size() < samples + delay)
+		samples = (test.size() > delay) ? (unsigned int)(test.size() - delay) : 0U;
+
+	unsigned int different = 0U;
+	for (unsigned int i = 0U; i < samples; i++) {
+		if (reference[i] != test[i + delay])
+			different++;
+	}
+
+	CKissFFT kiss;
+	FFTR_STATE fft;
+	kiss.fftr_alloc(fft, FFT_LENGTH, false);
+
+	float window[AUDIO_BLOCK_SIZE];
+	for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++)
+		window[i] = 0.5F - 0.5F * ::cosf(2.0F * float(M_PI) * float(i) / float(AUDIO_BLOCK_SIZE - 1U));
+
+	unsigned int blocks = 0U;
+	double totalSNR = 0.0;
+	double totalLSD = 0.0;
+
+	for (unsigned int n = 0U; n + AUDIO_BLOCK_SIZE <= samples; n += AUDIO_BLOCK_SIZE) {
+		const float* p = &reference[n];
+		const float* q = &test[n + delay];
+
+		float signal = 0.0F;
+		float noise  = 0.0F;
+		for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++) {
+			signal += p[i] * p[i];
+			noise  += (p[i] - q[i]) * (p[i] - q[i]);
+		}
+
+		if (signal / float(AUDIO_BLOCK_SIZE) < SILENCE_POWER)
+			continue;
+
+		float snr = (noise > 0.0F) ? 10.0F * ::log10f(signal / noise) : MAX_BLOCK_SNR;
+		if (snr < MIN_BLOCK_SNR)
+			snr = MIN_BLOCK_SNR;
+		else if (snr > MAX_BLOCK_SNR)
+			snr = MAX_BLOCK_SNR;
+
+		float in1[FFT_LENGTH];
+		float in2[FFT_LENGTH];
+		for (unsigned int i = 0U; i < FFT_LENGTH; i++) {
+			in1[i] = (i < AUDIO_BLOCK_SIZE) ? p[i] * window[i] : 0.0F;
+			in2[i] = (i < AUDIO_BLOCK_SIZE) ? q[i] * window[i] : 0.0F;
+		}
+
+		std::complex<float> out1[FFT_LENGTH / 2U + 1U];
+		std::complex<float> out2[FFT_LENGTH / 2U + 1U];
+		kiss.fftr(fft, in1, out1);
+		kiss.fftr(fft, in2, out2);
+
+		// Leaving out DC and Nyquist
+		float distortion = 0.0F;
+		for (unsigned int i = 1U; i < FFT_LENGTH / 2U; i++) {
+			float d = 10.0F * ::log10f((std::norm(out1[i]) + 1.0E-10F) / (std::norm(out2[i]) + 1.0E-10F));
+			distortion += d * d;
+		}
+
+		totalSNR += snr;
+		totalLSD += ::sqrtf(distortion / float(FFT_LENGTH / 2U - 1U));
+		blocks++;
+	}
+
+	double segSNR = (blocks > 0U) ? totalSNR / double(blocks) : 0.0;
+	double lsd    = (blocks > 0U) ? totalLSD / double(blocks) : 0.0;
+
+	::fprintf(stdout, "{\"type\":\"audio\",\"samples_reference\":%u,\"samples_test\":%u,\"delay\":%u,\"samples_different\":%u,\"blocks\":%u,\"segsnr_db\":%.2f,\"lsd_db\":%.2f}\n",
+		(unsigned int)reference.size(), (unsigned int)test.size(), delay, different, blocks, segSNR, lsd);
+
+	if (blocks == 0U) {
+		::fprintf(stderr, "AMBECOMPARE: the reference has no speech to compare\n");
+		return 1;
+	}
+
+	return (segSNR >= m_minSNR && lsd <= m_maxLSD) ? 0 : 1;
+}
+
+// Every frame of every call, the mode comes from a container or DV-Tool file
+// or else from the options
+bool CAMBECOMPARE::readFrames(const std::string& fileName, std::vector<uint8_t>& frames, unsigned int& frameLength) const
+{
+	CAMBEFileReader reader(fileName, m_signature);
+	if (!reader.open())
+		return false;
+
+	AMBE_MODE mode = m_mode;
+	bool fec = m_fec;
+	unsigned int frameSize = 0U;
+
+	if (reader.isContainer() && reader.getCallCount() > 0U) {
+		const CAMBESegment& segment = reader.getCall(0U);
+		mode      = AMBE_MODE(segment.m_mode);
+		fec       = segment.m_fec;
+		frameSize = segment.m_frameSize;
+	} else if (reader.isDVTOOL()) {
+		mode = MODE_DSTAR;
+		fec  = true;
+	}
+
+	frameLength = CVocoder::getModeFrameLength(mode, fec);
+	if (frameLength == 0U) {
+		::fprintf(stderr, "AMBECOMPARE: %s has an unknown mode\n", fileName.c_str());
+		reader.close();
+		return false;
+	}
+
+	if (frameSize > 0U && frameSize != frameLength) {
+		::fprintf(stderr, "AMBECOMPARE: %s has %u byte frames but its mode has %u\n", fileName.c_str(), frameSize, frameLength);
+		reader.close();
+		return false;
+	}
+
+	uint8_t frame[VOCODER_MAX_FRAME_LENGTH];
+	while (reader.read(frame, frameLength) == frameLength)
+		frames.insert(frames.end(), frame, frame + frameLength);
+
+	reader.close();
+
+	return true;
+}
+
+// Mono 8kHz audio, converted if needed
+bool CAMBECOMPARE::readAudio(const std::string& fileName, std::vector<float>& audio) const
+{
+	CWAVFileReader reader(fileName, AUDIO_BLOCK_SIZE);
+	if (!reader.open())
+		return false;
+
+	if (reader.getSampleRate() != AUDIO_SAMPLE_RATE || reader.getChannels() > 1U)
+		reader.setConversion(AUDIO_SAMPLE_RATE);
+
+	for (;;) {
+		float block[AUDIO_BLOCK_SIZE];
+		unsigned int n = reader.read(block, AUDIO_BLOCK_SIZE);
+
+		audio.insert(audio.end(), block, block + n);
+
+		if (n < AUDIO_BLOCK_SIZE)
+			break;
+	}
+
+	reader.close();
+
+	return true;
+}
+
+// The number of samples by which the test lags the reference, found from the
+// peak of their normalised cross correlation
+unsigned int CAMBECOMPARE::findDelay(const std::vector<float>& reference, const std::vector<float>& test) const
+{
+	unsigned int samples = (unsigned int)reference.size();
+	if (samples > DELAY_SAMPLES)
+		samples = DELAY_SAMPLES;
+
+	unsigned int best = 0U;
+	double bestCorr = 0.0;
+
+	for (unsigned int delay = 0U; delay <= MAX_DELAY && delay < test.size(); delay++) {
+		unsigned int n = samples;
+		if (test.size() < n + delay)
+			n = (unsigned int)(test.size() - delay);
+
+		double xy = 0.0;
+		double yy = 0.0;
+		for (unsigned int i = 0U; i < n; i++) {
+			xy += double(reference[i]) * double(test[i + delay]);
+			yy += double(test[i + delay]) * double(test[i + delay]);
+		}
+
+		if (yy <= 0.0)
+			continue;
+
+		double corr = xy / ::sqrt(yy);
+		if (corr > bestCorr) {
+			bestCorr = corr;
+			best     = delay;
+		}
+	}
+
+	return best;
+}
+
+bool CAMBECOMPARE::isWAV(const std::string& fileName)
+{
+	FILE* fp = ::fopen(fileName.c_str(), "rb");
+	if (fp == NULL)
+		return false;
+
+	uint8_t header[12U];
+	bool ret = ::fread(header, 1U, 12U, fp) == 12U && ::memcmp(header, "RIFF", 4U) == 0 && ::memcmp(header + 8U, "WAVE", 4U) == 0;
+
+	::fclose(fp);
+
+	return ret;
+}
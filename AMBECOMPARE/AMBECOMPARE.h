@@ -0,0 +1,57 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(AMBECOMPARE_H)
+#define	AMBECOMPARE_H
+
+#include "Vocoder.h"
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+class CAMBECOMPARE
+{
+public:
+	CAMBECOMPARE(const std::string& signature, AMBE_MODE mode, bool fec, float minSNR, float maxLSD, const std::string& reference, const std::string& test);
+	~CAMBECOMPARE();
+
+	int run();
+
+private:
+	std::string m_signature;
+	AMBE_MODE   m_mode;
+	bool        m_fec;
+	float       m_minSNR;
+	float       m_maxLSD;
+	std::string m_reference;
+	std::string m_test;
+
+	int  compareFrames();
+	int  compareAudio();
+
+	bool readFrames(const std::string& fileName, std::vector<uint8_t>& frames, unsigned int& frameLength) const;
+	bool readAudio(const std::string& fileName, std::vector<float>& audio) const;
+
+	unsigned int findDelay(const std::vector<float>& reference, const std::vector<float>& test) const;
+
+	static bool isWAV(const std::string& fileName);
+};
+
+#endif
@@ -0,0 +1,248 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "AMBEDAEMON.h"
+
+#include "DaemonSession.h"
+#include "VocoderPool.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Version.h"
+
+#include <vector>
+
+#include <cassert>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <poll.h>
+
+static volatile sig_atomic_t stopping = 0;
+
+static void sigHandler(int)
+{
+	stopping = 1;
+}
+
+int main(int argc, char** argv)
+{
+	AMBE_MODE mode = MODE_UNKNOWN;
+	bool fec = true;
+	std::string port = "/dev/ttyUSB0";
+	unsigned int speed = 460800U;
+	bool reset = false;
+	bool debug = false;
+	bool metrics = false;
+	std::string metricsLog;
+	std::string trace;
+
+	int c;
+	while ((c = ::getopt(argc, argv, "D:df:L:m:p:rSs:v")) != -1) {
+		switch (c) {
+		case 'D':
+			trace = std::string(optarg);
+			break;
+		case 'd':
+			debug = true;
+			break;
+		case 'f':
+			fec = ::atoi(optarg) != 0;
+			break;
+		case 'L':
+			metricsLog = std::string(optarg);
+			break;
+		case 'm':
+			if (::strcmp(optarg, "dstar") == 0)
+				mode = MODE_DSTAR;
+			else if (::strcmp(optarg, "dmr") == 0)
+				mode = MODE_DMR;
+			else if (::strcmp(optarg, "p25") == 0)
+				mode = MODE_P25;
+			else if (::strcmp(optarg, "nxdn") == 0)
+				mode = MODE_DMR;
+			else {
+				::fprintf(stderr, "AMBEDAEMON: unknown mode specified\n");
+				return 1;
+			}
+			break;
+		case 'p':
+			port = std::string(optarg);
+			break;
+		case 'r':
+			reset = true;
+			break;
+		case 'S':
+			metrics = true;
+			break;
+		case 's':
+			speed = (unsigned int)::atoi(optarg);
+			break;
+		case 'v':
+			printf("Version: %s\n", version);
+			return 0;
+		case '?':
+			break;
+		default:
+			fprintf(stderr, "Usage: AMBEDAEMON [-v] [-m dstar|dmr|p25|nxdn] [-f 0|1] [-p <port>] [-s <speed>] [-r] [-S] [-L <file>] [-D <file>] [-d] <socket>\n");
+			break;
+		}
+	}
+
+	if (optind > (argc - 1)) {
+		fprintf(stderr, "Usage: AMBEDAEMON [-v] [-m dstar|dmr|p25|nxdn] [-f 0|1] [-p <port>] [-s <speed>] [-r] [-S] [-L <file>] [-D <file>] [-d] <socket>\n");
+		return 1;
+	}
+
+	if (metrics)
+		CMetrics::enable();
+
+	if (!metricsLog.empty() && !CMetrics::startLog(metricsLog, METRICS_LOG_INTERVAL_MS))
+		return 1;
+
+	if (!trace.empty() && !CTrace::open(trace)) {
+		CMetrics::finish();
+		return 1;
+	}
+
+	CAMBEDAEMON* daemon = new CAMBEDAEMON(mode, fec, port, speed, reset, debug, std::string(argv[argc - 1]));
+
+	int ret = daemon->run();
+
+	delete daemon;
+
+	CTrace::close();
+	CMetrics::finish();
+
+	return ret;
+}
+
+CAMBEDAEMON::CAMBEDAEMON(AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, bool reset, bool debug, const std::string& socket) :
+m_mode(mode),
+m_fec(fec),
+m_port(port),
+m_speed(speed),
+m_reset(reset),
+m_debug(debug),
+m_socket(socket)
+{
+}
+
+CAMBEDAEMON::~CAMBEDAEMON()
+{
+}
+
+int CAMBEDAEMON::run()
+{
+	struct sockaddr_un addr;
+	::memset(&addr, 0x00, sizeof(struct sockaddr_un));
+	addr.sun_family = AF_UNIX;
+
+	if (m_socket.size() >= sizeof(addr.sun_path)) {
+		::fprintf(stderr, "AMBEDAEMON: the socket name %s is too long\n", m_socket.c_str());
+		return 1;
+	}
+
+	::strcpy(addr.sun_path, m_socket.c_str());
+
+	CVocoderPool pool(m_port, m_speed, m_mode, m_fec, m_reset, m_debug);
+	if (!pool.open())
+		return 1;
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		::fprintf(stderr, "AMBEDAEMON: cannot create the socket, err=%d\n", errno);
+		pool.close();
+		return 1;
+	}
+
+	// Left behind by an earlier run
+	::unlink(m_socket.c_str());
+
+	if (::bind(fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_un)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+		::fprintf(stderr, "AMBEDAEMON: cannot listen on %s, err=%d\n", m_socket.c_str(), errno);
+		::close(fd);
+		pool.close();
+		return 1;
+	}
+
+	// Without SA_RESTART so that poll() returns when stopping
+	struct sigaction act;
+	::memset(&act, 0x00, sizeof(struct sigaction));
+	act.sa_handler = sigHandler;
+	::sigemptyset(&act.sa_mask);
+	::sigaction(SIGINT, &act, NULL);
+	::sigaction(SIGTERM, &act, NULL);
+
+	::fprintf(stdout, "AMBEDAEMON: listening on %s\n", m_socket.c_str());
+	::fflush(stdout);
+
+	std::vector<CDaemonSession*> sessions;
+
+	while (stopping == 0) {
+		struct pollfd pfd;
+		pfd.fd      = fd;
+		pfd.events  = POLLIN;
+		pfd.revents = 0;
+
+		// Finished sessions are tidied up at least once a second
+		int n = ::poll(&pfd, 1U, 1000);
+		if (n < 0 && errno != EINTR) {
+			::fprintf(stderr, "AMBEDAEMON: error from poll, err=%d\n", errno);
+			break;
+		}
+
+		if (n > 0) {
+			int client = ::accept(fd, NULL, NULL);
+			if (client >= 0) {
+				CDaemonSession* session = new CDaemonSession(client, pool);
+				session->start();
+				sessions.push_back(session);
+			}
+		}
+
+		for (std::vector<CDaemonSession*>::iterator it = sessions.begin(); it != sessions.end();) {
+			if ((*it)->isFinished()) {
+				delete *it;
+				it = sessions.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	::fprintf(stdout, "AMBEDAEMON: stopping\n");
+
+	pool.stop();
+
+	for (std::vector<CDaemonSession*>::iterator it = sessions.begin(); it != sessions.end(); ++it)
+		(*it)->stop();
+
+	for (std::vector<CDaemonSession*>::iterator it = sessions.begin(); it != sessions.end(); ++it)
+		delete *it;
+
+	::close(fd);
+	::unlink(m_socket.c_str());
+
+	pool.close();
+
+	return 0;
+}
@@ -0,0 +1,44 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(AMBEDAEMON_H)
+#define	AMBEDAEMON_H
+
+#include "Vocoder.h"
+
+#include <string>
+
+class CAMBEDAEMON
+{
+public:
+	CAMBEDAEMON(AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, bool reset, bool debug, const std::string& socket);
+	~CAMBEDAEMON();
+
+	int run();
+
+private:
+	AMBE_MODE    m_mode;
+	bool         m_fec;
+	std::string  m_port;
+	unsigned int m_speed;
+	bool         m_reset;
+	bool         m_debug;
+	std::string  m_socket;
+};
+
+#endif
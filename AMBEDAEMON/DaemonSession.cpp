@@ -0,0 +1,404 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "DaemonSession.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+// A block of audio on the wire, 16-bit samples
+const unsigned int AUDIO_BLOCK_BYTES = AUDIO_BLOCK_SIZE * 2U;
+
+CDaemonSession::CDaemonSession(int fd, CVocoderPool& pool) :
+m_fd(fd),
+m_pool(pool),
+m_thread(),
+m_finished(false),
+m_inMode(MODE_UNKNOWN),
+m_inFEC(false),
+m_outMode(MODE_UNKNOWN),
+m_outFEC(false),
+m_decoder(NULL),
+m_encoder(NULL),
+m_payload(NULL),
+m_output(),
+m_outputType(DAEMON_FRAME)
+{
+	assert(fd >= 0);
+
+	m_payload = new uint8_t[DAEMON_MAX_PAYLOAD];
+}
+
+CDaemonSession::~CDaemonSession()
+{
+	join();
+
+	::close(m_fd);
+
+	delete[] m_payload;
+}
+
+void CDaemonSession::start()
+{
+	m_thread = std::thread(&CDaemonSession::run, this);
+}
+
+bool CDaemonSession::isFinished() const
+{
+	return m_finished;
+}
+
+void CDaemonSession::stop()
+{
+	::shutdown(m_fd, SHUT_RDWR);
+}
+
+void CDaemonSession::join()
+{
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void CDaemonSession::run()
+{
+	for (;;) {
+		uint8_t header[DAEMON_HEADER_LENGTH];
+		if (!receive(header, DAEMON_HEADER_LENGTH))
+			break;
+
+		unsigned int length = (unsigned int)header[2U] | ((unsigned int)header[3U] << 8);
+		if (!receive(m_payload, length))
+			break;
+
+		bool ret = false;
+		switch (header[0U]) {
+		case DAEMON_OPEN:
+			ret = open(m_payload, length);
+			break;
+		case DAEMON_AUDIO:
+			ret = audio(m_payload, length);
+			break;
+		case DAEMON_FRAME:
+			ret = frame(m_payload, length);
+			break;
+		case DAEMON_CLOSE:
+			ret = close();
+			break;
+		default:
+			ret = error("unknown message type");
+			break;
+		}
+
+		if (!ret)
+			break;
+	}
+
+	release();
+
+	m_finished = true;
+}
+
+bool CDaemonSession::open(const uint8_t* payload, unsigned int length)
+{
+	assert(payload != NULL);
+
+	if (m_decoder != NULL || m_encoder != NULL)
+		return error("a session is already open");
+
+	if (length != DAEMON_OPEN_LENGTH)
+		return error("invalid open message");
+
+	uint8_t inMode  = payload[0U];
+	uint8_t outMode = payload[2U];
+
+	if ((inMode == DAEMON_AUDIO_MODE && outMode == DAEMON_AUDIO_MODE) ||
+	    (inMode != DAEMON_AUDIO_MODE && inMode >= MODE_UNKNOWN) ||
+	    (outMode != DAEMON_AUDIO_MODE && outMode >= MODE_UNKNOWN))
+		return error("invalid modes");
+
+	m_inMode  = (inMode == DAEMON_AUDIO_MODE) ? MODE_UNKNOWN : AMBE_MODE(inMode);
+	m_inFEC   = payload[1U] != 0U;
+	m_outMode = (outMode == DAEMON_AUDIO_MODE) ? MODE_UNKNOWN : AMBE_MODE(outMode);
+	m_outFEC  = payload[3U] != 0U;
+
+	// The chip is held by one side of a session at a time
+	if (CVocoder::usesHardware(m_inMode) && CVocoder::usesHardware(m_outMode))
+		return error("only one of the modes may use the AMBE chip");
+
+	if (m_inMode != MODE_UNKNOWN) {
+		m_decoder = m_pool.get(m_inMode, m_inFEC);
+		if (m_decoder == NULL)
+			return error("the input mode is not available");
+	}
+
+	if (m_outMode != MODE_UNKNOWN) {
+		m_encoder = m_pool.get(m_outMode, m_outFEC);
+		if (m_encoder == NULL)
+			return error("the output mode is not available");
+	}
+
+	uint8_t reply[DAEMON_OPEN_LENGTH];
+	reply[0U] = (m_decoder != NULL) ? uint8_t(m_decoder->getFrameLength()) : 0U;
+	reply[1U] = (m_decoder != NULL) ? uint8_t(m_decoder->getFrameBlocks()) : 1U;
+	reply[2U] = (m_encoder != NULL) ? uint8_t(m_encoder->getFrameLength()) : 0U;
+	reply[3U] = (m_encoder != NULL) ? uint8_t(m_encoder->getFrameBlocks()) : 1U;
+
+	m_output.clear();
+
+	return send(DAEMON_OPEN, reply, DAEMON_OPEN_LENGTH);
+}
+
+bool CDaemonSession::audio(const uint8_t* payload, unsigned int length)
+{
+	assert(payload != NULL);
+
+	if (m_encoder == NULL || m_decoder != NULL)
+		return error("the session doesn't take audio");
+
+	if ((length % AUDIO_BLOCK_BYTES) != 0U)
+		return error("the audio is not in whole blocks");
+
+	CMetrics::add(COUNTER_FRAMES_IN, length / AUDIO_BLOCK_BYTES);
+
+	for (unsigned int n = 0U; n < length; n += AUDIO_BLOCK_BYTES) {
+		int16_t audio[AUDIO_BLOCK_SIZE];
+		for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++)
+			audio[i] = int16_t(uint16_t(payload[n + i * 2U + 0U]) | (uint16_t(payload[n + i * 2U + 1U]) << 8));
+
+		if (!encode(audio))
+			return false;
+	}
+
+	return flush();
+}
+
+bool CDaemonSession::frame(const uint8_t* payload, unsigned int length)
+{
+	assert(payload != NULL);
+
+	if (m_decoder == NULL)
+		return error("the session doesn't take frames");
+
+	unsigned int frameLength = m_decoder->getFrameLength();
+	unsigned int blocks      = m_decoder->getFrameBlocks();
+
+	if ((length % frameLength) != 0U)
+		return error("the frames are not whole");
+
+	CMetrics::add(COUNTER_FRAMES_IN, length / frameLength);
+
+	for (unsigned int n = 0U; n < length; n += frameLength) {
+		CTrace::event(TRACE_FRAME_IN, payload + n, frameLength);
+
+		uint64_t start = CMetrics::start();
+
+		int16_t audio[VOCODER_MAX_FRAME_BLOCKS * AUDIO_BLOCK_SIZE];
+		if (!m_decoder->decode(payload + n, audio))
+			return error("the frame could not be decoded");
+
+		CMetrics::stop(STAGE_VOCODER, start);
+
+		for (unsigned int i = 0U; i < blocks; i++) {
+			const int16_t* block = audio + i * AUDIO_BLOCK_SIZE;
+
+			if (m_encoder != NULL) {
+				if (!encode(block))
+					return false;
+			} else {
+				uint8_t data[AUDIO_BLOCK_BYTES];
+				for (unsigned int j = 0U; j < AUDIO_BLOCK_SIZE; j++) {
+					data[j * 2U + 0U] = uint8_t(uint16_t(block[j]) >> 0);
+					data[j * 2U + 1U] = uint8_t(uint16_t(block[j]) >> 8);
+				}
+
+				if (!output(DAEMON_AUDIO, data, AUDIO_BLOCK_BYTES))
+					return false;
+
+				CMetrics::add(COUNTER_FRAMES_OUT);
+			}
+		}
+	}
+
+	return flush();
+}
+
+bool CDaemonSession::encode(const int16_t* audio)
+{
+	assert(audio != NULL);
+	assert(m_encoder != NULL);
+
+	uint64_t start = CMetrics::start();
+
+	uint8_t frame[VOCODER_MAX_FRAME_LENGTH];
+	ENCODE_RESULT result = m_encoder->encode(audio, frame);
+
+	CMetrics::stop(STAGE_VOCODER, start);
+
+	if (result == ENCODE_ERROR)
+		return error("the audio could not be encoded");
+
+	if (result == ENCODE_MORE)
+		return true;
+
+	CMetrics::add(COUNTER_FRAMES_OUT);
+
+	CTrace::event(TRACE_FRAME_OUT, frame, m_encoder->getFrameLength());
+
+	return output(DAEMON_FRAME, frame, m_encoder->getFrameLength());
+}
+
+bool CDaemonSession::close()
+{
+	if (m_decoder == NULL && m_encoder == NULL)
+		return error("no session is open");
+
+	release();
+
+	return send(DAEMON_CLOSE, NULL, 0U);
+}
+
+void CDaemonSession::release()
+{
+	if (m_decoder != NULL) {
+		m_pool.put(m_decoder, m_inMode, m_inFEC);
+		m_decoder = NULL;
+	}
+
+	if (m_encoder != NULL) {
+		m_pool.put(m_encoder, m_outMode, m_outFEC);
+		m_encoder = NULL;
+	}
+}
+
+// Output is gathered into messages as large as possible, each holding only
+// whole blocks or frames
+bool CDaemonSession::output(DAEMON_MESSAGE type, const uint8_t* data, unsigned int length)
+{
+	assert(data != NULL);
+
+	if (!m_output.empty() && (type != m_outputType || m_output.size() + length > DAEMON_MAX_PAYLOAD)) {
+		if (!flush())
+			return false;
+	}
+
+	m_outputType = type;
+	m_output.insert(m_output.end(), data, data + length);
+
+	return true;
+}
+
+bool CDaemonSession::flush()
+{
+	if (m_output.empty())
+		return true;
+
+	uint64_t start = CMetrics::start();
+
+	bool ret = send(m_outputType, m_output.data(), (unsigned int)m_output.size());
+
+	CMetrics::stop(STAGE_WRITE, start);
+
+	m_output.clear();
+
+	return ret;
+}
+
+bool CDaemonSession::error(const char* text)
+{
+	assert(text != NULL);
+
+	::fprintf(stderr, "DaemonSession: %s\n", text);
+
+	send(DAEMON_ERROR, (const uint8_t*)text, (unsigned int)::strlen(text));
+
+	return false;
+}
+
+bool CDaemonSession::send(DAEMON_MESSAGE type, const uint8_t* data, unsigned int length)
+{
+	assert(length <= DAEMON_MAX_PAYLOAD);
+
+	uint8_t header[DAEMON_HEADER_LENGTH];
+	header[0U] = uint8_t(type);
+	header[1U] = 0U;
+	header[2U] = uint8_t(length >> 0);
+	header[3U] = uint8_t(length >> 8);
+
+	struct iovec iov[2U];
+	iov[0U].iov_base = header;
+	iov[0U].iov_len  = DAEMON_HEADER_LENGTH;
+	iov[1U].iov_base = (void*)data;
+	iov[1U].iov_len  = length;
+
+	struct msghdr msg;
+	::memset(&msg, 0x00, sizeof(struct msghdr));
+	msg.msg_iov    = iov;
+	msg.msg_iovlen = (length > 0U) ? 2U : 1U;
+
+	// Sent as one, or the rest after a partial send
+	while (msg.msg_iovlen > 0U) {
+		ssize_t n = ::sendmsg(m_fd, &msg, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		while (msg.msg_iovlen > 0U && size_t(n) >= msg.msg_iov->iov_len) {
+			n -= ssize_t(msg.msg_iov->iov_len);
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+
+		if (msg.msg_iovlen > 0U) {
+			msg.msg_iov->iov_base = (uint8_t*)msg.msg_iov->iov_base + n;
+			msg.msg_iov->iov_len -= size_t(n);
+		}
+	}
+
+	return true;
+}
+
+bool CDaemonSession::receive(uint8_t* data, unsigned int length)
+{
+	assert(data != NULL);
+
+	unsigned int offset = 0U;
+	while (offset < length) {
+		ssize_t n = ::recv(m_fd, data + offset, length - offset, 0);
+		if (n == 0)
+			return false;
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		offset += (unsigned int)n;
+	}
+
+	return true;
+}
@@ -0,0 +1,79 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	DaemonSession_H
+#define	DaemonSession_H
+
+#include "DaemonProtocol.h"
+#include "VocoderPool.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// One client connection of the daemon, run on its own thread. It holds at
+// most one open session at a time, with the vocoders for it taken from the
+// pool when it is opened and returned when it is closed.
+class CDaemonSession {
+public:
+	CDaemonSession(int fd, CVocoderPool& pool);
+	~CDaemonSession();
+
+	void start();
+
+	bool isFinished() const;
+
+	// Ends the connection, after which join() doesn't wait long
+	void stop();
+	void join();
+
+private:
+	int                  m_fd;
+	CVocoderPool&        m_pool;
+	std::thread          m_thread;
+	std::atomic<bool>    m_finished;
+	AMBE_MODE            m_inMode;
+	bool                 m_inFEC;
+	AMBE_MODE            m_outMode;
+	bool                 m_outFEC;
+	CVocoder*            m_decoder;
+	CVocoder*            m_encoder;
+	uint8_t*             m_payload;
+	std::vector<uint8_t> m_output;
+	DAEMON_MESSAGE       m_outputType;
+
+	void run();
+
+	bool open(const uint8_t* payload, unsigned int length);
+	bool audio(const uint8_t* payload, unsigned int length);
+	bool frame(const uint8_t* payload, unsigned int length);
+	bool close();
+	void release();
+
+	bool encode(const int16_t* audio);
+
+	bool output(DAEMON_MESSAGE type, const uint8_t* data, unsigned int length);
+	bool flush();
+
+	bool error(const char* text);
+
+	bool send(DAEMON_MESSAGE type, const uint8_t* data, unsigned int length);
+	bool receive(uint8_t* data, unsigned int length);
+};
+
+#endif
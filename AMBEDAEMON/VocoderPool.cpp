@@ -0,0 +1,210 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "VocoderPool.h"
+
+#include <cassert>
+#include <cstdio>
+
+// The most idle vocoders of one mode that are kept
+const unsigned int MAX_IDLE_VOCODERS = 16U;
+
+// A session's view of the AMBE chip, which it holds until it is returned
+// to the pool
+class CSharedVocoder : public CVocoder {
+public:
+	CSharedVocoder(CVocoder* device) :
+	m_device(device)
+	{
+		assert(device != NULL);
+	}
+
+	virtual bool open()
+	{
+		return true;
+	}
+
+	virtual unsigned int getFrameLength() const
+	{
+		return m_device->getFrameLength();
+	}
+
+	virtual ENCODE_RESULT encode(const int16_t* audio, uint8_t* frame)
+	{
+		return m_device->encode(audio, frame);
+	}
+
+	virtual bool decode(const uint8_t* frame, int16_t* audio)
+	{
+		return m_device->decode(frame, audio);
+	}
+
+	virtual void close()
+	{
+	}
+
+private:
+	CVocoder* m_device;
+};
+
+CVocoderPool::CVocoderPool(const std::string& port, unsigned int speed, AMBE_MODE mode, bool fec, bool reset, bool debug) :
+m_port(port),
+m_speed(speed),
+m_mode(mode),
+m_fec(fec),
+m_reset(reset),
+m_debug(debug),
+m_device(NULL),
+m_deviceBusy(false),
+m_stopping(false),
+m_deviceMutex(),
+m_deviceCond(),
+m_idle(),
+m_mutex()
+{
+}
+
+CVocoderPool::~CVocoderPool()
+{
+}
+
+bool CVocoderPool::open()
+{
+	// No AMBE chip
+	if (m_mode == MODE_UNKNOWN)
+		return true;
+
+	if (!CVocoder::usesHardware(m_mode)) {
+		::fprintf(stderr, "VocoderPool: the mode given for the AMBE chip doesn't use one\n");
+		return false;
+	}
+
+	m_device = CVocoder::create(m_mode, m_fec, m_port, m_speed, m_reset, m_debug);
+	assert(m_device != NULL);
+
+	if (!m_device->open()) {
+		delete m_device;
+		m_device = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+CVocoder* CVocoderPool::get(AMBE_MODE mode, bool fec)
+{
+	if (CVocoder::usesHardware(mode)) {
+		if (m_device == NULL || mode != m_mode || fec != m_fec)
+			return NULL;
+
+		std::unique_lock<std::mutex> lock(m_deviceMutex);
+		m_deviceCond.wait(lock, [this] { return m_stopping || !m_deviceBusy; });
+
+		if (m_stopping)
+			return NULL;
+
+		m_deviceBusy = true;
+
+		return new CSharedVocoder(m_device);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::vector<CVocoder*>& idle = m_idle[getKey(mode, fec)];
+		if (!idle.empty()) {
+			CVocoder* vocoder = idle.back();
+			idle.pop_back();
+			return vocoder;
+		}
+	}
+
+	CVocoder* vocoder = CVocoder::create(mode, fec, m_port, m_speed, m_reset, m_debug);
+	if (vocoder == NULL)
+		return NULL;
+
+	if (!vocoder->open()) {
+		delete vocoder;
+		return NULL;
+	}
+
+	return vocoder;
+}
+
+// The AMBE chip is reset and given to the next session, any other vocoder
+// that can't be reset is closed
+void CVocoderPool::put(CVocoder* vocoder, AMBE_MODE mode, bool fec)
+{
+	assert(vocoder != NULL);
+
+	if (CVocoder::usesHardware(mode)) {
+		delete vocoder;
+
+		if (!m_device->reset())
+			::fprintf(stderr, "VocoderPool: the AMBE chip could not be reset\n");
+
+		std::lock_guard<std::mutex> lock(m_deviceMutex);
+		m_deviceBusy = false;
+		m_deviceCond.notify_one();
+
+		return;
+	}
+
+	if (vocoder->reset()) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::vector<CVocoder*>& idle = m_idle[getKey(mode, fec)];
+		if (idle.size() < MAX_IDLE_VOCODERS) {
+			idle.push_back(vocoder);
+			return;
+		}
+	}
+
+	vocoder->close();
+	delete vocoder;
+}
+
+void CVocoderPool::stop()
+{
+	std::lock_guard<std::mutex> lock(m_deviceMutex);
+	m_stopping = true;
+	m_deviceCond.notify_all();
+}
+
+void CVocoderPool::close()
+{
+	for (std::map<unsigned int, std::vector<CVocoder*>>::iterator it = m_idle.begin(); it != m_idle.end(); ++it) {
+		for (std::vector<CVocoder*>::iterator vocoder = it->second.begin(); vocoder != it->second.end(); ++vocoder) {
+			(*vocoder)->close();
+			delete *vocoder;
+		}
+	}
+
+	m_idle.clear();
+
+	if (m_device != NULL) {
+		m_device->close();
+		delete m_device;
+		m_device = NULL;
+	}
+}
+
+unsigned int CVocoderPool::getKey(AMBE_MODE mode, bool fec)
+{
+	return (unsigned int)mode * 2U + (fec ? 1U : 0U);
+}
@@ -0,0 +1,74 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	VocoderPool_H
+#define	VocoderPool_H
+
+#include "Vocoder.h"
+
+#include <condition_variable>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <map>
+
+// Keeps vocoders open between sessions. Those which can be reset are kept
+// once a session has finished with them and handed to the next session
+// that wants the same mode, so that the Codec2 tables are only built once.
+// The AMBE chip is opened once at start up and used by the sessions in its
+// mode one at a time, as its encoder and decoder carry their state from
+// frame to frame. A session holds the chip from get() until put(), when
+// the chip is reset for the next one, and the others wait in get().
+class CVocoderPool {
+public:
+	CVocoderPool(const std::string& port, unsigned int speed, AMBE_MODE mode, bool fec, bool reset, bool debug);
+	~CVocoderPool();
+
+	bool open();
+
+	// NULL if the mode isn't available, or if stop() is called while
+	// waiting for the AMBE chip
+	CVocoder* get(AMBE_MODE mode, bool fec);
+
+	// Returns a vocoder from get() with the same mode and FEC
+	void put(CVocoder* vocoder, AMBE_MODE mode, bool fec);
+
+	// Wakes the sessions waiting for the AMBE chip
+	void stop();
+
+	void close();
+
+private:
+	std::string  m_port;
+	unsigned int m_speed;
+	AMBE_MODE    m_mode;
+	bool         m_fec;
+	bool         m_reset;
+	bool         m_debug;
+	CVocoder*    m_device;
+	bool         m_deviceBusy;
+	bool         m_stopping;
+	std::mutex   m_deviceMutex;
+	std::condition_variable m_deviceCond;
+	std::map<unsigned int, std::vector<CVocoder*>> m_idle;
+	std::mutex   m_mutex;
+
+	static unsigned int getKey(AMBE_MODE mode, bool fec);
+};
+
+#endif
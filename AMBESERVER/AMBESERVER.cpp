@@ -0,0 +1,471 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "AMBESERVER.h"
+
+#include "Metrics.h"
+#include "Trace.h"
+#include "Version.h"
+
+#include <chrono>
+
+#include <cassert>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <netdb.h>
+
+const unsigned char DV3000_START_BYTE = 0x61U;
+const unsigned int  DV3000_HEADER_LEN = 4U;
+
+const unsigned char DV3000_TYPE_CONTROL = 0x00U;
+
+const unsigned char DV3000_CONTROL_PRODID    = 0x30U;
+const unsigned char DV3000_CONTROL_VERSTRING = 0x31U;
+
+// Written after each packet, its answer marks the end of the answer to that packet
+const unsigned char DV3000_REQ_PRODID[]  = {DV3000_START_BYTE, 0x00U, 0x01U, DV3000_TYPE_CONTROL, DV3000_CONTROL_PRODID};
+const unsigned int  DV3000_REQ_PRODID_LEN = 5U;
+
+// Written after a timeout, everything that the chip sends up to its answer is discarded
+const unsigned char DV3000_REQ_VERSTRING[]  = {DV3000_START_BYTE, 0x00U, 0x01U, DV3000_TYPE_CONTROL, DV3000_CONTROL_VERSTRING};
+const unsigned int  DV3000_REQ_VERSTRING_LEN = 5U;
+
+// The packets written to the chip before waiting for its answers, enough to
+// keep it busy without filling its input buffer
+const unsigned int MAX_IN_FLIGHT = 4U;
+
+// Beyond this the chip can't keep up and new packets are dropped
+const unsigned int MAX_WAITING = 200U;
+
+// How long to wait for the chip to answer a packet
+const uint64_t RESPONSE_TIMEOUT_MS = 1000U;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void sigHandler(int)
+{
+	stopping = 1;
+}
+
+static uint64_t now()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static bool isControl(const unsigned char* packet, unsigned int length, unsigned char control)
+{
+	assert(packet != NULL);
+
+	return length > DV3000_HEADER_LEN && packet[3U] == DV3000_TYPE_CONTROL && packet[4U] == control;
+}
+
+int main(int argc, char** argv)
+{
+	std::string port = "/dev/ttyUSB0";
+	unsigned int speed = 460800U;
+	std::string address;
+	unsigned int udpPort = 2460U;
+	bool reset = false;
+	bool debug = false;
+	bool metrics = false;
+	std::string metricsLog;
+	std::string trace;
+
+	int c;
+	while ((c = ::getopt(argc, argv, "a:D:dL:p:rSs:u:v")) != -1) {
+		switch (c) {
+		case 'a':
+			address = std::string(optarg);
+			break;
+		case 'D':
+			trace = std::string(optarg);
+			break;
+		case 'd':
+			debug = true;
+			break;
+		case 'L':
+			metricsLog = std::string(optarg);
+			break;
+		case 'p':
+			port = std::string(optarg);
+			break;
+		case 'r':
+			reset = true;
+			break;
+		case 'S':
+			metrics = true;
+			break;
+		case 's':
+			speed = (unsigned int)::atoi(optarg);
+			break;
+		case 'u':
+			udpPort = (unsigned int)::atoi(optarg);
+			break;
+		case 'v':
+			printf("Version: %s\n", version);
+			return 0;
+		case '?':
+			break;
+		default:
+			fprintf(stderr, "Usage: AMBESERVER [-v] [-a <address>] [-u <udp port>] [-p <port>] [-s <speed>] [-r] [-S] [-L <file>] [-D <file>] [-d]\n");
+			break;
+		}
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "Usage: AMBESERVER [-v] [-a <address>] [-u <udp port>] [-p <port>] [-s <speed>] [-r] [-S] [-L <file>] [-D <file>] [-d]\n");
+		return 1;
+	}
+
+	if (metrics)
+		CMetrics::enable();
+
+	if (!metricsLog.empty() && !CMetrics::startLog(metricsLog, METRICS_LOG_INTERVAL_MS))
+		return 1;
+
+	if (!trace.empty() && !CTrace::open(trace)) {
+		CMetrics::finish();
+		return 1;
+	}
+
+	CAMBESERVER* server = new CAMBESERVER(port, speed, address, udpPort, reset, debug);
+
+	int ret = server->run();
+
+	delete server;
+
+	CTrace::close();
+	CMetrics::finish();
+
+	return ret;
+}
+
+CAMBESERVER::CAMBESERVER(const std::string& port, unsigned int speed, const std::string& address, unsigned int udpPort, bool reset, bool debug) :
+m_address(address),
+m_udpPort(udpPort),
+m_debug(debug),
+m_chip(port, speed, MODE_UNKNOWN, false, reset, debug),
+m_fd(-1),
+m_waiting(),
+m_inFlight(),
+m_free(),
+m_lastAddr(),
+m_lastAddrLen(0U),
+m_syncing(false),
+m_syncSent(0U)
+{
+}
+
+CAMBESERVER::~CAMBESERVER()
+{
+	for (std::deque<CAMBERequest*>::iterator it = m_waiting.begin(); it != m_waiting.end(); ++it)
+		delete *it;
+	for (std::deque<CAMBERequest*>::iterator it = m_inFlight.begin(); it != m_inFlight.end(); ++it)
+		delete *it;
+	for (std::deque<CAMBERequest*>::iterator it = m_free.begin(); it != m_free.end(); ++it)
+		delete *it;
+}
+
+int CAMBESERVER::run()
+{
+	if (!m_chip.open())
+		return 1;
+
+	if (!openSocket()) {
+		m_chip.close();
+		return 1;
+	}
+
+	int epfd = ::epoll_create1(0);
+	if (epfd < 0) {
+		::fprintf(stderr, "AMBESERVER: cannot create the epoll instance, err=%d\n", errno);
+		::close(m_fd);
+		m_chip.close();
+		return 1;
+	}
+
+	struct epoll_event ev;
+	::memset(&ev, 0x00, sizeof(struct epoll_event));
+	ev.events  = EPOLLIN;
+	ev.data.fd = m_fd;
+	::epoll_ctl(epfd, EPOLL_CTL_ADD, m_fd, &ev);
+
+	ev.data.fd = m_chip.getFD();
+	::epoll_ctl(epfd, EPOLL_CTL_ADD, m_chip.getFD(), &ev);
+
+	// Without SA_RESTART so that epoll_wait() returns when stopping
+	struct sigaction act;
+	::memset(&act, 0x00, sizeof(struct sigaction));
+	act.sa_handler = sigHandler;
+	::sigemptyset(&act.sa_mask);
+	::sigaction(SIGINT, &act, NULL);
+	::sigaction(SIGTERM, &act, NULL);
+
+	::fprintf(stdout, "AMBESERVER: listening on UDP port %u\n", m_udpPort);
+	::fflush(stdout);
+
+	int ret = 0;
+
+	while (stopping == 0) {
+		struct epoll_event events[2U];
+		int n = ::epoll_wait(epfd, events, 2, 100);
+		if (n < 0 && errno != EINTR) {
+			::fprintf(stderr, "AMBESERVER: error from epoll_wait, err=%d\n", errno);
+			ret = 1;
+			break;
+		}
+
+		for (int i = 0; i < n; i++) {
+			if (events[i].data.fd == m_fd) {
+				readSocket();
+			} else if (!readChip()) {
+				ret = 1;
+				stopping = 1;
+			}
+		}
+
+		checkTimeout();
+
+		sendToChip();
+	}
+
+	::fprintf(stdout, "AMBESERVER: stopping\n");
+
+	::close(epfd);
+	::close(m_fd);
+	m_chip.close();
+
+	return ret;
+}
+
+// Without an address given, the wildcard address that the system prefers
+bool CAMBESERVER::openSocket()
+{
+	struct addrinfo hints;
+	::memset(&hints, 0x00, sizeof(struct addrinfo));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags    = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+
+	char service[10U];
+	::sprintf(service, "%u", m_udpPort);
+
+	struct addrinfo* res = NULL;
+	int err = ::getaddrinfo(m_address.empty() ? NULL : m_address.c_str(), service, &hints, &res);
+	if (err != 0 || res == NULL) {
+		::fprintf(stderr, "AMBESERVER: invalid address %s, %s\n", m_address.c_str(), ::gai_strerror(err));
+		return false;
+	}
+
+	m_fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (m_fd < 0) {
+		::fprintf(stderr, "AMBESERVER: cannot create the socket, err=%d\n", errno);
+		::freeaddrinfo(res);
+		return false;
+	}
+
+	if (::bind(m_fd, res->ai_addr, res->ai_addrlen) < 0) {
+		::fprintf(stderr, "AMBESERVER: cannot bind to UDP port %u, err=%d\n", m_udpPort, errno);
+		::freeaddrinfo(res);
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+
+	::freeaddrinfo(res);
+
+	return true;
+}
+
+// Every packet from the clients is queued, in order of arrival, for the chip
+void CAMBESERVER::readSocket()
+{
+	for (;;) {
+		CAMBERequest* request = allocate();
+
+		request->m_addrLen = sizeof(sockaddr_storage);
+		ssize_t len = ::recvfrom(m_fd, request->m_packet, AMBE_PACKET_LENGTH, MSG_DONTWAIT, (struct sockaddr*)&request->m_addr, &request->m_addrLen);
+		if (len <= 0) {
+			release(request);
+			return;
+		}
+
+		request->m_length = (unsigned int)len;
+
+		CTrace::event(TRACE_FRAME_IN, request->m_packet, request->m_length);
+
+		// Only whole DV3000 packets are passed on
+		if (request->m_length < DV3000_HEADER_LEN || request->m_packet[0U] != DV3000_START_BYTE ||
+		    (request->m_packet[1U] & 0x0FU) * 256U + request->m_packet[2U] + DV3000_HEADER_LEN != request->m_length) {
+			::fprintf(stderr, "AMBESERVER: invalid packet of %u bytes received, dropping\n", request->m_length);
+			CMetrics::add(COUNTER_DV3000_DROPPED);
+			release(request);
+			continue;
+		}
+
+		if (m_waiting.size() >= MAX_WAITING) {
+			::fprintf(stderr, "AMBESERVER: too many packets waiting for the chip, dropping\n");
+			CMetrics::add(COUNTER_DV3000_DROPPED);
+			release(request);
+			continue;
+		}
+
+		CMetrics::add(COUNTER_FRAMES_IN);
+
+		m_waiting.push_back(request);
+	}
+}
+
+// The chip answers the packets in the order that they were sent, so each
+// answer goes to the sender of the oldest packet in flight. The answer to the
+// product id written after each packet shows where the answer to that packet
+// ends, so a packet that the chip loses is found and dropped rather than every
+// later answer going to the wrong client
+bool CAMBESERVER::readChip()
+{
+	for (;;) {
+		unsigned char buffer[AMBE_PACKET_LENGTH];
+		int len = m_chip.readPacket(buffer, AMBE_PACKET_LENGTH);
+		if (len < 0)
+			return false;
+		if (len == 0)
+			return true;
+
+		bool marker = isControl(buffer, len, DV3000_CONTROL_PRODID);
+
+		if (m_syncing) {
+			// The answers to the packets given up on, which have no one to go to
+			if (isControl(buffer, len, DV3000_CONTROL_VERSTRING))
+				m_syncing = false;
+		} else if (!m_inFlight.empty()) {
+			CAMBERequest* request = m_inFlight.front();
+
+			if (!request->m_answered) {
+				if (marker && !isControl(request->m_packet, request->m_length, DV3000_CONTROL_PRODID)) {
+					::fprintf(stderr, "AMBESERVER: the chip lost a packet, dropping\n");
+					CMetrics::add(COUNTER_DV3000_DROPPED);
+
+					m_inFlight.pop_front();
+					release(request);
+					continue;
+				}
+
+				CTrace::event(TRACE_FRAME_OUT, buffer, len);
+
+				::sendto(m_fd, buffer, len, 0, (struct sockaddr*)&request->m_addr, request->m_addrLen);
+
+				CMetrics::stop(STAGE_SERIAL, request->m_start);
+				CMetrics::add(COUNTER_FRAMES_OUT);
+
+				m_lastAddr    = request->m_addr;
+				m_lastAddrLen = request->m_addrLen;
+
+				request->m_answered = true;
+			} else if (marker) {
+				m_inFlight.pop_front();
+				release(request);
+			} else {
+				::fprintf(stderr, "AMBESERVER: unexpected answer from the chip, resynchronising\n");
+				resync();
+			}
+		} else if (m_lastAddrLen > 0U) {
+			// Such as the chip announcing that it is ready after a reset
+			::sendto(m_fd, buffer, len, 0, (struct sockaddr*)&m_lastAddr, m_lastAddrLen);
+		}
+	}
+}
+
+void CAMBESERVER::sendToChip()
+{
+	while (!m_syncing && !m_waiting.empty() && m_inFlight.size() < MAX_IN_FLIGHT) {
+		CAMBERequest* request = m_waiting.front();
+		m_waiting.pop_front();
+
+		if (!m_chip.writePacket(request->m_packet, request->m_length) ||
+		    !m_chip.writePacket(DV3000_REQ_PRODID, DV3000_REQ_PRODID_LEN)) {
+			::fprintf(stderr, "AMBESERVER: could not write to the chip, dropping\n");
+			release(request);
+			resync();
+			continue;
+		}
+
+		request->m_answered = false;
+		request->m_sent     = now();
+		request->m_start    = CMetrics::start();
+
+		m_inFlight.push_back(request);
+	}
+}
+
+// An answer that arrives after its packet has been given up on would
+// otherwise go to the client of the next packet
+void CAMBESERVER::checkTimeout()
+{
+	uint64_t ms = now();
+
+	if (m_syncing) {
+		if ((ms - m_syncSent) >= RESPONSE_TIMEOUT_MS) {
+			::fprintf(stderr, "AMBESERVER: no answer from the chip, resynchronising again\n");
+			resync();
+		}
+	} else if (!m_inFlight.empty() && (ms - m_inFlight.front()->m_sent) >= RESPONSE_TIMEOUT_MS) {
+		::fprintf(stderr, "AMBESERVER: no answer from the chip, dropping\n");
+		resync();
+	}
+}
+
+// Every packet in flight is dropped, and nothing more is written to the chip
+// until it has answered the version string request written here
+void CAMBESERVER::resync()
+{
+	while (!m_inFlight.empty()) {
+		CMetrics::add(COUNTER_DV3000_DROPPED);
+
+		release(m_inFlight.front());
+		m_inFlight.pop_front();
+	}
+
+	CMetrics::add(COUNTER_DV3000_RESYNCED);
+
+	m_chip.writePacket(DV3000_REQ_VERSTRING, DV3000_REQ_VERSTRING_LEN);
+
+	m_syncing  = true;
+	m_syncSent = now();
+}
+
+CAMBERequest* CAMBESERVER::allocate()
+{
+	if (m_free.empty())
+		return new CAMBERequest;
+
+	CAMBERequest* request = m_free.back();
+	m_free.pop_back();
+
+	return request;
+}
+
+void CAMBESERVER::release(CAMBERequest* request)
+{
+	assert(request != NULL);
+
+	m_free.push_back(request);
+}
@@ -0,0 +1,80 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(AMBESERVER_H)
+#define	AMBESERVER_H
+
+#include "DV3000SerialController.h"
+
+#include <string>
+#include <deque>
+
+#include <cstdint>
+
+#include <sys/socket.h>
+
+// The longest packet passed on in either direction
+const unsigned int AMBE_PACKET_LENGTH = 400U;
+
+// A packet from a client waiting to be sent to the chip, or for the
+// chip's answer to it
+struct CAMBERequest {
+	sockaddr_storage m_addr;
+	socklen_t        m_addrLen;
+	unsigned char    m_packet[AMBE_PACKET_LENGTH];
+	unsigned int     m_length;
+	bool             m_answered;
+	uint64_t         m_sent;
+	uint64_t         m_start;
+};
+
+class CAMBESERVER
+{
+public:
+	CAMBESERVER(const std::string& port, unsigned int speed, const std::string& address, unsigned int udpPort, bool reset, bool debug);
+	~CAMBESERVER();
+
+	int run();
+
+private:
+	std::string                 m_address;
+	unsigned int                m_udpPort;
+	bool                        m_debug;
+	CDV3000SerialController     m_chip;
+	int                         m_fd;
+	std::deque<CAMBERequest*>   m_waiting;
+	std::deque<CAMBERequest*>   m_inFlight;
+	std::deque<CAMBERequest*>   m_free;
+	sockaddr_storage            m_lastAddr;
+	socklen_t                   m_lastAddrLen;
+	bool                        m_syncing;
+	uint64_t                    m_syncSent;
+
+	bool openSocket();
+
+	void readSocket();
+	bool readChip();
+	void sendToChip();
+	void checkTimeout();
+	void resync();
+
+	CAMBERequest* allocate();
+	void release(CAMBERequest* request);
+};
+
+#endif
@@ -0,0 +1,249 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "AMBETRACE.h"
+
+#include "Metrics.h"
+#include "Version.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+const char* TYPE_NAMES[] = {"unknown", "packet_tx", "packet_rx", "frame_in", "frame_out", "audio_in", "audio_out", "stage"};
+
+#if defined(_WIN32) || defined(_WIN64)
+char* optarg = NULL;
+int optind = 1;
+
+int getopt(int argc, char* const argv[], const char* optstring)
+{
+	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][1] == 0))
+		return -1;
+
+	int opt = argv[optind][1];
+	const char *p = strchr(optstring, opt);
+
+	if (p == NULL) {
+		return '?';
+	}
+
+	if (p[1] == ':') {
+		optind++;
+		if (optind >= argc)
+			return '?';
+
+		optarg = argv[optind];
+	}
+
+	optind++;
+
+	return opt;
+}
+#else
+#include <unistd.h>
+#endif
+
+int main(int argc, char** argv)
+{
+	bool chrome = false;
+
+	int c;
+	while ((c = ::getopt(argc, argv, "cv")) != -1) {
+		switch (c) {
+		case 'c':
+			chrome = true;
+			break;
+		case 'v':
+			printf("Version: %s\n", version);
+			return 0;
+		case '?':
+			break;
+		default:
+			fprintf(stderr, "Usage: AMBETRACE [-v] [-c] <trace>\n");
+			break;
+		}
+	}
+
+	if (optind > (argc - 1)) {
+		fprintf(stderr, "Usage: AMBETRACE [-v] [-c] <trace>\n");
+		return 1;
+	}
+
+	CAMBETRACE* ambetrace = new CAMBETRACE(chrome, std::string(argv[argc - 1]));
+
+	int ret = ambetrace->run();
+
+	delete ambetrace;
+
+	return ret;
+}
+
+CAMBETRACE::CAMBETRACE(bool chrome, const std::string& input) :
+m_chrome(chrome),
+m_input(input),
+m_records()
+{
+}
+
+CAMBETRACE::~CAMBETRACE()
+{
+}
+
+int CAMBETRACE::run()
+{
+	if (!readFile())
+		return 1;
+
+	// The events are written out a ring at a time, so they are put back into time order
+	std::stable_sort(m_records.begin(), m_records.end(), [](const CTraceRecord& a, const CTraceRecord& b) { return a.m_time < b.m_time; });
+
+	if (m_chrome)
+		writeChrome(stdout);
+	else
+		writeText(stdout);
+
+	return 0;
+}
+
+bool CAMBETRACE::readFile()
+{
+	FILE* fp = ::fopen(m_input.c_str(), "rb");
+	if (fp == NULL) {
+		::fprintf(stderr, "AMBETRACE: could not open the trace file %s\n", m_input.c_str());
+		return false;
+	}
+
+	uint8_t header[TRACE_HEADER_LENGTH];
+	if (::fread(header, 1U, TRACE_HEADER_LENGTH, fp) != TRACE_HEADER_LENGTH || ::memcmp(header, TRACE_MAGIC, 4U) != 0) {
+		::fprintf(stderr, "AMBETRACE: %s is not a trace file\n", m_input.c_str());
+		::fclose(fp);
+		return false;
+	}
+
+	if (header[4U] != TRACE_VERSION) {
+		::fprintf(stderr, "AMBETRACE: %s is version %u of the trace format, only %u is understood\n", m_input.c_str(), header[4U], TRACE_VERSION);
+		::fclose(fp);
+		return false;
+	}
+
+	uint8_t buffer[TRACE_EVENT_LENGTH];
+	while (::fread(buffer, 1U, TRACE_EVENT_LENGTH, fp) == TRACE_EVENT_LENGTH) {
+		CTraceRecord record;
+
+		record.m_time = 0U;
+		for (unsigned int i = 0U; i < 8U; i++)
+			record.m_time |= uint64_t(buffer[i]) << (i * 8U);
+
+		record.m_thread = (unsigned int)buffer[8U] | ((unsigned int)buffer[9U] << 8);
+		record.m_type   = buffer[10U];
+		record.m_stage  = buffer[11U];
+		record.m_length = (unsigned int)buffer[12U] | ((unsigned int)buffer[13U] << 8);
+
+		::memcpy(record.m_data, buffer + 16U, TRACE_DATA_LENGTH);
+
+		m_records.push_back(record);
+	}
+
+	::fclose(fp);
+
+	return true;
+}
+
+// One line per event, the time in ms from the first event
+void CAMBETRACE::writeText(FILE* fp) const
+{
+	assert(fp != NULL);
+
+	uint64_t first = m_records.empty() ? 0U : m_records.front().m_time;
+
+	for (std::vector<CTraceRecord>::const_iterator it = m_records.begin(); it != m_records.end(); ++it) {
+		const CTraceRecord& record = *it;
+
+		double ms = double(record.m_time - first) / 1.0E6;
+
+		if (record.m_type == TRACE_STAGE) {
+			uint64_t ns = 0U;
+			for (unsigned int i = 0U; i < 8U; i++)
+				ns |= uint64_t(record.m_data[i]) << (i * 8U);
+
+			const char* name = CMetrics::getStageName(record.m_stage);
+
+			::fprintf(fp, "%12.3f  %3u  %-9s  %-7s  %.3fms\n", ms, record.m_thread, "stage", (name != NULL) ? name : "unknown", double(ns) / 1.0E6);
+		} else {
+			const char* type = (record.m_type < TRACE_STAGE) ? TYPE_NAMES[record.m_type] : TYPE_NAMES[0U];
+
+			::fprintf(fp, "%12.3f  %3u  %-9s  %5u    %s\n", ms, record.m_thread, type, record.m_length, getData(record).c_str());
+		}
+	}
+}
+
+// The Chrome trace event format, for chrome://tracing or Perfetto, where
+// the stages are complete events and the rest are instant events
+void CAMBETRACE::writeChrome(FILE* fp) const
+{
+	assert(fp != NULL);
+
+	uint64_t first = m_records.empty() ? 0U : m_records.front().m_time;
+
+	::fprintf(fp, "{\"traceEvents\":[\n");
+
+	for (std::vector<CTraceRecord>::const_iterator it = m_records.begin(); it != m_records.end(); ++it) {
+		const CTraceRecord& record = *it;
+
+		double us = double(record.m_time - first) / 1.0E3;
+		const char* separator = (it + 1 != m_records.end()) ? "," : "";
+
+		if (record.m_type == TRACE_STAGE) {
+			uint64_t ns = 0U;
+			for (unsigned int i = 0U; i < 8U; i++)
+				ns |= uint64_t(record.m_data[i]) << (i * 8U);
+
+			const char* name = CMetrics::getStageName(record.m_stage);
+
+			::fprintf(fp, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}%s\n",
+				(name != NULL) ? name : "unknown", us, double(ns) / 1.0E3, record.m_thread, separator);
+		} else {
+			const char* type = (record.m_type < TRACE_STAGE) ? TYPE_NAMES[record.m_type] : TYPE_NAMES[0U];
+
+			::fprintf(fp, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"length\":%u,\"data\":\"%s\"}}%s\n",
+				type, us, record.m_thread, record.m_length, getData(record).c_str(), separator);
+		}
+	}
+
+	::fprintf(fp, "]}\n");
+}
+
+// The bytes which were kept, in hex
+std::string CAMBETRACE::getData(const CTraceRecord& record) const
+{
+	unsigned int length = (record.m_length < TRACE_DATA_LENGTH) ? record.m_length : TRACE_DATA_LENGTH;
+
+	std::string text;
+	for (unsigned int i = 0U; i < length; i++) {
+		char temp[4U];
+		::snprintf(temp, sizeof(temp), "%s%02X", (i > 0U) ? " " : "", record.m_data[i]);
+		text += temp;
+	}
+
+	if (record.m_length > TRACE_DATA_LENGTH)
+		text += " ...";
+
+	return text;
+}
@@ -0,0 +1,60 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(AMBETRACE_H)
+#define	AMBETRACE_H
+
+#include "Trace.h"
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+#include <cstdio>
+
+struct CTraceRecord {
+	uint64_t     m_time;
+	unsigned int m_thread;
+	unsigned int m_type;
+	unsigned int m_stage;
+	unsigned int m_length;
+	uint8_t      m_data[TRACE_DATA_LENGTH];
+};
+
+class CAMBETRACE
+{
+public:
+	CAMBETRACE(bool chrome, const std::string& input);
+	~CAMBETRACE();
+
+	int run();
+
+private:
+	bool                      m_chrome;
+	std::string               m_input;
+	std::vector<CTraceRecord> m_records;
+
+	bool readFile();
+
+	void writeText(FILE* fp) const;
+	void writeChrome(FILE* fp) const;
+
+	std::string getData(const CTraceRecord& record) const;
+};
+
+#endif
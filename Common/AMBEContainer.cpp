@@ -0,0 +1,104 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "AMBEContainer.h"
+#include "Vocoder.h"
+
+#include <cassert>
+#include <cstring>
+
+void CAMBEContainer::setUInt16(uint8_t* p, uint16_t value)
+{
+	assert(p != NULL);
+
+	p[0U] = (value >> 0) & 0xFFU;
+	p[1U] = (value >> 8) & 0xFFU;
+}
+
+void CAMBEContainer::setUInt32(uint8_t* p, uint32_t value)
+{
+	assert(p != NULL);
+
+	setUInt16(p + 0U, value & 0xFFFFU);
+	setUInt16(p + 2U, value >> 16);
+}
+
+void CAMBEContainer::setUInt64(uint8_t* p, uint64_t value)
+{
+	assert(p != NULL);
+
+	setUInt32(p + 0U, uint32_t(value & 0xFFFFFFFFU));
+	setUInt32(p + 4U, uint32_t(value >> 32));
+}
+
+uint16_t CAMBEContainer::getUInt16(const uint8_t* p)
+{
+	assert(p != NULL);
+
+	return uint16_t(p[0U] | (p[1U] << 8));
+}
+
+uint32_t CAMBEContainer::getUInt32(const uint8_t* p)
+{
+	assert(p != NULL);
+
+	return uint32_t(getUInt16(p + 0U)) | (uint32_t(getUInt16(p + 2U)) << 16);
+}
+
+uint64_t CAMBEContainer::getUInt64(const uint8_t* p)
+{
+	assert(p != NULL);
+
+	return uint64_t(getUInt32(p + 0U)) | (uint64_t(getUInt32(p + 4U)) << 32);
+}
+
+void CAMBEContainer::encodeSegment(uint8_t* p, const CAMBESegment& segment)
+{
+	assert(p != NULL);
+
+	::memcpy(p + 0U, AMBE_SEGMENT_MAGIC, 4U);
+	p[4U] = uint8_t(segment.m_mode);
+	p[5U] = segment.m_fec ? 1U : 0U;
+	setUInt16(p + 6U,  uint16_t(segment.m_frameSize));
+	setUInt16(p + 8U,  uint16_t(segment.m_frameMs));
+	setUInt16(p + 10U, segment.m_timestamps ? AMBE_CONTAINER_TIMESTAMPS : 0U);
+	setUInt32(p + 12U, segment.m_frames);
+	setUInt64(p + 16U, segment.m_startTime);
+}
+
+bool CAMBEContainer::decodeSegment(const uint8_t* p, CAMBESegment& segment)
+{
+	assert(p != NULL);
+
+	if (::memcmp(p + 0U, AMBE_SEGMENT_MAGIC, 4U) != 0)
+		return false;
+
+	segment.m_mode       = p[4U];
+	segment.m_fec        = p[5U] != 0U;
+	segment.m_frameSize  = getUInt16(p + 6U);
+	segment.m_frameMs    = getUInt16(p + 8U);
+	segment.m_timestamps = (getUInt16(p + 10U) & AMBE_CONTAINER_TIMESTAMPS) != 0U;
+	segment.m_frames     = getUInt32(p + 12U);
+	segment.m_startTime  = getUInt64(p + 16U);
+
+	// A mode from a newer version can't be decoded
+	if (segment.m_mode >= MODE_UNKNOWN)
+		return false;
+
+	return segment.m_frameSize > 0U && segment.m_frameMs > 0U;
+}
@@ -0,0 +1,94 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	AMBEContainer_H
+#define	AMBEContainer_H
+
+#include <cstdint>
+
+// The AMBE container format, all values are little endian.
+//
+// File header, 8 bytes:
+//   "AMBC", version (1 byte), 3 reserved bytes
+//
+// Then one or more calls, each one a segment of:
+//   "SEGM"                                 4 bytes
+//   mode (AMBE_MODE)                       1 byte
+//   FEC flag                               1 byte
+//   frame size in bytes                    2 bytes
+//   frame duration in ms                   2 bytes
+//   flags (AMBE_CONTAINER_TIMESTAMPS)      2 bytes
+//   frame count, 0xFFFFFFFF if unknown     4 bytes
+//   start time in ms since 1970, or 0      8 bytes
+//   the frames                             count * size bytes
+//   optional frame timestamps, ms from the start of the call, 4 bytes each
+//
+// Then the index:
+//   "INDX", segment count                  8 bytes
+//   per segment: file offset (8), start time (8), frame count (4), duration in ms (4)
+//
+// And finally the trailer, the last 12 bytes of the file:
+//   index offset (8), "CEND"
+//
+// A container written to a stream has a single call of unknown length and no
+// index, it is read until the end of the stream.
+
+const uint8_t  AMBE_CONTAINER_MAGIC[]   = {'A', 'M', 'B', 'C'};
+const uint8_t  AMBE_SEGMENT_MAGIC[]     = {'S', 'E', 'G', 'M'};
+const uint8_t  AMBE_INDEX_MAGIC[]       = {'I', 'N', 'D', 'X'};
+const uint8_t  AMBE_TRAILER_MAGIC[]     = {'C', 'E', 'N', 'D'};
+
+const uint8_t  AMBE_CONTAINER_VERSION   = 1U;
+
+const unsigned int AMBE_CONTAINER_HEADER_LENGTH = 8U;
+const unsigned int AMBE_SEGMENT_HEADER_LENGTH   = 24U;
+const unsigned int AMBE_INDEX_HEADER_LENGTH     = 8U;
+const unsigned int AMBE_INDEX_ENTRY_LENGTH      = 24U;
+const unsigned int AMBE_TRAILER_LENGTH          = 12U;
+
+const uint16_t AMBE_CONTAINER_TIMESTAMPS = 0x0001U;
+
+const uint32_t AMBE_CONTAINER_UNKNOWN_COUNT = 0xFFFFFFFFU;
+
+struct CAMBESegment {
+	unsigned int m_mode;
+	bool         m_fec;
+	unsigned int m_frameSize;
+	unsigned int m_frameMs;
+	bool         m_timestamps;
+	uint32_t     m_frames;
+	uint64_t     m_startTime;
+	uint64_t     m_offset;
+	uint32_t     m_duration;
+};
+
+class CAMBEContainer {
+public:
+	static void     setUInt16(uint8_t* p, uint16_t value);
+	static void     setUInt32(uint8_t* p, uint32_t value);
+	static void     setUInt64(uint8_t* p, uint64_t value);
+
+	static uint16_t getUInt16(const uint8_t* p);
+	static uint32_t getUInt32(const uint8_t* p);
+	static uint64_t getUInt64(const uint8_t* p);
+
+	static void     encodeSegment(uint8_t* p, const CAMBESegment& segment);
+	static bool     decodeSegment(const uint8_t* p, CAMBESegment& segment);
+};
+
+#endif
@@ -1,5 +1,5 @@
 /*
-*   Copyright (C) 2017,2018 by Jonathan Naylor G4KLX
+*   Copyright (C) 2017,2018,2026 by Jonathan Naylor G4KLX
 *
 *   This program is free software; you can redistribute it and/or modify
 *   it under the terms of the GNU General Public License as published by
@@ -17,13 +17,40 @@
 */
 
 #include "AMBEFileReader.h"
+#include "Utils.h"
+
+#include <algorithm>
 
 #include <cassert>
+#include <cstring>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const uint64_t AMBE_UNKNOWN_LENGTH = UINT64_MAX;
 
 CAMBEFileReader::CAMBEFileReader(const std::string& fileName, const std::string& signature) :
 m_fileName(fileName),
 m_signature(signature),
-m_fp(NULL)
+m_fp(NULL),
+m_data(NULL),
+m_size(0U),
+m_offset(0U),
+m_pos(0U),
+m_pending(),
+m_container(false),
+m_indexed(false),
+m_selected(false),
+m_calls(),
+m_current(-1),
+m_left(0U),
+m_skip(0U),
+m_total(0U),
+m_dvtool(NULL)
 {
 }
 
@@ -33,15 +60,41 @@ CAMBEFileReader::~CAMBEFileReader()
 
 bool CAMBEFileReader::open()
 {
-	m_fp = ::fopen(m_fileName.c_str(), "rb");
-	if (m_fp == NULL) {
-		::fprintf(stderr, "AMBEFileReader: could not open the AMBE file %s\n", m_fileName.c_str());
-		return false;
+	if (m_fileName == STREAM_NAME) {
+		m_fp = CUtils::getStdin();
+	} else if (!map()) {
+		m_fp = ::fopen(m_fileName.c_str(), "rb");
+		if (m_fp == NULL) {
+			::fprintf(stderr, "AMBEFileReader: could not open the AMBE file %s\n", m_fileName.c_str());
+			return false;
+		}
+	}
+
+	// Look for a container or a DV-Tool file, if it isn't one the bytes are read again below
+	uint8_t magic[DVTOOL_SIGNATURE_LENGTH];
+	unsigned int n = rawRead(magic, 4U);
+	if (n == 4U && ::memcmp(magic, AMBE_CONTAINER_MAGIC, 4U) == 0) {
+		if (!openContainer()) {
+			close();
+			return false;
+		}
+
+		return true;
 	}
 
+	if (n == 4U && ::memcmp(magic, "DVTO", 4U) == 0)
+		n += rawRead(magic + 4U, DVTOOL_SIGNATURE_LENGTH - 4U);
+
+	if (CDVTOOLFileReader::isDVTOOL(magic, n))
+		return openDVTOOL(magic, n);
+
+	// Standard input can't be rewound
+	if (!rawSeek(0U))
+		m_pending.assign((char*)magic, n);
+
 	if (!m_signature.empty()) {
-		char buffer[25U];
-		unsigned int n = ::fread(buffer, sizeof(uint8_t), m_signature.size(), m_fp);
+		std::string buffer(m_signature.size(), ' ');
+		n = rawRead((uint8_t*)&buffer[0], m_signature.size());
 
 		if (n != m_signature.size()) {
 			::fprintf(stderr, "AMBEFileReader: the file signature is not present\n");
@@ -49,30 +102,528 @@ bool CAMBEFileReader::open()
 			return false;
 		}
 
-		if (m_signature != std::string(buffer, m_signature.size())) {
+		if (m_signature != buffer) {
 			::fprintf(stderr, "AMBEFileReader: the file signature didn't match the one specified\n");
 			close();
 			return false;
 		}
 	}
 
+	m_offset = m_pos;
+
+	return true;
+}
+
+bool CAMBEFileReader::openDVTOOL(const uint8_t* data, unsigned int length)
+{
+	// Only standard input can't simply be opened again from the start
+	bool stream = m_fileName == STREAM_NAME;
+	if (stream)
+		m_fp = NULL;
+	else
+		close();
+
+	m_dvtool = new CDVTOOLFileReader(m_fileName);
+
+	bool ret = stream ? m_dvtool->open(data, length) : m_dvtool->open();
+
+	if (!ret) {
+		delete m_dvtool;
+		m_dvtool = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool CAMBEFileReader::openContainer()
+{
+	m_container = true;
+
+	uint8_t header[AMBE_CONTAINER_HEADER_LENGTH - 4U];
+	if (rawRead(header, AMBE_CONTAINER_HEADER_LENGTH - 4U) != AMBE_CONTAINER_HEADER_LENGTH - 4U) {
+		::fprintf(stderr, "AMBEFileReader: the container header is incomplete\n");
+		return false;
+	}
+
+	if (header[0U] != AMBE_CONTAINER_VERSION) {
+		::fprintf(stderr, "AMBEFileReader: unsupported container version %u\n", header[0U]);
+		return false;
+	}
+
+	// Standard input is read one call at a time, see nextCall(), the first
+	// is read now so that its mode is known
+	if (m_fileName == STREAM_NAME) {
+		nextCall();
+		return true;
+	}
+
+	if (!readIndex() && !scanCalls())
+		return false;
+
+	m_indexed = true;
+
+	m_total = 0U;
+	for (std::vector<CAMBESegment>::const_iterator it = m_calls.begin(); it != m_calls.end() && isCompatible(*it); ++it)
+		m_total += uint64_t(it->m_frames) * it->m_frameSize;
+
+	return true;
+}
+
+bool CAMBEFileReader::readIndex()
+{
+	uint64_t size = rawSize();
+	if (size < AMBE_CONTAINER_HEADER_LENGTH + AMBE_INDEX_HEADER_LENGTH + AMBE_TRAILER_LENGTH)
+		return false;
+
+	uint8_t trailer[AMBE_TRAILER_LENGTH];
+	if (!rawSeek(size - AMBE_TRAILER_LENGTH) || rawRead(trailer, AMBE_TRAILER_LENGTH) != AMBE_TRAILER_LENGTH)
+		return false;
+
+	if (::memcmp(trailer + 8U, AMBE_TRAILER_MAGIC, 4U) != 0)
+		return false;
+
+	uint8_t header[AMBE_INDEX_HEADER_LENGTH];
+	if (!rawSeek(CAMBEContainer::getUInt64(trailer)) || rawRead(header, AMBE_INDEX_HEADER_LENGTH) != AMBE_INDEX_HEADER_LENGTH)
+		return false;
+
+	if (::memcmp(header, AMBE_INDEX_MAGIC, 4U) != 0)
+		return false;
+
+	uint32_t count = CAMBEContainer::getUInt32(header + 4U);
+
+	std::vector<uint8_t> entries(count * AMBE_INDEX_ENTRY_LENGTH);
+	if (count > 0U && rawRead(&entries[0U], count * AMBE_INDEX_ENTRY_LENGTH) != count * AMBE_INDEX_ENTRY_LENGTH)
+		return false;
+
+	m_calls.clear();
+
+	for (uint32_t i = 0U; i < count; i++) {
+		const uint8_t* entry = &entries[i * AMBE_INDEX_ENTRY_LENGTH];
+
+		uint8_t buffer[AMBE_SEGMENT_HEADER_LENGTH];
+		CAMBESegment call;
+		call.m_offset = CAMBEContainer::getUInt64(entry + 0U);
+		if (!rawSeek(call.m_offset) || rawRead(buffer, AMBE_SEGMENT_HEADER_LENGTH) != AMBE_SEGMENT_HEADER_LENGTH || !CAMBEContainer::decodeSegment(buffer, call)) {
+			::fprintf(stderr, "AMBEFileReader: the container index is corrupt\n");
+			return false;
+		}
+
+		call.m_offset   = CAMBEContainer::getUInt64(entry + 0U);
+		call.m_duration = CAMBEContainer::getUInt32(entry + 20U);
+		m_calls.push_back(call);
+	}
+
+	return true;
+}
+
+// For a container without an index, one that was written to a stream or not closed
+bool CAMBEFileReader::scanCalls()
+{
+	uint64_t size = rawSize();
+	uint64_t pos  = AMBE_CONTAINER_HEADER_LENGTH;
+
+	m_calls.clear();
+
+	while (pos + AMBE_SEGMENT_HEADER_LENGTH <= size) {
+		uint8_t buffer[AMBE_SEGMENT_HEADER_LENGTH];
+		if (!rawSeek(pos) || rawRead(buffer, AMBE_SEGMENT_HEADER_LENGTH) != AMBE_SEGMENT_HEADER_LENGTH)
+			break;
+
+		CAMBESegment call;
+		if (!CAMBEContainer::decodeSegment(buffer, call))
+			break;
+
+		call.m_offset = pos;
+
+		uint64_t data = size - pos - AMBE_SEGMENT_HEADER_LENGTH;
+		if (call.m_frames == AMBE_CONTAINER_UNKNOWN_COUNT || uint64_t(call.m_frames) * call.m_frameSize > data)
+			call.m_frames = uint32_t(data / call.m_frameSize);
+
+		call.m_duration = call.m_frames * call.m_frameMs;
+		m_calls.push_back(call);
+
+		pos += AMBE_SEGMENT_HEADER_LENGTH + uint64_t(call.m_frames) * call.m_frameSize;
+		if (call.m_timestamps)
+			pos += uint64_t(call.m_frames) * 4U;
+	}
+
+	if (m_calls.empty()) {
+		::fprintf(stderr, "AMBEFileReader: the container has no calls\n");
+		return false;
+	}
+
 	return true;
 }
 
 unsigned int CAMBEFileReader::read(uint8_t* buffer, unsigned int length)
 {
-	assert(m_fp != NULL);
+	assert(m_fp != NULL || m_data != NULL || m_dvtool != NULL);
 	assert(buffer != NULL);
 	assert(length > 0U);
 
-	return (unsigned int)::fread(buffer, sizeof(uint8_t), length, m_fp);
+	if (m_dvtool != NULL)
+		return m_dvtool->read(buffer, length);
+
+	if (!m_container)
+		return rawRead(buffer, length);
+
+	unsigned int n = 0U;
+
+	while (n < length) {
+		if (m_left == 0U) {
+			if (!nextCall())
+				break;
+			continue;
+		}
+
+		unsigned int len = length - n;
+		if (m_left != AMBE_UNKNOWN_LENGTH && m_left < len)
+			len = (unsigned int)m_left;
+
+		unsigned int count = rawRead(buffer + n, len);
+		if (count == 0U)
+			break;
+
+		n += count;
+
+		if (m_left != AMBE_UNKNOWN_LENGTH)
+			m_left -= count;
+	}
+
+	return n;
+}
+
+bool CAMBEFileReader::nextCall()
+{
+	if (m_selected)
+		return false;
+
+	if (m_indexed) {
+		unsigned int next = (unsigned int)(m_current + 1);
+		if (next >= m_calls.size())
+			return false;
+
+		if (!isCompatible(m_calls[next])) {
+			::fprintf(stderr, "AMBEFileReader: call %u has a different mode or frame size, stopping\n", next);
+			return false;
+		}
+
+		if (!rawSeek(m_calls[next].m_offset + AMBE_SEGMENT_HEADER_LENGTH))
+			return false;
+
+		m_current = int(next);
+		m_left    = uint64_t(m_calls[next].m_frames) * m_calls[next].m_frameSize;
+
+		return true;
+	}
+
+	// On standard input, a call of unknown length runs to the end of the stream
+	if (m_current >= 0 && m_calls[m_current].m_frames == AMBE_CONTAINER_UNKNOWN_COUNT)
+		return false;
+
+	if (!rawSkip(m_skip))
+		return false;
+
+	uint8_t buffer[AMBE_SEGMENT_HEADER_LENGTH];
+	if (rawRead(buffer, AMBE_SEGMENT_HEADER_LENGTH) != AMBE_SEGMENT_HEADER_LENGTH)
+		return false;
+
+	// Which will fail at the index
+	CAMBESegment call;
+	if (!CAMBEContainer::decodeSegment(buffer, call))
+		return false;
+
+	call.m_offset   = 0U;
+	call.m_duration = call.m_frames * call.m_frameMs;
+
+	if (!m_calls.empty() && !isCompatible(call)) {
+		::fprintf(stderr, "AMBEFileReader: call %u has a different mode or frame size, stopping\n", (unsigned int)m_calls.size());
+		return false;
+	}
+
+	m_calls.push_back(call);
+	m_current = int(m_calls.size()) - 1;
+
+	if (call.m_frames == AMBE_CONTAINER_UNKNOWN_COUNT) {
+		m_left = AMBE_UNKNOWN_LENGTH;
+		m_skip = 0U;
+	} else {
+		m_left = uint64_t(call.m_frames) * call.m_frameSize;
+		m_skip = call.m_timestamps ? uint64_t(call.m_frames) * 4U : 0U;
+	}
+
+	return true;
+}
+
+bool CAMBEFileReader::isCompatible(const CAMBESegment& call) const
+{
+	assert(!m_calls.empty());
+
+	const CAMBESegment& first = m_calls.front();
+
+	return call.m_mode == first.m_mode && call.m_fec == first.m_fec && call.m_frameSize == first.m_frameSize;
+}
+
+bool CAMBEFileReader::isContainer() const
+{
+	return m_container;
+}
+
+bool CAMBEFileReader::isDVTOOL() const
+{
+	return m_dvtool != NULL;
+}
+
+unsigned int CAMBEFileReader::getCallCount() const
+{
+	return (unsigned int)m_calls.size();
+}
+
+const CAMBESegment& CAMBEFileReader::getCall(unsigned int n) const
+{
+	assert(n < m_calls.size());
+
+	return m_calls[n];
+}
+
+bool CAMBEFileReader::select(unsigned int call, uint32_t startMs, uint32_t endMs)
+{
+	if (!m_container || !m_indexed) {
+		::fprintf(stderr, "AMBEFileReader: calls can only be selected in a container file\n");
+		return false;
+	}
+
+	if (call >= m_calls.size()) {
+		::fprintf(stderr, "AMBEFileReader: there is no call %u, the container has %u\n", call, (unsigned int)m_calls.size());
+		return false;
+	}
+
+	const CAMBESegment& segment = m_calls[call];
+
+	uint32_t first = findFrame(segment, startMs);
+	uint32_t last  = (endMs == 0U) ? segment.m_frames : findFrame(segment, endMs);
+	if (last < first)
+		last = first;
+
+	if (!rawSeek(segment.m_offset + AMBE_SEGMENT_HEADER_LENGTH + uint64_t(first) * segment.m_frameSize))
+		return false;
+
+	m_current  = int(call);
+	m_left     = uint64_t(last - first) * segment.m_frameSize;
+	m_total    = m_left;
+	m_selected = true;
+
+	return true;
+}
+
+// The first frame at or after the given time, a binary search of the
+// timestamps if there are any
+uint32_t CAMBEFileReader::findFrame(const CAMBESegment& call, uint32_t ms)
+{
+	if (!call.m_timestamps)
+		return std::min(call.m_frames, (ms + call.m_frameMs - 1U) / call.m_frameMs);
+
+	uint64_t table = call.m_offset + AMBE_SEGMENT_HEADER_LENGTH + uint64_t(call.m_frames) * call.m_frameSize;
+
+	uint32_t low  = 0U;
+	uint32_t high = call.m_frames;
+
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2U;
+
+		uint8_t buffer[4U];
+		if (!rawSeek(table + uint64_t(mid) * 4U) || rawRead(buffer, 4U) != 4U)
+			return call.m_frames;
+
+		if (CAMBEContainer::getUInt32(buffer) < ms)
+			low = mid + 1U;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+unsigned int CAMBEFileReader::rawRead(uint8_t* buffer, unsigned int length)
+{
+	unsigned int n = 0U;
+
+	// Anything read while looking for the container header
+	if (!m_pending.empty()) {
+		n = std::min(length, (unsigned int)m_pending.size());
+		::memcpy(buffer, m_pending.data(), n);
+		m_pending.erase(0U, n);
+
+		if (n == length)
+			return n;
+
+		buffer += n;
+		length -= n;
+	}
+
+	if (m_data != NULL) {
+		uint64_t left = m_size - m_pos;
+		if (left < length)
+			length = (unsigned int)left;
+
+		::memcpy(buffer, m_data + m_pos, length);
+		m_pos += length;
+
+		return n + length;
+	}
+
+	return n + (unsigned int)::fread(buffer, sizeof(uint8_t), length, m_fp);
+}
+
+bool CAMBEFileReader::rawSeek(uint64_t pos)
+{
+	m_pending.clear();
+
+	if (m_data != NULL) {
+		if (pos > m_size)
+			return false;
+
+		m_pos = pos;
+		return true;
+	}
+
+	if (m_fileName == STREAM_NAME)
+		return false;
+
+	if (pos > uint64_t(INT64_MAX))
+		return false;
+
+	return CUtils::seek(m_fp, int64_t(pos), SEEK_SET);
+}
+
+bool CAMBEFileReader::rawSkip(uint64_t length)
+{
+	uint8_t buffer[256U];
+
+	while (length > 0U) {
+		unsigned int n = (unsigned int)std::min<uint64_t>(length, 256U);
+
+		if (rawRead(buffer, n) != n)
+			return false;
+
+		length -= n;
+	}
+
+	return true;
+}
+
+uint64_t CAMBEFileReader::rawSize()
+{
+	if (m_data != NULL)
+		return m_size;
+
+	if (m_fileName == STREAM_NAME)
+		return 0U;
+
+	int64_t pos = CUtils::tell(m_fp);
+
+	CUtils::seek(m_fp, 0, SEEK_END);
+	int64_t size = CUtils::tell(m_fp);
+
+	CUtils::seek(m_fp, pos, SEEK_SET);
+
+	return (size < 0) ? 0U : uint64_t(size);
+}
+
+bool CAMBEFileReader::isMapped() const
+{
+	return m_data != NULL;
+}
+
+uint64_t CAMBEFileReader::frames(unsigned int length) const
+{
+	assert(length > 0U);
+
+	if (m_container)
+		return m_indexed ? m_total / length : 0U;
+
+	if (m_data == NULL)
+		return 0U;
+
+	return (m_size - m_offset) / length;
+}
+
+const uint8_t* CAMBEFileReader::frame(unsigned int length, uint64_t n) const
+{
+	assert(length > 0U);
+
+	if (m_container || m_data == NULL || n >= frames(length))
+		return NULL;
+
+	return m_data + m_offset + n * length;
 }
 
 void CAMBEFileReader::close()
 {
-	assert(m_fp != NULL);
+	assert(m_fp != NULL || m_data != NULL || m_dvtool != NULL);
+
+	if (m_dvtool != NULL) {
+		m_dvtool->close();
+		delete m_dvtool;
+		m_dvtool = NULL;
+	}
+
+	if (m_data != NULL)
+		unmap();
+
+	if (m_fp != NULL) {
+		if (m_fileName != STREAM_NAME)
+			::fclose(m_fp);
+		m_fp = NULL;
+	}
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+bool CAMBEFileReader::map()
+{
+	int fd = ::open(m_fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	// Only regular files can be mapped, anything else is read with stdio
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || uint64_t(st.st_size) > uint64_t(SIZE_MAX)) {
+		::close(fd);
+		return false;
+	}
 
-	::fclose(m_fp);
+	void* p = ::mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
 
-	m_fp = NULL;
+	// The mapping keeps its own reference to the file
+	::close(fd);
+
+	if (p == MAP_FAILED)
+		return false;
+
+	::madvise(p, size_t(st.st_size), MADV_SEQUENTIAL);
+
+	m_data = (const uint8_t*)p;
+	m_size = uint64_t(st.st_size);
+	m_pos  = 0U;
+
+	return true;
+}
+
+void CAMBEFileReader::unmap()
+{
+	::munmap((void*)m_data, size_t(m_size));
+
+	m_data = NULL;
+	m_size = 0U;
+}
+#else
+bool CAMBEFileReader::map()
+{
+	return false;
+}
+
+void CAMBEFileReader::unmap()
+{
 }
+#endif
@@ -1,5 +1,5 @@
 /*
-*   Copyright (C) 2017 by Jonathan Naylor G4KLX
+*   Copyright (C) 2017,2018,2026 by Jonathan Naylor G4KLX
 *
 *   This program is free software; you can redistribute it and/or modify
 *   it under the terms of the GNU General Public License as published by
@@ -19,10 +19,28 @@
 #ifndef	AMBEFileReader_H
 #define AMBEFileReader_H
 
+#include "AMBEContainer.h"
+#include "DVTOOLFileReader.h"
+
 #include <string>
+#include <vector>
 
+#include <cstdint>
 #include <cstdio>
 
+// On POSIX systems a regular file is memory mapped, and the frames after
+// the signature can be accessed in place by index. Otherwise, or if the
+// mapping fails, the file is read with stdio and only read() is available.
+// A file name of "-" reads from standard input.
+//
+// An AMBE container, see AMBEContainer.h, is detected automatically and the
+// signature is then ignored. By default read() returns the frames of every
+// call in turn, stopping at a call with a different mode or frame size, and
+// select() limits it to part of one call. Other than on standard input the
+// calls are found from the index, or by walking the file if it has none.
+//
+// A DV-Tool file is also detected and read with CDVTOOLFileReader, read()
+// then returns the D-Star AMBE data of its voice records.
 class CAMBEFileReader {
 public:
 	CAMBEFileReader(const std::string& fileName, const std::string& signature);
@@ -32,10 +50,59 @@ public:
 	unsigned int read(uint8_t* data, unsigned int length);
 	void         close();
 
+	bool           isMapped() const;
+
+	// The number of complete frames of the given length after the signature,
+	// or in a container the number in the calls that read() would return
+	uint64_t       frames(unsigned int length) const;
+
+	// A pointer to frame n in the mapping, or NULL if not mapped, out of range or a container
+	const uint8_t* frame(unsigned int length, uint64_t n) const;
+
+	bool                isContainer() const;
+	bool                isDVTOOL() const;
+
+	unsigned int        getCallCount() const;
+	const CAMBESegment& getCall(unsigned int n) const;
+
+	// From the first frame at or after startMs to the frame before endMs, an
+	// endMs of zero means to the end of the call
+	bool                select(unsigned int call, uint32_t startMs, uint32_t endMs);
+
 private:
-	std::string m_fileName;
-	std::string m_signature;
-	FILE*       m_fp;
+	std::string    m_fileName;
+	std::string    m_signature;
+	FILE*          m_fp;
+	const uint8_t* m_data;
+	uint64_t       m_size;
+	uint64_t       m_offset;
+	uint64_t       m_pos;
+	std::string    m_pending;
+	bool           m_container;
+	bool           m_indexed;
+	bool           m_selected;
+	std::vector<CAMBESegment> m_calls;
+	int            m_current;
+	uint64_t       m_left;
+	uint64_t       m_skip;
+	uint64_t       m_total;
+	CDVTOOLFileReader* m_dvtool;
+
+	bool map();
+	void unmap();
+
+	unsigned int rawRead(uint8_t* data, unsigned int length);
+	bool         rawSeek(uint64_t pos);
+	bool         rawSkip(uint64_t length);
+	uint64_t     rawSize();
+
+	bool         openContainer();
+	bool         openDVTOOL(const uint8_t* data, unsigned int length);
+	bool         readIndex();
+	bool         scanCalls();
+	bool         nextCall();
+	bool         isCompatible(const CAMBESegment& call) const;
+	uint32_t     findFrame(const CAMBESegment& call, uint32_t ms);
 };
 
 #endif
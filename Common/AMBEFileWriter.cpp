@@ -17,13 +17,26 @@
 */
 
 #include "AMBEFileWriter.h"
+#include "Utils.h"
+
+#include <chrono>
 
 #include <cassert>
+#include <cstring>
 
 CAMBEFileWriter::CAMBEFileWriter(const std::string& fileName, const std::string& signature) :
 m_fileName(fileName),
 m_signature(signature),
-m_fp(NULL)
+m_fp(NULL),
+m_container(false),
+m_append(false),
+m_seekable(false),
+m_call(),
+m_inCall(false),
+m_started(false),
+m_segments(),
+m_timestamps(),
+m_lastTimestamp(0U)
 {
 }
 
@@ -31,34 +44,299 @@ CAMBEFileWriter::~CAMBEFileWriter()
 {
 }
 
+void CAMBEFileWriter::setContainer(unsigned int mode, bool fec, unsigned int frameMs, bool append)
+{
+	assert(frameMs > 0U);
+
+	m_container = true;
+	m_append    = append;
+
+	m_call.m_mode       = mode;
+	m_call.m_fec        = fec;
+	m_call.m_frameSize  = 0U;
+	m_call.m_frameMs    = frameMs;
+	m_call.m_timestamps = false;
+	m_call.m_frames     = 0U;
+	m_call.m_startTime  = 0U;
+	m_call.m_offset     = 0U;
+	m_call.m_duration   = 0U;
+}
+
 bool CAMBEFileWriter::open()
 {
-	m_fp = ::fopen(m_fileName.c_str(), "wb");
+	if (m_container && m_append && m_fileName != STREAM_NAME) {
+		// A container that doesn't exist yet is simply created
+		FILE* fp = ::fopen(m_fileName.c_str(), "rb");
+		if (fp != NULL) {
+			::fclose(fp);
+			if (!openAppend())
+				return false;
+			return startCall();
+		}
+	}
+
+	if (m_fileName == STREAM_NAME)
+		m_fp = CUtils::getStdout();
+	else
+		m_fp = ::fopen(m_fileName.c_str(), "wb");
 	if (m_fp == NULL) {
 		::fprintf(stderr, "AMBEFileWriter: could not open the AMBE file %s\n", m_fileName.c_str());
 		return false;
 	}
 
+	if (m_container) {
+		m_seekable = m_fileName != STREAM_NAME;
+		m_segments.clear();
+
+		uint8_t header[AMBE_CONTAINER_HEADER_LENGTH];
+		::memset(header, 0x00U, AMBE_CONTAINER_HEADER_LENGTH);
+		::memcpy(header, AMBE_CONTAINER_MAGIC, 4U);
+		header[4U] = AMBE_CONTAINER_VERSION;
+
+		::fwrite(header, sizeof(uint8_t), AMBE_CONTAINER_HEADER_LENGTH, m_fp);
+
+		return startCall();
+	}
+
 	if (!m_signature.empty())
 		::fwrite(m_signature.c_str(), sizeof(uint8_t), m_signature.size(), m_fp);
 
 	return true;
 }
 
+bool CAMBEFileWriter::openAppend()
+{
+	m_fp = ::fopen(m_fileName.c_str(), "r+b");
+	if (m_fp == NULL) {
+		::fprintf(stderr, "AMBEFileWriter: could not open the AMBE file %s\n", m_fileName.c_str());
+		return false;
+	}
+
+	m_seekable = true;
+	m_segments.clear();
+
+	uint8_t trailer[AMBE_TRAILER_LENGTH];
+	if (!CUtils::seek(m_fp, -int64_t(AMBE_TRAILER_LENGTH), SEEK_END) ||
+	    ::fread(trailer, sizeof(uint8_t), AMBE_TRAILER_LENGTH, m_fp) != AMBE_TRAILER_LENGTH ||
+	    ::memcmp(trailer + 8U, AMBE_TRAILER_MAGIC, 4U) != 0) {
+		::fprintf(stderr, "AMBEFileWriter: %s is not an AMBE container with an index\n", m_fileName.c_str());
+		::fclose(m_fp);
+		m_fp = NULL;
+		return false;
+	}
+
+	uint64_t offset = CAMBEContainer::getUInt64(trailer);
+
+	uint8_t header[AMBE_INDEX_HEADER_LENGTH];
+	if (offset > uint64_t(INT64_MAX) || !CUtils::seek(m_fp, int64_t(offset), SEEK_SET) ||
+	    ::fread(header, sizeof(uint8_t), AMBE_INDEX_HEADER_LENGTH, m_fp) != AMBE_INDEX_HEADER_LENGTH ||
+	    ::memcmp(header, AMBE_INDEX_MAGIC, 4U) != 0) {
+		::fprintf(stderr, "AMBEFileWriter: %s has a corrupt index\n", m_fileName.c_str());
+		::fclose(m_fp);
+		m_fp = NULL;
+		return false;
+	}
+
+	uint32_t count = CAMBEContainer::getUInt32(header + 4U);
+
+	for (uint32_t i = 0U; i < count; i++) {
+		uint8_t entry[AMBE_INDEX_ENTRY_LENGTH];
+		if (::fread(entry, sizeof(uint8_t), AMBE_INDEX_ENTRY_LENGTH, m_fp) != AMBE_INDEX_ENTRY_LENGTH) {
+			::fprintf(stderr, "AMBEFileWriter: %s has a corrupt index\n", m_fileName.c_str());
+			::fclose(m_fp);
+			m_fp = NULL;
+			return false;
+		}
+
+		// Only the index fields are needed to rewrite the index
+		CAMBESegment segment = m_call;
+		segment.m_offset    = CAMBEContainer::getUInt64(entry + 0U);
+		segment.m_startTime = CAMBEContainer::getUInt64(entry + 8U);
+		segment.m_frames    = CAMBEContainer::getUInt32(entry + 16U);
+		segment.m_duration  = CAMBEContainer::getUInt32(entry + 20U);
+		m_segments.push_back(segment);
+	}
+
+	// New calls overwrite the old index, which is written again at the end
+	CUtils::seek(m_fp, int64_t(offset), SEEK_SET);
+
+	return true;
+}
+
+bool CAMBEFileWriter::startCall(uint64_t startTime)
+{
+	assert(m_fp != NULL);
+
+	if (!m_container)
+		return true;
+
+	// The length of a call on a stream is unknown, so it must be the only one
+	if (m_inCall && m_started && !m_seekable) {
+		::fprintf(stderr, "AMBEFileWriter: only one call can be written to a stream\n");
+		return false;
+	}
+
+	if (m_inCall && !endCall())
+		return false;
+
+	if (startTime == 0U)
+		startTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	// The segment header is written with the first frame, when the frame size is known
+	m_call.m_frameSize  = 0U;
+	m_call.m_timestamps = false;
+	m_call.m_frames     = 0U;
+	m_call.m_startTime  = startTime;
+	m_call.m_offset     = 0U;
+	m_call.m_duration   = 0U;
+
+	m_timestamps.clear();
+	m_lastTimestamp = 0U;
+
+	m_inCall  = true;
+	m_started = false;
+
+	return true;
+}
+
 unsigned int CAMBEFileWriter::write(uint8_t* buffer, unsigned int length)
 {
 	assert(m_fp != NULL);
 	assert(buffer != NULL);
 	assert(length > 0U);
 
+	if (!m_container)
+		return (unsigned int)::fwrite(buffer, sizeof(uint8_t), length, m_fp);
+
+	// Without a timestamp the frame follows straight on from the last one
+	uint32_t timestamp = (m_call.m_frames == 0U) ? 0U : m_lastTimestamp + m_call.m_frameMs;
+
+	return write(buffer, length, timestamp);
+}
+
+unsigned int CAMBEFileWriter::write(uint8_t* buffer, unsigned int length, uint32_t timestamp)
+{
+	assert(m_fp != NULL);
+	assert(buffer != NULL);
+	assert(length > 0U);
+
+	if (!m_container)
+		return (unsigned int)::fwrite(buffer, sizeof(uint8_t), length, m_fp);
+
+	assert(m_inCall);
+
+	if (!m_started) {
+		m_call.m_frameSize = length;
+		m_call.m_frames    = AMBE_CONTAINER_UNKNOWN_COUNT;
+		m_call.m_offset    = m_seekable ? uint64_t(CUtils::tell(m_fp)) : 0U;
+
+		uint8_t header[AMBE_SEGMENT_HEADER_LENGTH];
+		CAMBEContainer::encodeSegment(header, m_call);
+		::fwrite(header, sizeof(uint8_t), AMBE_SEGMENT_HEADER_LENGTH, m_fp);
+
+		m_call.m_frames = 0U;
+		m_started = true;
+	}
+
+	if (length != m_call.m_frameSize) {
+		::fprintf(stderr, "AMBEFileWriter: frame of %u bytes in a call of %u byte frames\n", length, m_call.m_frameSize);
+		return 0U;
+	}
+
+	if (timestamp != m_call.m_frames * m_call.m_frameMs)
+		m_call.m_timestamps = true;
+
+	// Timestamps can't be added after the frames of a stream
+	if (m_seekable)
+		m_timestamps.push_back(timestamp);
+
+	m_lastTimestamp = timestamp;
+	m_call.m_frames++;
+	m_call.m_duration = timestamp + m_call.m_frameMs;
+
 	return (unsigned int)::fwrite(buffer, sizeof(uint8_t), length, m_fp);
 }
 
+bool CAMBEFileWriter::endCall()
+{
+	assert(m_fp != NULL);
+
+	m_inCall = false;
+
+	// A call with no frames leaves nothing in the file
+	if (!m_started || !m_seekable)
+		return true;
+
+	if (m_call.m_timestamps) {
+		for (std::vector<uint32_t>::const_iterator it = m_timestamps.begin(); it != m_timestamps.end(); ++it) {
+			uint8_t buffer[4U];
+			CAMBEContainer::setUInt32(buffer, *it);
+			::fwrite(buffer, sizeof(uint8_t), 4U, m_fp);
+		}
+	}
+
+	int64_t end = CUtils::tell(m_fp);
+
+	// Now the frame count and flags are known
+	uint8_t header[AMBE_SEGMENT_HEADER_LENGTH];
+	CAMBEContainer::encodeSegment(header, m_call);
+
+	if (!CUtils::seek(m_fp, int64_t(m_call.m_offset), SEEK_SET)) {
+		::fprintf(stderr, "AMBEFileWriter: cannot seek in the AMBE file %s\n", m_fileName.c_str());
+		return false;
+	}
+
+	::fwrite(header, sizeof(uint8_t), AMBE_SEGMENT_HEADER_LENGTH, m_fp);
+	CUtils::seek(m_fp, end, SEEK_SET);
+
+	m_segments.push_back(m_call);
+
+	return true;
+}
+
+bool CAMBEFileWriter::writeIndex()
+{
+	assert(m_fp != NULL);
+
+	uint64_t offset = uint64_t(CUtils::tell(m_fp));
+
+	uint8_t header[AMBE_INDEX_HEADER_LENGTH];
+	::memcpy(header, AMBE_INDEX_MAGIC, 4U);
+	CAMBEContainer::setUInt32(header + 4U, uint32_t(m_segments.size()));
+	::fwrite(header, sizeof(uint8_t), AMBE_INDEX_HEADER_LENGTH, m_fp);
+
+	for (std::vector<CAMBESegment>::const_iterator it = m_segments.begin(); it != m_segments.end(); ++it) {
+		uint8_t entry[AMBE_INDEX_ENTRY_LENGTH];
+		CAMBEContainer::setUInt64(entry + 0U,  it->m_offset);
+		CAMBEContainer::setUInt64(entry + 8U,  it->m_startTime);
+		CAMBEContainer::setUInt32(entry + 16U, it->m_frames);
+		CAMBEContainer::setUInt32(entry + 20U, it->m_duration);
+		::fwrite(entry, sizeof(uint8_t), AMBE_INDEX_ENTRY_LENGTH, m_fp);
+	}
+
+	uint8_t trailer[AMBE_TRAILER_LENGTH];
+	CAMBEContainer::setUInt64(trailer, offset);
+	::memcpy(trailer + 8U, AMBE_TRAILER_MAGIC, 4U);
+
+	return ::fwrite(trailer, sizeof(uint8_t), AMBE_TRAILER_LENGTH, m_fp) == AMBE_TRAILER_LENGTH;
+}
+
 void CAMBEFileWriter::close()
 {
 	assert(m_fp != NULL);
 
-	::fclose(m_fp);
+	if (m_container) {
+		if (m_inCall)
+			endCall();
+
+		if (m_seekable)
+			writeIndex();
+	}
+
+	if (m_fileName == STREAM_NAME)
+		::fflush(m_fp);
+	else
+		::fclose(m_fp);
 
 	m_fp = NULL;
 }
@@ -19,23 +19,54 @@
 #ifndef	AMBEFileWriter_H
 #define AMBEFileWriter_H
 
+#include "AMBEContainer.h"
+
 #include <string>
+#include <vector>
 
+#include <cstdint>
 #include <cstdio>
 
+// Either a signature followed by the frames, or after setContainer() an AMBE
+// container as described in AMBEContainer.h. A container holds one or more
+// calls, the first is started by open() and further ones by startCall(), and
+// with append the calls are added to the end of an existing container.
 class CAMBEFileWriter {
 public:
 	CAMBEFileWriter(const std::string& fileName, const std::string& signature);
 	~CAMBEFileWriter();
 
+	void         setContainer(unsigned int mode, bool fec, unsigned int frameMs, bool append = false);
+
 	bool         open();
+
+	// The start time is in ms since 1970, zero means now
+	bool         startCall(uint64_t startTime = 0U);
+
 	unsigned int write(uint8_t* data, unsigned int length);
+
+	// In a container the time of the frame in ms from the start of the call
+	unsigned int write(uint8_t* data, unsigned int length, uint32_t timestamp);
+
 	void         close();
 
 private:
-	std::string m_fileName;
-	std::string m_signature;
-	FILE*       m_fp;
+	std::string               m_fileName;
+	std::string               m_signature;
+	FILE*                     m_fp;
+	bool                      m_container;
+	bool                      m_append;
+	bool                      m_seekable;
+	CAMBESegment              m_call;
+	bool                      m_inCall;
+	bool                      m_started;
+	std::vector<CAMBESegment> m_segments;
+	std::vector<uint32_t>     m_timestamps;
+	uint32_t                  m_lastTimestamp;
+
+	bool openAppend();
+	bool endCall();
+	bool writeIndex();
 };
 
 #endif
@@ -0,0 +1,304 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "BatchScheduler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+
+#include <cassert>
+#include <cstdio>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#endif
+
+CBatchScheduler::CBatchScheduler(unsigned int threads) :
+m_threads(threads),
+m_jobs(),
+m_devices(),
+m_next(0U),
+m_finished(0U),
+m_skipped(0U),
+m_failed(0U),
+m_mutex()
+{
+	if (m_threads == 0U)
+		m_threads = std::thread::hardware_concurrency();
+
+	if (m_threads == 0U)
+		m_threads = 1U;
+}
+
+CBatchScheduler::~CBatchScheduler()
+{
+	for (std::map<std::string, std::mutex*>::iterator it = m_devices.begin(); it != m_devices.end(); ++it)
+		delete it->second;
+}
+
+bool CBatchScheduler::add(const std::string& input, const std::string& inExtension, const std::string& outputDir, const std::string& outExtension, const std::string& device)
+{
+	if (isDirectory(input)) {
+		std::vector<std::string> files;
+		if (!listDirectory(input, files)) {
+			::fprintf(stderr, "BatchScheduler: could not read the directory %s\n", input.c_str());
+			return false;
+		}
+
+		std::sort(files.begin(), files.end());
+
+		for (std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it) {
+			const std::string& name = *it;
+			if (name.size() > inExtension.size() && name.compare(name.size() - inExtension.size(), inExtension.size(), inExtension) == 0) {
+				std::string path = input + "/" + name;
+				addJob(path, makeOutput(path, outputDir, outExtension), device);
+			}
+		}
+
+		return true;
+	}
+
+	std::ifstream manifest(input.c_str());
+	if (!manifest.is_open()) {
+		::fprintf(stderr, "BatchScheduler: could not open the manifest %s\n", input.c_str());
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(manifest, line)) {
+		std::istringstream fields(line);
+
+		std::string in, out;
+		fields >> in >> out;
+
+		if (in.empty() || in[0U] == '#')
+			continue;
+
+		if (out.empty())
+			out = makeOutput(in, outputDir, outExtension);
+
+		addJob(in, out, device);
+	}
+
+	return true;
+}
+
+void CBatchScheduler::addJob(const std::string& input, const std::string& output, const std::string& device)
+{
+	CBatchJob job;
+	job.m_input  = input;
+	job.m_output = output;
+	job.m_device = device;
+
+	m_jobs.push_back(job);
+
+	// Created now so that the map isn't changed while the workers are running
+	if (!device.empty() && m_devices.find(device) == m_devices.end())
+		m_devices[device] = new std::mutex;
+}
+
+unsigned int CBatchScheduler::run(std::function<int(const std::string& input, const std::string& output)> convert)
+{
+	m_next     = 0U;
+	m_finished = 0U;
+	m_skipped  = 0U;
+	m_failed   = 0U;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	unsigned int threads = std::min(m_threads, (unsigned int)m_jobs.size());
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0U; i < threads; i++)
+		workers.push_back(std::thread(&CBatchScheduler::worker, this, convert));
+
+	for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+		it->join();
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	unsigned int converted = (unsigned int)m_jobs.size() - m_skipped - m_failed;
+
+	::fprintf(stderr, "Batch: %u converted, %u skipped, %u failed in %.2fs using %u threads\n", converted, (unsigned int)m_skipped, (unsigned int)m_failed, elapsed, threads);
+
+	return m_failed;
+}
+
+void CBatchScheduler::worker(std::function<int(const std::string& input, const std::string& output)> convert)
+{
+	unsigned int total = (unsigned int)m_jobs.size();
+
+	for (;;) {
+		unsigned int n = m_next++;
+		if (n >= total)
+			return;
+
+		const CBatchJob& job = m_jobs[n];
+
+		if (isUpToDate(job)) {
+			m_skipped++;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			::fprintf(stderr, "[%u/%u] %s: up to date\n", ++m_finished, total, job.m_output.c_str());
+			continue;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		int ret;
+		if (job.m_device.empty()) {
+			ret = convert(job.m_input, job.m_output);
+		} else {
+			std::lock_guard<std::mutex> lock(*m_devices[job.m_device]);
+			ret = convert(job.m_input, job.m_output);
+		}
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (ret != 0) {
+			m_failed++;
+
+			// Don't leave a partial output that would look up to date next time
+			::remove(job.m_output.c_str());
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		::fprintf(stderr, "[%u/%u] %s -> %s: %s in %.2fs\n", ++m_finished, total, job.m_input.c_str(), job.m_output.c_str(), (ret == 0) ? "done" : "FAILED", elapsed);
+	}
+}
+
+bool CBatchScheduler::isUpToDate(const CBatchJob& job) const
+{
+	uint64_t inSize, outSize;
+	int64_t  inTime, outTime;
+
+	if (!getFileInfo(job.m_input, inSize, inTime))
+		return false;
+
+	if (!getFileInfo(job.m_output, outSize, outTime))
+		return false;
+
+	return outSize > 0U && outTime >= inTime;
+}
+
+std::string CBatchScheduler::makeOutput(const std::string& input, const std::string& outputDir, const std::string& outExtension)
+{
+	std::string name = input;
+
+	size_t pos = name.find_last_of("/\\");
+	if (pos != std::string::npos)
+		name = name.substr(pos + 1U);
+
+	pos = name.find_last_of('.');
+	if (pos != std::string::npos && pos > 0U)
+		name = name.substr(0U, pos);
+
+	return outputDir + "/" + name + outExtension;
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+bool CBatchScheduler::isDirectory(const std::string& path)
+{
+	DWORD attributes = ::GetFileAttributesA(path.c_str());
+
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0U;
+}
+
+bool CBatchScheduler::listDirectory(const std::string& path, std::vector<std::string>& files)
+{
+	WIN32_FIND_DATAA data;
+
+	HANDLE handle = ::FindFirstFileA((path + "\\*").c_str(), &data);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	do {
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0U)
+			files.push_back(data.cFileName);
+	} while (::FindNextFileA(handle, &data));
+
+	::FindClose(handle);
+
+	return true;
+}
+
+bool CBatchScheduler::getFileInfo(const std::string& path, uint64_t& size, int64_t& mtime)
+{
+	struct _stat64 st;
+	if (::_stat64(path.c_str(), &st) != 0)
+		return false;
+
+	size  = uint64_t(st.st_size);
+	mtime = int64_t(st.st_mtime);
+
+	return true;
+}
+#else
+bool CBatchScheduler::isDirectory(const std::string& path)
+{
+	struct stat st;
+	if (::stat(path.c_str(), &st) != 0)
+		return false;
+
+	return S_ISDIR(st.st_mode);
+}
+
+bool CBatchScheduler::listDirectory(const std::string& path, std::vector<std::string>& files)
+{
+	DIR* dir = ::opendir(path.c_str());
+	if (dir == NULL)
+		return false;
+
+	struct dirent* entry;
+	while ((entry = ::readdir(dir)) != NULL) {
+		if (entry->d_name[0U] == '.')
+			continue;
+
+		std::string name = path + "/" + entry->d_name;
+
+		struct stat st;
+		if (::stat(name.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+			files.push_back(entry->d_name);
+	}
+
+	::closedir(dir);
+
+	return true;
+}
+
+bool CBatchScheduler::getFileInfo(const std::string& path, uint64_t& size, int64_t& mtime)
+{
+	struct stat st;
+	if (::stat(path.c_str(), &st) != 0)
+		return false;
+
+	size  = uint64_t(st.st_size);
+	mtime = int64_t(st.st_mtime);
+
+	return true;
+}
+#endif
@@ -0,0 +1,73 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	BatchScheduler_H
+#define	BatchScheduler_H
+
+#include <functional>
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <map>
+
+// Runs many conversions across a pool of threads. Jobs that name a device
+// are serialised on that device, others run in parallel. A job is skipped
+// when its output is non-empty and no older than its input.
+class CBatchScheduler {
+public:
+	CBatchScheduler(unsigned int threads);
+	~CBatchScheduler();
+
+	// The input is either a directory, from which every file ending with
+	// inExtension is taken, or a manifest with one "<input> [<output>]" per
+	// line. Outputs not given are named after the input, with outExtension
+	// in place of its extension, in outputDir.
+	bool add(const std::string& input, const std::string& inExtension, const std::string& outputDir, const std::string& outExtension, const std::string& device);
+
+	// Returns the number of jobs that failed
+	unsigned int run(std::function<int(const std::string& input, const std::string& output)> convert);
+
+private:
+	struct CBatchJob {
+		std::string m_input;
+		std::string m_output;
+		std::string m_device;
+	};
+
+	unsigned int                       m_threads;
+	std::vector<CBatchJob>             m_jobs;
+	std::map<std::string, std::mutex*> m_devices;
+	std::atomic<unsigned int>          m_next;
+	std::atomic<unsigned int>          m_finished;
+	std::atomic<unsigned int>          m_skipped;
+	std::atomic<unsigned int>          m_failed;
+	std::mutex                         m_mutex;
+
+	void addJob(const std::string& input, const std::string& output, const std::string& device);
+	void worker(std::function<int(const std::string& input, const std::string& output)> convert);
+	bool isUpToDate(const CBatchJob& job) const;
+
+	static std::string makeOutput(const std::string& input, const std::string& outputDir, const std::string& outExtension);
+	static bool isDirectory(const std::string& path);
+	static bool listDirectory(const std::string& path, std::vector<std::string>& files);
+	static bool getFileInfo(const std::string& path, uint64_t& size, int64_t& mtime);
+};
+
+#endif
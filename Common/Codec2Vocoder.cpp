@@ -0,0 +1,98 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Codec2Vocoder.h"
+
+#include <cassert>
+
+// Both modes have 64 bit frames, of 20ms at 3200 bit/s and 40ms at 1600 bit/s
+const unsigned int CODEC2_FRAME_LENGTH = 8U;
+
+// The number of samples in the 10ms Codec2 sub-frame
+const unsigned int CODEC2_SUBFRAME_LENGTH = 80U;
+
+CCodec2Vocoder::CCodec2Vocoder(bool is3200) :
+m_codec2(is3200),
+m_is3200(is3200)
+{
+}
+
+CCodec2Vocoder::~CCodec2Vocoder()
+{
+}
+
+bool CCodec2Vocoder::open()
+{
+	return true;
+}
+
+unsigned int CCodec2Vocoder::getFrameLength() const
+{
+	return CODEC2_FRAME_LENGTH;
+}
+
+unsigned int CCodec2Vocoder::getFrameBlocks() const
+{
+	return m_is3200 ? 1U : 2U;
+}
+
+ENCODE_RESULT CCodec2Vocoder::encode(const int16_t* audio, uint8_t* frame)
+{
+	assert(audio != NULL);
+	assert(frame != NULL);
+
+	// Encode 10ms at a time, a frame is complete every 20ms or 40ms depending on the mode
+	ENCODE_RESULT result = ENCODE_MORE;
+	for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i += CODEC2_SUBFRAME_LENGTH) {
+		if (m_codec2.codec2_encode_10ms(frame, audio + i))
+			result = ENCODE_FRAME;
+	}
+
+	return result;
+}
+
+bool CCodec2Vocoder::decode(const uint8_t* frame, int16_t* audio)
+{
+	assert(frame != NULL);
+	assert(audio != NULL);
+
+	m_codec2.codec2_decode(audio, frame);
+
+	return true;
+}
+
+void CCodec2Vocoder::close()
+{
+}
+
+bool CCodec2Vocoder::reset()
+{
+	m_codec2.codec2_reset();
+
+	return true;
+}
+
+void CCodec2Vocoder::setTiming(bool enable)
+{
+	m_codec2.codec2_set_timing(enable);
+}
+
+const C2_TIMING& CCodec2Vocoder::getTiming() const
+{
+	return m_codec2.codec2_get_timing();
+}
@@ -0,0 +1,52 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(Codec2Vocoder_H)
+#define	Codec2Vocoder_H
+
+#include "Vocoder.h"
+
+#include "codec2/codec2.h"
+
+// The built in Codec2 vocoder used by M17, 3200 or 1600 bit/s
+class CCodec2Vocoder : public CVocoder {
+public:
+	CCodec2Vocoder(bool is3200);
+	virtual ~CCodec2Vocoder();
+
+	virtual bool open();
+
+	virtual unsigned int getFrameLength() const;
+	virtual unsigned int getFrameBlocks() const;
+
+	virtual ENCODE_RESULT encode(const int16_t* audio, uint8_t* frame);
+	virtual bool decode(const uint8_t* frame, int16_t* audio);
+
+	virtual void close();
+
+	virtual bool reset();
+
+	void setTiming(bool enable);
+	const C2_TIMING& getTiming() const;
+
+private:
+	CCodec2 m_codec2;
+	bool    m_is3200;
+};
+
+#endif
@@ -0,0 +1,278 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "DV3000Emulator.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+const unsigned char DV3000_START_BYTE   = 0x61U;
+
+const unsigned char DV3000_TYPE_CONTROL = 0x00U;
+const unsigned char DV3000_TYPE_AMBE    = 0x01U;
+const unsigned char DV3000_TYPE_AUDIO   = 0x02U;
+
+const unsigned char DV3000_CONTROL_RATET        = 0x09U;
+const unsigned char DV3000_CONTROL_RATEP        = 0x0AU;
+const unsigned char DV3000_CONTROL_PRODID       = 0x30U;
+const unsigned char DV3000_CONTROL_VERSTRING    = 0x31U;
+const unsigned char DV3000_CONTROL_RESETSOFTCFG = 0x34U;
+const unsigned char DV3000_CONTROL_READY        = 0x39U;
+
+const unsigned int DV3000_HEADER_LEN = 4U;
+
+const unsigned int AUDIO_BYTES = 320U;
+
+const unsigned int BUFFER_LENGTH = 2048U;
+
+CDV3000Emulator::CDV3000Emulator() :
+m_fd(-1),
+m_slave(-1),
+m_port(),
+m_thread(),
+m_stop(false),
+m_delayPacket(0U),
+m_delayMs(0U),
+m_frameLength(9U),
+m_count(0U)
+{
+}
+
+CDV3000Emulator::~CDV3000Emulator()
+{
+	stop();
+}
+
+void CDV3000Emulator::setDelay(unsigned int n, unsigned int ms)
+{
+	m_delayPacket = n;
+	m_delayMs     = ms;
+}
+
+bool CDV3000Emulator::start()
+{
+	m_fd = ::posix_openpt(O_RDWR | O_NOCTTY);
+	if (m_fd < 0) {
+		::fprintf(stderr, "DV3000Emulator: cannot open a pseudo terminal, err=%d\n", errno);
+		return false;
+	}
+
+	if (::grantpt(m_fd) < 0 || ::unlockpt(m_fd) < 0 || ::ptsname(m_fd) == NULL) {
+		::fprintf(stderr, "DV3000Emulator: cannot set up the pseudo terminal, err=%d\n", errno);
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+
+	m_port = ::ptsname(m_fd);
+
+	// Held open so that the terminal survives each program that uses it
+	m_slave = ::open(m_port.c_str(), O_RDWR | O_NOCTTY);
+	if (m_slave < 0) {
+		::fprintf(stderr, "DV3000Emulator: cannot open %s, err=%d\n", m_port.c_str(), errno);
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+
+	struct termios termios;
+	::tcgetattr(m_slave, &termios);
+	::cfmakeraw(&termios);
+	::tcsetattr(m_slave, TCSANOW, &termios);
+
+	m_stop  = false;
+	m_count = 0U;
+
+	m_thread = std::thread(&CDV3000Emulator::run, this);
+
+	return true;
+}
+
+std::string CDV3000Emulator::getPort() const
+{
+	return m_port;
+}
+
+void CDV3000Emulator::stop()
+{
+	if (m_fd < 0)
+		return;
+
+	m_stop = true;
+	m_thread.join();
+
+	::close(m_slave);
+	::close(m_fd);
+	m_slave = -1;
+	m_fd    = -1;
+}
+
+void CDV3000Emulator::run()
+{
+	unsigned char buffer[BUFFER_LENGTH];
+	unsigned int length = 0U;
+
+	while (!m_stop) {
+		struct pollfd pfd;
+		pfd.fd      = m_fd;
+		pfd.events  = POLLIN;
+		pfd.revents = 0;
+
+		if (::poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		ssize_t n = ::read(m_fd, buffer + length, BUFFER_LENGTH - length);
+		if (n <= 0)
+			continue;
+
+		length += (unsigned int)n;
+
+		// Whole packets are answered, anything before a start byte is skipped
+		unsigned int offset = 0U;
+		while (length - offset >= DV3000_HEADER_LEN) {
+			if (buffer[offset] != DV3000_START_BYTE) {
+				offset++;
+				continue;
+			}
+
+			unsigned int packetLen = (buffer[offset + 1U] & 0x0FU) * 256U + buffer[offset + 2U] + DV3000_HEADER_LEN;
+			if (packetLen > BUFFER_LENGTH) {
+				offset++;
+				continue;
+			}
+
+			if (length - offset < packetLen)
+				break;
+
+			process(buffer + offset, packetLen);
+
+			offset += packetLen;
+		}
+
+		length -= offset;
+		::memmove(buffer, buffer + offset, length);
+	}
+}
+
+void CDV3000Emulator::process(const unsigned char* packet, unsigned int length)
+{
+	assert(packet != NULL);
+
+	unsigned char type = packet[3U];
+
+	if (type == DV3000_TYPE_CONTROL) {
+		unsigned char control = (length > DV3000_HEADER_LEN) ? packet[4U] : 0x00U;
+
+		switch (control) {
+		case DV3000_CONTROL_PRODID:
+			write(DV3000_TYPE_CONTROL, (const unsigned char*)"\x30" "AMBE3000R", 11U);
+			break;
+		case DV3000_CONTROL_VERSTRING:
+			write(DV3000_TYPE_CONTROL, (const unsigned char*)"\x31" "V120.E100", 11U);
+			break;
+		case DV3000_CONTROL_RESETSOFTCFG: {
+				unsigned char ready = DV3000_CONTROL_READY;
+				write(DV3000_TYPE_CONTROL, &ready, 1U);
+			}
+			break;
+		default: {
+				// The frame lengths of the rates that the programs use
+				if (control == DV3000_CONTROL_RATET && length > 5U)
+					m_frameLength = (packet[5U] == 0U) ? 6U : (packet[5U] == 34U) ? 7U : 9U;
+				else if (control == DV3000_CONTROL_RATEP && length > 9U)
+					m_frameLength = (packet[5U] == 0x01U) ? 9U : (packet[9U] != 0x00U) ? 18U : 11U;
+
+				unsigned char reply[2U] = {control, 0x00U};
+				write(DV3000_TYPE_CONTROL, reply, 2U);
+			}
+			break;
+		}
+
+		return;
+	}
+
+	if (type != DV3000_TYPE_AUDIO && type != DV3000_TYPE_AMBE)
+		return;
+
+	m_count++;
+	if (m_count == m_delayPacket) {
+		if (m_delayMs == 0U)
+			return;
+
+		// The chip stalls, so everything after this is late too
+		std::this_thread::sleep_for(std::chrono::milliseconds(m_delayMs));
+	}
+
+	// Both start with a field id and a length after the header
+	const unsigned char* data = packet + DV3000_HEADER_LEN + 2U;
+	unsigned int dataLen = (length > DV3000_HEADER_LEN + 2U) ? length - DV3000_HEADER_LEN - 2U : 0U;
+	if (dataLen == 0U)
+		return;
+
+	if (type == DV3000_TYPE_AUDIO) {
+		unsigned char reply[2U + 18U];
+		reply[0U] = 0x01U;
+		reply[1U] = m_frameLength * 8U;
+		for (unsigned int i = 0U; i < m_frameLength; i++)
+			reply[2U + i] = data[i % dataLen];
+
+		write(DV3000_TYPE_AMBE, reply, 2U + m_frameLength);
+	} else {
+		unsigned char reply[2U + AUDIO_BYTES];
+		reply[0U] = 0x00U;
+		reply[1U] = AUDIO_BYTES / 2U;
+		for (unsigned int i = 0U; i < AUDIO_BYTES; i++)
+			reply[2U + i] = data[i % dataLen];
+
+		write(DV3000_TYPE_AUDIO, reply, 2U + AUDIO_BYTES);
+	}
+}
+
+void CDV3000Emulator::write(unsigned char type, const unsigned char* payload, unsigned int length)
+{
+	assert(payload != NULL);
+
+	unsigned char packet[DV3000_HEADER_LEN + 2U + AUDIO_BYTES];
+	packet[0U] = DV3000_START_BYTE;
+	packet[1U] = (length >> 8) & 0xFFU;
+	packet[2U] = (length >> 0) & 0xFFU;
+	packet[3U] = type;
+	::memcpy(packet + DV3000_HEADER_LEN, payload, length);
+
+	unsigned int offset = 0U;
+	while (offset < length + DV3000_HEADER_LEN) {
+		ssize_t n = ::write(m_fd, packet + offset, length + DV3000_HEADER_LEN - offset);
+		if (n <= 0)
+			return;
+
+		offset += (unsigned int)n;
+	}
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(DV3000Emulator_H)
+#define	DV3000Emulator_H
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Plays the part of a DVSI AMBE3000 on a pseudo terminal, for testing and
+// benchmarking without the hardware. It identifies itself, accepts the rate
+// and other control packets, and answers them in order. An AMBE frame is
+// made from the first bytes of the audio, and the audio from the frame
+// repeated, so that a test can tell which request an answer belongs to. One
+// audio or AMBE packet may be answered late or not at all, to test the
+// handling of a chip that stops answering.
+class CDV3000Emulator {
+public:
+	CDV3000Emulator();
+	~CDV3000Emulator();
+
+	// The nth audio or AMBE packet, counting from 1, is answered after ms
+	// milliseconds, or never with a delay of 0
+	void setDelay(unsigned int n, unsigned int ms);
+
+	// Opens the pseudo terminal and answers on a thread of its own
+	bool start();
+
+	// The name of the terminal, for use as the serial port
+	std::string getPort() const;
+
+	void stop();
+
+private:
+	int               m_fd;
+	int               m_slave;
+	std::string       m_port;
+	std::thread       m_thread;
+	std::atomic<bool> m_stop;
+	unsigned int      m_delayPacket;
+	unsigned int      m_delayMs;
+	unsigned int      m_frameLength;
+	unsigned int      m_count;
+
+	void run();
+	void process(const unsigned char* packet, unsigned int length);
+	void write(unsigned char type, const unsigned char* payload, unsigned int length);
+};
+
+#endif
+
+#endif
@@ -17,9 +17,12 @@
  */
 
 #include "DV3000SerialController.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "Utils.h"
 
 #include <cassert>
+#include <chrono>
 #include <cstring>
 
 const unsigned char DV3000_START_BYTE   = 0x61U;
@@ -30,6 +33,7 @@ const unsigned char DV3000_TYPE_AUDIO   = 0x02U;
 
 const unsigned char DV3000_CONTROL_RATET        = 0x09U;
 const unsigned char DV3000_CONTROL_RATEP        = 0x0AU;
+const unsigned char DV3000_CONTROL_INIT         = 0x0BU;
 const unsigned char DV3000_CONTROL_PRODID       = 0x30U;
 const unsigned char DV3000_CONTROL_VERSTRING    = 0x31U;
 const unsigned char DV3000_CONTROL_RESETSOFTCFG = 0x34U;
@@ -41,6 +45,10 @@ const unsigned int DV3000_REQ_PRODID_LEN    = 5U;
 const unsigned char DV3000_REQ_VERSTRING[]     = {DV3000_START_BYTE, 0x00U, 0x01U, DV3000_TYPE_CONTROL, DV3000_CONTROL_VERSTRING};
 const unsigned int DV3000_REQ_VERSTRING_LEN    = 5U;
 
+// Both the encoder and the decoder
+const unsigned char DV3000_REQ_INIT[]     = {DV3000_START_BYTE, 0x00U, 0x02U, DV3000_TYPE_CONTROL, DV3000_CONTROL_INIT, 0x03U};
+const unsigned int DV3000_REQ_INIT_LEN    = 6U;
+
 const unsigned char DV3000_REQ_RESET[] = {DV3000_START_BYTE, 0x00U, 0x07U, DV3000_TYPE_CONTROL, DV3000_CONTROL_RESETSOFTCFG, 0x05U, 0x00U, 0x00U, 0x0FU, 0x00U, 0x00U};
 const unsigned int DV3000_REQ_RESET_LEN = 11U;
 
@@ -72,44 +80,41 @@ const unsigned int DV3000_HEADER_LEN = 4U;
 
 const unsigned int BUFFER_LENGTH = 400U;
 
-CDV3000SerialController::CDV3000SerialController(const std::string& device, unsigned int speed, AMBE_MODE mode, bool fec, float amplitude, bool reset, bool debug, CWAVFileReader* reader, CAMBEFileWriter* writer) :
-m_serial(device, SERIAL_SPEED(speed)),
-m_mode(mode),
-m_fec(fec),
-m_amplitude(amplitude),
-m_reset(reset),
-m_debug(debug),
-m_direction(AMBE_ENCODING),
-m_wavReader(reader),
-m_wavWriter(NULL),
-m_ambeReader(NULL),
-m_ambeWriter(writer),
-m_ambeBlockSize(0U)
-{
-	assert(reader != NULL);
-	assert(writer != NULL);
-}
+// How long to wait for the chip to return a frame or audio
+const unsigned int RESPONSE_TIMEOUT_MS = 1000U;
 
-CDV3000SerialController::CDV3000SerialController(const std::string& device, unsigned int speed, AMBE_MODE mode, bool fec, float amplitude, bool reset, bool debug, CAMBEFileReader* reader, CWAVFileWriter* writer) :
+CDV3000SerialController::CDV3000SerialController(const std::string& device, unsigned int speed, AMBE_MODE mode, bool fec, bool reset, bool debug) :
 m_serial(device, SERIAL_SPEED(speed)),
 m_mode(mode),
 m_fec(fec),
-m_amplitude(amplitude),
 m_reset(reset),
 m_debug(debug),
-m_direction(AMBE_DECODING),
-m_wavReader(NULL),
-m_wavWriter(writer),
-m_ambeReader(reader),
-m_ambeWriter(NULL),
-m_ambeBlockSize(0U)
+m_ambeBlockSize(0U),
+m_packet(NULL),
+m_packetLen(0U),
+m_resync(false),
+m_stale(false)
 {
-	assert(reader != NULL);
-	assert(writer != NULL);
+	m_packet = new unsigned char[BUFFER_LENGTH];
+
+	switch (mode) {
+	case MODE_DSTAR:
+		m_ambeBlockSize = fec ? 9U : 6U;
+		break;
+	case MODE_DMR:
+		m_ambeBlockSize = fec ? 9U : 7U;
+		break;
+	case MODE_P25:
+		m_ambeBlockSize = fec ? 18U : 11U;
+		break;
+	default:
+		break;
+	}
 }
 
 CDV3000SerialController::~CDV3000SerialController()
 {
+	delete[] m_packet;
 }
 
 bool CDV3000SerialController::open()
@@ -122,6 +127,8 @@ bool CDV3000SerialController::open()
 
 	RESP_TYPE type;
 
+	m_packetLen = 0U;
+
 	if (m_reset) {
 		do {
 			m_serial.write(DV3000_REQ_RESET, DV3000_REQ_RESET_LEN);
@@ -164,37 +171,34 @@ bool CDV3000SerialController::open()
 
 	::fprintf(stdout, "DVSI AMBE chip version is: %s\n", buffer + 5U);
 
+	if (m_mode == MODE_UNKNOWN)
+		return true;
+
 	do {
 		if (m_mode == MODE_DSTAR && m_fec) {
 			m_serial.write(DV3000_REQ_DSTAR_FEC, DV3000_REQ_DSTAR_FEC_LEN);
 			if (m_debug)
 				CUtils::dump("Configure D-Star + FEC", DV3000_REQ_DSTAR_FEC, DV3000_REQ_DSTAR_FEC_LEN);
-			m_ambeBlockSize = 9U;
 		} else if (m_mode == MODE_DSTAR && !m_fec) {
 			m_serial.write(DV3000_REQ_DSTAR_NOFEC, DV3000_REQ_DSTAR_NOFEC_LEN);
 			if (m_debug)
 				CUtils::dump("Configure D-Star", DV3000_REQ_DSTAR_NOFEC, DV3000_REQ_DSTAR_NOFEC_LEN);
-			m_ambeBlockSize = 6U;
 		} else if (m_mode == MODE_DMR && m_fec) {
 			m_serial.write(DV3000_REQ_DMR_FEC, DV3000_REQ_DMR_FEC_LEN);
 			if (m_debug)
 				CUtils::dump("Configure DMR + FEC", DV3000_REQ_DMR_FEC, DV3000_REQ_DMR_FEC_LEN);
-			m_ambeBlockSize = 9U;
 		} else if (m_mode == MODE_DMR && !m_fec) {
 			m_serial.write(DV3000_REQ_DMR_NOFEC, DV3000_REQ_DMR_NOFEC_LEN);
 			if (m_debug)
 				CUtils::dump("Configure DMR", DV3000_REQ_DMR_NOFEC, DV3000_REQ_DMR_NOFEC_LEN);
-			m_ambeBlockSize = 7U;
 		} else if (m_mode == MODE_P25 && m_fec) {
 			m_serial.write(DV3000_REQ_P25_FEC, DV3000_REQ_P25_FEC_LEN);
 			if (m_debug)
 				CUtils::dump("Configure P25 + FEC", DV3000_REQ_P25_FEC, DV3000_REQ_P25_FEC_LEN);
-			m_ambeBlockSize = 18U;
 		} else if (m_mode == MODE_P25 && !m_fec) {
 			m_serial.write(DV3000_REQ_P25_NOFEC, DV3000_REQ_P25_NOFEC_LEN);
 			if (m_debug)
 				CUtils::dump("Configure P25", DV3000_REQ_P25_NOFEC, DV3000_REQ_P25_NOFEC_LEN);
-			m_ambeBlockSize = 11U;
 		} else {
 			return false;
 		}
@@ -209,191 +213,244 @@ bool CDV3000SerialController::open()
 	return true;
 }
 
-void CDV3000SerialController::process()
+unsigned int CDV3000SerialController::getFrameLength() const
 {
-	unsigned int inCount  = 0U;
-	unsigned int outCount = 0U;
+	return m_ambeBlockSize;
+}
 
-	unsigned char* ambe = new unsigned char[m_ambeBlockSize];
+ENCODE_RESULT CDV3000SerialController::encode(const int16_t* audio, uint8_t* frame)
+{
+	assert(audio != NULL);
+	assert(frame != NULL);
 
-	if (m_direction == AMBE_ENCODING) {
-		assert(m_wavReader != NULL);
-		assert(m_ambeWriter != NULL);
+	unsigned char buffer[BUFFER_LENGTH];
+	::memcpy(buffer, DV3000_AUDIO_HEADER, DV3000_AUDIO_HEADER_LEN);
 
-		do {
-			if (inCount >= outCount) {
-				unsigned int outstanding = inCount - outCount;
-				if (outstanding < 4U) {
-					float audio[AUDIO_BLOCK_SIZE];
-					if (m_wavReader->read(audio, AUDIO_BLOCK_SIZE) == AUDIO_BLOCK_SIZE) {
-						encodeIn(audio, AUDIO_BLOCK_SIZE);
-						inCount++;
-					}
-				}
-			}
+	uint8_t* q = buffer + DV3000_AUDIO_HEADER_LEN;
+	for (unsigned int i = 0; i < AUDIO_BLOCK_SIZE; i++, q += 2U) {
+		q[0U] = (uint16_t(audio[i]) & 0xFF00U) >> 8;
+		q[1U] = (uint16_t(audio[i]) & 0x00FFU) >> 0;
+	}
 
-			CUtils::sleep(10U);
+	if (m_stale && !resync())
+		return ENCODE_ERROR;
 
-			if (encodeOut(ambe, m_ambeBlockSize)) {
-				m_ambeWriter->write(ambe, m_ambeBlockSize);
-				outCount++;
-			}
-		} while (inCount != outCount);
+	uint64_t start = CMetrics::start();
 
-		printf("Encoding: %u frames (%.2fs)\n", inCount, float(inCount) / 50.0F);
-	} else {
-		assert(m_ambeReader != NULL);
-		assert(m_wavWriter != NULL);
+	CTrace::event(TRACE_PACKET_TX, buffer, DV3000_AUDIO_HEADER_LEN + AUDIO_BLOCK_SIZE * 2U);
 
-		do {
-			if (inCount >= outCount) {
-				unsigned int outstanding = inCount - outCount;
-				if (outstanding < 4U) {
-					if (m_ambeReader->read(ambe, m_ambeBlockSize) == m_ambeBlockSize) {
-						decodeIn(ambe, m_ambeBlockSize);
-						inCount++;
-					}
-				}
-			}
+	m_serial.write(buffer, DV3000_AUDIO_HEADER_LEN + AUDIO_BLOCK_SIZE * 2U);
 
-			CUtils::sleep(10U);
+	if (waitResponse(RESP_AMBE, buffer, BUFFER_LENGTH) != RESP_AMBE)
+		return ENCODE_ERROR;
 
-			float audio[AUDIO_BLOCK_SIZE];
-			if (decodeOut(audio, AUDIO_BLOCK_SIZE)) {
-				m_wavWriter->write(audio, AUDIO_BLOCK_SIZE);
-				outCount++;
-			}
-		} while (inCount != outCount);
+	CMetrics::stop(STAGE_SERIAL, start);
 
-		printf("Decoding: %u frames (%.2fs)\n", inCount, float(inCount) / 50.0F);
-	}
+	::memcpy(frame, buffer + DV3000_AMBE_HEADER_LEN, m_ambeBlockSize);
 
-	delete[] ambe;
+	return ENCODE_FRAME;
 }
 
-void CDV3000SerialController::encodeIn(const float* audio, unsigned int length)
+bool CDV3000SerialController::decode(const uint8_t* frame, int16_t* audio)
 {
+	assert(frame != NULL);
 	assert(audio != NULL);
 
-	unsigned char buffer[DV3000_AUDIO_HEADER_LEN + AUDIO_BLOCK_SIZE * 2U];
-	::memcpy(buffer, DV3000_AUDIO_HEADER, DV3000_AUDIO_HEADER_LEN);
+	unsigned char buffer[BUFFER_LENGTH];
+	::memcpy(buffer, DV3000_AMBE_HEADER, DV3000_AMBE_HEADER_LEN);
 
-	int8_t* q = (int8_t*)(buffer + DV3000_AUDIO_HEADER_LEN);
-	for (unsigned int i = 0; i < AUDIO_BLOCK_SIZE; i++, q += 2U) {
-		int16_t word = int16_t(audio[i] * m_amplitude * 32767.0F);
+	buffer[2U] = m_ambeBlockSize + 2U;
+	buffer[5U] = m_ambeBlockSize * 8U;
 
-		q[0U] = (word & 0xFF00) >> 8;
-		q[1U] = (word & 0x00FF) >> 0;
-	}
+	::memcpy(buffer + DV3000_AMBE_HEADER_LEN, frame, m_ambeBlockSize);
 
-	m_serial.write(buffer, DV3000_AUDIO_HEADER_LEN + AUDIO_BLOCK_SIZE * 2U);
+	if (m_stale && !resync())
+		return false;
 
-	if (m_debug)
-		CUtils::dump("encodeIn", buffer, DV3000_AUDIO_HEADER_LEN + AUDIO_BLOCK_SIZE * 2U);
-}
+	uint64_t start = CMetrics::start();
 
-bool CDV3000SerialController::encodeOut(unsigned char* ambe, unsigned int length)
-{
-	assert(ambe != NULL);
+	CTrace::event(TRACE_PACKET_TX, buffer, DV3000_AMBE_HEADER_LEN + m_ambeBlockSize);
 
-	unsigned char buffer[BUFFER_LENGTH];
-	RESP_TYPE type = getResponse(buffer, BUFFER_LENGTH);
-	if (type != RESP_AMBE)
+	m_serial.write(buffer, DV3000_AMBE_HEADER_LEN + m_ambeBlockSize);
+
+	if (waitResponse(RESP_AUDIO, buffer, BUFFER_LENGTH) != RESP_AUDIO)
 		return false;
 
-	::memcpy(ambe, buffer + DV3000_AMBE_HEADER_LEN, m_ambeBlockSize);
+	CMetrics::stop(STAGE_SERIAL, start);
 
-	if (m_debug)
-		CUtils::dump("encodeOut", ambe, m_ambeBlockSize);
+	uint8_t* q = buffer + DV3000_AUDIO_HEADER_LEN;
+	for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++, q += 2U)
+		audio[i] = int16_t((q[0U] << 8) | (q[1U] << 0));
 
 	return true;
 }
 
-void CDV3000SerialController::decodeIn(const unsigned char* ambe, unsigned int length)
+// The encoder and decoder are initialised, the rate and other settings are kept
+bool CDV3000SerialController::reset()
 {
-	assert(ambe != NULL);
-
-	unsigned char buffer[DV3000_AMBE_HEADER_LEN + 25U];
-	::memcpy(buffer, DV3000_AMBE_HEADER, DV3000_AMBE_HEADER_LEN);
+	if (m_mode == MODE_UNKNOWN)
+		return false;
 
-	buffer[2U] = m_ambeBlockSize + 2U;
-	buffer[5U] = m_ambeBlockSize * 8U;
+	if (m_stale && !resync())
+		return false;
 
-	::memcpy(buffer + DV3000_AMBE_HEADER_LEN, ambe, m_ambeBlockSize);
+	unsigned char buffer[BUFFER_LENGTH];
 
-	m_serial.write(buffer, DV3000_AMBE_HEADER_LEN + m_ambeBlockSize);
+	CTrace::event(TRACE_PACKET_TX, DV3000_REQ_INIT, DV3000_REQ_INIT_LEN);
 
+	m_serial.write(DV3000_REQ_INIT, DV3000_REQ_INIT_LEN);
 	if (m_debug)
-		CUtils::dump("decodeIn", buffer, DV3000_AMBE_HEADER_LEN + m_ambeBlockSize);
+		CUtils::dump("Initialise", DV3000_REQ_INIT, DV3000_REQ_INIT_LEN);
+
+	return waitResponse(RESP_INIT, buffer, BUFFER_LENGTH) == RESP_INIT;
 }
 
-bool CDV3000SerialController::decodeOut(float* audio, unsigned int length)
+void CDV3000SerialController::close()
 {
-	assert(audio != NULL);
+	m_serial.close();
+}
 
-	unsigned char buffer[BUFFER_LENGTH];
-	RESP_TYPE type = getResponse(buffer, BUFFER_LENGTH);
-	if (type != RESP_AUDIO)
-		return false;
+bool CDV3000SerialController::writePacket(const unsigned char* packet, unsigned int length)
+{
+	assert(packet != NULL);
+	assert(length >= DV3000_HEADER_LEN);
+
+	CTrace::event(TRACE_PACKET_TX, packet, length);
 
-	uint8_t* q = (uint8_t*)(buffer + DV3000_AUDIO_HEADER_LEN);
-	for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++, q += 2U) {
-		int16_t word = (q[0] << 8) | (q[1U] << 0);
+	return m_serial.write(packet, length) == int(length);
+}
+
+// The bytes are collected in m_packet as they arrive, skipping anything
+// before a start byte, so this never waits for the rest of a packet
+int CDV3000SerialController::readPacket(unsigned char* buffer, unsigned int length)
+{
+	assert(buffer != NULL);
+
+	for (;;) {
+		unsigned int wanted = DV3000_HEADER_LEN;
+		if (m_packetLen >= DV3000_HEADER_LEN)
+			wanted = (m_packet[1U] & 0x0FU) * 256U + m_packet[2U] + DV3000_HEADER_LEN;
+
+		if (wanted > BUFFER_LENGTH) {
+			::fprintf(stderr, "DV3000SerialController: packet of %u bytes is too long, skipping\n", wanted);
+			CMetrics::add(COUNTER_DV3000_DROPPED);
+			m_packetLen = 0U;
+			continue;
+		}
+
+		if (m_packetLen == wanted)
+			break;
+
+		// Only one byte until the start has been found
+		int len = m_serial.read(m_packet + m_packetLen, (m_packetLen == 0U) ? 1U : wanted - m_packetLen);
+		if (len <= 0)
+			return len;
+
+		// Counted once for each run of bytes skipped
+		if (m_packetLen == 0U && m_packet[0U] != DV3000_START_BYTE) {
+			if (!m_resync)
+				CMetrics::add(COUNTER_DV3000_RESYNCED);
+			m_resync = true;
+			continue;
+		}
 
-		audio[i] = float(word) * m_amplitude / 32768.0F;
+		m_resync = false;
+
+		m_packetLen += (unsigned int)len;
 	}
 
-	if (m_debug)
-		CUtils::dump("decodeOut", (unsigned char*)audio, AUDIO_BLOCK_SIZE * sizeof(float));
+	unsigned int packetLen = m_packetLen;
+	m_packetLen = 0U;
 
-	return true;
+	if (packetLen > length) {
+		::fprintf(stderr, "DV3000SerialController: packet of %u bytes is too long for the buffer, skipping\n", packetLen);
+		CMetrics::add(COUNTER_DV3000_DROPPED);
+		return 0;
+	}
+
+	::memcpy(buffer, m_packet, packetLen);
+
+	CTrace::event(TRACE_PACKET_RX, buffer, packetLen);
+
+	return int(packetLen);
 }
 
-void CDV3000SerialController::close()
+#if !defined(_WIN32) && !defined(_WIN64)
+int CDV3000SerialController::getFD() const
 {
-	m_serial.close();
+	return m_serial.getFD();
 }
+#endif
 
-CDV3000SerialController::RESP_TYPE CDV3000SerialController::getResponse(unsigned char* buffer, unsigned int length)
+// Other responses are skipped until the wanted one arrives or the time is up,
+// however many of them there are
+CDV3000SerialController::RESP_TYPE CDV3000SerialController::waitResponse(RESP_TYPE wanted, unsigned char* buffer, unsigned int length)
 {
 	assert(buffer != NULL);
-	assert(length >= BUFFER_LENGTH);
 
-	int len = m_serial.read(buffer, 1U);
-	if (len < 0)
-		return RESP_ERROR;
-	else if (len == 0)
-		return RESP_NONE;
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RESPONSE_TIMEOUT_MS);
 
-	if (buffer[0U] != DV3000_START_BYTE)
-		return RESP_NONE;
+	do {
+		RESP_TYPE type = getResponse(buffer, length);
+		if (type == wanted || type == RESP_ERROR)
+			return type;
 
-	unsigned int offset = 1U;
+		if (type == RESP_NONE)
+			CUtils::sleep(1U);
+	} while (std::chrono::steady_clock::now() < deadline);
 
-	while (offset < 3U) {
-		len = m_serial.read(buffer + offset, 3U - offset);
-		if (len < 0)
-			return RESP_ERROR;
-		else if (len == 0)
-			CUtils::sleep(10U);
-		else
-			offset += len;
-	}
+	::fprintf(stderr, "DV3000SerialController: no response from the AMBE chip\n");
+	CMetrics::add(COUNTER_DV3000_DROPPED);
 
-	unsigned int respLen = (buffer[1U] & 0x0FU) * 256U + buffer[2U] + DV3000_HEADER_LEN;
+	// The answer may still arrive, and would be taken for that of the next request
+	m_stale = true;
 
-	while (offset < respLen) {
-		len = m_serial.read(buffer + offset, respLen - offset);
-		if (len < 0)
-			return RESP_ERROR;
-		else if (len == 0)
-			CUtils::sleep(10U);
-		else
-			offset += len;
-	}
+	return RESP_NONE;
+}
+
+// The chip answers in order, so once it has answered a request for its
+// product id any late answers to earlier requests have been thrown away
+bool CDV3000SerialController::resync()
+{
+	unsigned char buffer[BUFFER_LENGTH];
 
+	CTrace::event(TRACE_PACKET_TX, DV3000_REQ_PRODID, DV3000_REQ_PRODID_LEN);
+
+	m_serial.write(DV3000_REQ_PRODID, DV3000_REQ_PRODID_LEN);
 	if (m_debug)
-		CUtils::dump("Received", buffer, respLen);
+		CUtils::dump("Product Id", DV3000_REQ_PRODID, DV3000_REQ_PRODID_LEN);
+
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RESPONSE_TIMEOUT_MS);
+
+	do {
+		RESP_TYPE type = getResponse(buffer, BUFFER_LENGTH);
+		if (type == RESP_NAME) {
+			m_stale = false;
+			return true;
+		}
+
+		if (type == RESP_ERROR)
+			return false;
+
+		if (type == RESP_NONE)
+			CUtils::sleep(1U);
+	} while (std::chrono::steady_clock::now() < deadline);
+
+	::fprintf(stderr, "DV3000SerialController: the AMBE chip can't be resynchronised\n");
+
+	return false;
+}
+
+CDV3000SerialController::RESP_TYPE CDV3000SerialController::getResponse(unsigned char* buffer, unsigned int length)
+{
+	assert(buffer != NULL);
+	assert(length >= BUFFER_LENGTH);
+
+	int respLen = readPacket(buffer, length);
+	if (respLen < 0)
+		return RESP_ERROR;
+	else if (respLen == 0)
+		return RESP_NONE;
 
 	if (buffer[3U] == DV3000_TYPE_AUDIO) {
 		return RESP_AUDIO;
@@ -410,6 +467,8 @@ CDV3000SerialController::RESP_TYPE CDV3000SerialController::getResponse(unsigned
 			return RESP_RATET;
 		} else if (buffer[4U] == DV3000_CONTROL_READY) {
 			return RESP_READY;
+		} else if (buffer[4U] == DV3000_CONTROL_INIT) {
+			return RESP_INIT;
 		} else {
 			CUtils::dump("Unknown control data", buffer, respLen);
 			return RESP_UNKNOWN;
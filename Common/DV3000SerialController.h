@@ -19,56 +19,54 @@
 #ifndef	DV3000SerialController_H
 #define	DV3000SerialController_H
 
-#include "WAVFileReader.h"
-#include "WAVFileWriter.h"
-#include "AMBEFileReader.h"
-#include "AMBEFileWriter.h"
 #include "SerialController.h"
+#include "Vocoder.h"
 
 #include <string>
 
-enum AMBE_MODE {
-	MODE_DSTAR,
-	MODE_DMR,
-	MODE_P25,
-	MODE_M17_3200,
-	MODE_M17_1600,
-	MODE_UNKNOWN
-};
+// A DVSI AMBE3000 on a serial port, for D-Star, DMR/NXDN and P25 with the
+// USB3000-P25. With MODE_UNKNOWN open() only identifies the chip and leaves
+// it to be set up by whoever sends it packets. encode() and decode() have one
+// frame in flight at a time, which is slower than keeping the chip busy with
+// several but keeps every answer matched to its request.
+class CDV3000SerialController : public CVocoder {
+public:
+	CDV3000SerialController(const std::string& device, unsigned int speed, AMBE_MODE mode, bool fec, bool reset, bool debug);
+	virtual ~CDV3000SerialController();
 
-const unsigned int AUDIO_SAMPLE_RATE = 8000U;
-const unsigned int AUDIO_BLOCK_SIZE = AUDIO_SAMPLE_RATE / 50U;
+	virtual bool open();
 
-class CDV3000SerialController {
-public:
-	CDV3000SerialController(const std::string& device, unsigned int speed, AMBE_MODE mode, bool fec, float amplitude, bool reset, bool debug, CAMBEFileReader* reader, CWAVFileWriter* writer);
-	CDV3000SerialController(const std::string& device, unsigned int speed, AMBE_MODE mode, bool fec, float amplitude, bool reset, bool debug, CWAVFileReader* reader, CAMBEFileWriter* writer);
-	~CDV3000SerialController();
+	virtual unsigned int getFrameLength() const;
 
-	bool open();
+	virtual ENCODE_RESULT encode(const int16_t* audio, uint8_t* frame);
+	virtual bool decode(const uint8_t* frame, int16_t* audio);
 
-	void process();
+	// Initialises the state of the encoder and decoder between streams
+	virtual bool reset();
 
-	void close();
+	virtual void close();
 
-private:
-	enum AMBE_DIRECTION {
-		AMBE_ENCODING,
-		AMBE_DECODING
-	};
+	// Raw packets, for passing on the packets of other programs. The length
+	// of a complete packet from the chip is returned, zero if there isn't
+	// one yet, and -1 on an error.
+	bool writePacket(const unsigned char* packet, unsigned int length);
+	int  readPacket(unsigned char* buffer, unsigned int length);
 
+#if !defined(_WIN32) && !defined(_WIN64)
+	int  getFD() const;
+#endif
+
+private:
 	CSerialController m_serial;
 	AMBE_MODE         m_mode;
 	bool              m_fec;
-	float             m_amplitude;
 	bool              m_reset;
 	bool              m_debug;
-	AMBE_DIRECTION    m_direction;
-	CWAVFileReader*   m_wavReader;
-	CWAVFileWriter*   m_wavWriter;
-	CAMBEFileReader*  m_ambeReader;
-	CAMBEFileWriter*  m_ambeWriter;
 	unsigned int      m_ambeBlockSize;
+	unsigned char*    m_packet;
+	unsigned int      m_packetLen;
+	bool              m_resync;
+	bool              m_stale;
 
 	enum RESP_TYPE {
 		RESP_NONE,
@@ -80,15 +78,12 @@ private:
 		RESP_AMBE,
 		RESP_AUDIO,
 		RESP_READY,
+		RESP_INIT,
 		RESP_UNKNOWN
 	};
 
-	void encodeIn(const float* audio, unsigned int length);
-	bool encodeOut(unsigned char* ambe, unsigned int length);
-
-	void decodeIn(const unsigned char* ambe, unsigned int length);
-	bool decodeOut(float* audio, unsigned int length);
-
+	RESP_TYPE waitResponse(RESP_TYPE wanted, unsigned char* buffer, unsigned int length);
+	bool      resync();
 	RESP_TYPE getResponse(unsigned char* buffer, unsigned int length);
 };
 
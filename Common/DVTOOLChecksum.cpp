@@ -50,6 +50,32 @@ const uint16_t ccittTab[] = {
 	0xf78f,0xe606,0xd49d,0xc514,0xb1ab,0xa022,0x92b9,0x8330,
 	0x7bc7,0x6a4e,0x58d5,0x495c,0x3de3,0x2c6a,0x1ef1,0x0f78};
 
+// Table n gives the effect of a byte followed by n zero bytes, built from
+// ccittTab the first time it is needed
+struct CCCITTTables {
+	uint16_t m_table[8U][256U];
+
+	CCCITTTables()
+	{
+		for (unsigned int i = 0U; i < 256U; i++)
+			m_table[0U][i] = ccittTab[i];
+
+		for (unsigned int n = 1U; n < 8U; n++) {
+			for (unsigned int i = 0U; i < 256U; i++) {
+				uint16_t crc = m_table[n - 1U][i];
+				m_table[n][i] = (crc >> 8) ^ ccittTab[crc & 0xFFU];
+			}
+		}
+	}
+};
+
+static const CCCITTTables& getTables()
+{
+	static const CCCITTTables tables;
+
+	return tables;
+}
+
 CDVTOOLChecksum::CDVTOOLChecksum() :
 m_crc16(0xFFFFU)
 {
@@ -63,8 +89,24 @@ void CDVTOOLChecksum::update(const uint8_t* data, unsigned int length)
 {
 	assert(data != NULL);
 
+	const uint16_t (*t)[256U] = getTables().m_table;
+
+	uint16_t crc = m_crc16;
+
+	while (length >= 8U) {
+		crc ^= uint16_t(data[0U]) | (uint16_t(data[1U]) << 8);
+
+		crc = t[7U][crc & 0xFFU] ^ t[6U][crc >> 8] ^ t[5U][data[2U]] ^ t[4U][data[3U]] ^
+		      t[3U][data[4U]]    ^ t[2U][data[5U]] ^ t[1U][data[6U]] ^ t[0U][data[7U]];
+
+		data   += 8U;
+		length -= 8U;
+	}
+
 	for (unsigned int i = 0U; i < length; i++)
-		m_crc16 = uint16_t(m_crc8[1U]) ^ ccittTab[m_crc8[0U] ^ data[i]];
+		crc = (crc >> 8) ^ t[0U][(crc ^ data[i]) & 0xFFU];
+
+	m_crc16 = crc;
 }
 
 void CDVTOOLChecksum::result(uint8_t* data)
@@ -91,3 +133,25 @@ void CDVTOOLChecksum::reset()
 {
 	m_crc16 = 0xFFFFU;
 }
+
+unsigned int CDVTOOLChecksum::checkBlock(const uint8_t* data, unsigned int length, unsigned int count, bool* valid)
+{
+	assert(data != NULL);
+	assert(length > 2U);
+
+	unsigned int n = 0U;
+
+	for (unsigned int i = 0U; i < count; i++, data += length) {
+		CDVTOOLChecksum csum;
+		csum.update(data, length - 2U);
+
+		bool ok = csum.check(data + length - 2U);
+		if (ok)
+			n++;
+
+		if (valid != NULL)
+			valid[i] = ok;
+	}
+
+	return n;
+}
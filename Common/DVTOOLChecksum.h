@@ -12,10 +12,13 @@
  */
 
 #ifndef	DVTOOLChecksum_H
-#define	DTOOLChecksum_H
+#define	DVTOOLChecksum_H
 
 #include <cstdint>
+#include <cstddef>
 
+// The CRC-CCITT used in the D-Star radio header, calculated eight bytes at a
+// time using the slice-by-8 method.
 class CDVTOOLChecksum {
 public:
 	CDVTOOLChecksum();
@@ -29,6 +32,11 @@ public:
 
 	void reset();
 
+	// Checks count records of length bytes held one after another, each ending
+	// in the checksum of the bytes before it. Returns the number which are
+	// valid, and if valid isn't NULL sets an entry in it for each record.
+	static unsigned int checkBlock(const uint8_t* data, unsigned int length, unsigned int count, bool* valid = NULL);
+
 private:
 	union {
 		uint16_t m_crc16;
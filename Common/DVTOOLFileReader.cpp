@@ -0,0 +1,332 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "DVTOOLFileReader.h"
+#include "DVTOOLChecksum.h"
+#include "Utils.h"
+
+#include <cassert>
+#include <cstring>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const uint8_t DVTOOL_SIGNATURE[] = "DVTOOL";
+
+const uint8_t DSVT_SIGNATURE[] = "DSVT";
+const size_t  DSVT_SIGNATURE_LENGTH = 4U;
+
+const uint8_t HEADER_FLAG = 0x10;
+const uint8_t DATA_FLAG   = 0x20;
+
+const uint8_t TRAILER_MASK = 0x40;
+
+// The DSVT signature, flag, fixed data and sequence number before the payload
+const unsigned int RECORD_HEADER_LENGTH = 15U;
+const unsigned int MAX_RECORD_LENGTH    = 256U;
+
+const unsigned int AMBE_LENGTH = 9U;
+
+const size_t LONG_CALLSIGN_LENGTH      = 8U;
+const size_t SHORT_CALLSIGN_LENGTH     = 4U;
+const size_t RADIO_HEADER_LENGTH_BYTES = 41U;
+
+CDVTOOLFileReader::CDVTOOLFileReader(const std::string& filename) :
+m_filename(filename),
+m_file(NULL),
+m_data(NULL),
+m_size(0U),
+m_pos(0U),
+m_pending(),
+m_count(0U),
+m_headers(0U),
+m_badHeaders(0U),
+m_frame(),
+m_frameLen(0U),
+m_framePos(0U)
+{
+}
+
+CDVTOOLFileReader::~CDVTOOLFileReader()
+{
+}
+
+bool CDVTOOLFileReader::isDVTOOL(const uint8_t* data, unsigned int length)
+{
+	assert(data != NULL);
+
+	return length >= DVTOOL_SIGNATURE_LENGTH && ::memcmp(data, DVTOOL_SIGNATURE, DVTOOL_SIGNATURE_LENGTH) == 0;
+}
+
+bool CDVTOOLFileReader::open(const uint8_t* data, unsigned int length)
+{
+	if (m_filename == STREAM_NAME) {
+		m_file = CUtils::getStdin();
+		if (data != NULL)
+			m_pending.assign((const char*)data, length);
+	} else if (!map()) {
+		m_file = ::fopen(m_filename.c_str(), "rb");
+		if (m_file == NULL) {
+			::fprintf(stderr, "DVTOOLFileReader: could not open the DV-Tool file %s\n", m_filename.c_str());
+			return false;
+		}
+	}
+
+	uint8_t buffer[DVTOOL_SIGNATURE_LENGTH + sizeof(uint32_t)];
+	const uint8_t* header = rawGet(buffer, DVTOOL_SIGNATURE_LENGTH + sizeof(uint32_t));
+	if (header == NULL || !isDVTOOL(header, DVTOOL_SIGNATURE_LENGTH)) {
+		::fprintf(stderr, "DVTOOLFileReader: %s is not a DV-Tool file\n", m_filename.c_str());
+		close();
+		return false;
+	}
+
+	// uint32_t big-endian
+	header += DVTOOL_SIGNATURE_LENGTH;
+	m_count = (uint32_t(header[0U]) << 24) | (uint32_t(header[1U]) << 16) | (uint32_t(header[2U]) << 8) | uint32_t(header[3U]);
+
+	m_headers    = 0U;
+	m_badHeaders = 0U;
+	m_frameLen   = 0U;
+	m_framePos   = 0U;
+
+	return true;
+}
+
+unsigned int CDVTOOLFileReader::read(uint8_t* buffer, unsigned int length)
+{
+	assert(m_file != NULL || m_data != NULL);
+	assert(buffer != NULL);
+	assert(length > 0U);
+
+	unsigned int n = 0U;
+
+	while (n < length) {
+		if (m_framePos >= m_frameLen) {
+			m_frameLen = 0U;
+			m_framePos = 0U;
+
+			if (!readRecord())
+				break;
+
+			continue;
+		}
+
+		unsigned int len = m_frameLen - m_framePos;
+		if (len > length - n)
+			len = length - n;
+
+		::memcpy(buffer + n, m_frame + m_framePos, len);
+
+		m_framePos += len;
+		n += len;
+	}
+
+	return n;
+}
+
+// Reads one record, which may or may not be a voice frame, false at the end of the file
+bool CDVTOOLFileReader::readRecord()
+{
+	uint8_t buffer[MAX_RECORD_LENGTH];
+
+	const uint8_t* p = rawGet(buffer, sizeof(uint16_t));
+	if (p == NULL)
+		return false;
+
+	// uint16_t little-endian
+	unsigned int length = (unsigned int)p[0U] | ((unsigned int)p[1U] << 8);
+	if (length < RECORD_HEADER_LENGTH || length > MAX_RECORD_LENGTH) {
+		::fprintf(stderr, "DVTOOLFileReader: invalid record length of %u, stopping\n", length);
+		return false;
+	}
+
+	const uint8_t* record = rawGet(buffer, length);
+	if (record == NULL) {
+		::fprintf(stderr, "DVTOOLFileReader: the last record is incomplete\n");
+		return false;
+	}
+
+	if (::memcmp(record, DSVT_SIGNATURE, DSVT_SIGNATURE_LENGTH) != 0) {
+		::fprintf(stderr, "DVTOOLFileReader: invalid record signature, stopping\n");
+		return false;
+	}
+
+	uint8_t flag = record[4U];
+	uint8_t mask = record[14U];
+
+	const uint8_t* payload = record + RECORD_HEADER_LENGTH;
+	unsigned int payloadLength = length - RECORD_HEADER_LENGTH;
+
+	if (flag == HEADER_FLAG) {
+		m_headers++;
+
+		bool valid = false;
+		if (payloadLength >= RADIO_HEADER_LENGTH_BYTES) {
+			CDVTOOLChecksum csum;
+			csum.update(payload + 0U, 4U * LONG_CALLSIGN_LENGTH + SHORT_CALLSIGN_LENGTH + 3U);
+			valid = csum.check(payload + 4U * LONG_CALLSIGN_LENGTH + SHORT_CALLSIGN_LENGTH + 3U);
+		}
+
+		if (!valid) {
+			::fprintf(stderr, "DVTOOLFileReader: radio header %u has an invalid checksum\n", m_headers);
+			m_badHeaders++;
+		}
+
+		return true;
+	}
+
+	// The end of transmission and unknown records carry no audio
+	if (flag != DATA_FLAG || (mask & TRAILER_MASK) == TRAILER_MASK)
+		return true;
+
+	// Any slow data after the AMBE data is dropped
+	if (payloadLength < AMBE_LENGTH) {
+		::fprintf(stderr, "DVTOOLFileReader: voice record of %u bytes is too short, skipping\n", payloadLength);
+		return true;
+	}
+
+	::memcpy(m_frame, payload, AMBE_LENGTH);
+	m_frameLen = AMBE_LENGTH;
+
+	return true;
+}
+
+void CDVTOOLFileReader::close()
+{
+	assert(m_file != NULL || m_data != NULL);
+
+	if (m_data != NULL)
+		unmap();
+
+	if (m_file != NULL) {
+		if (m_filename != STREAM_NAME)
+			::fclose(m_file);
+		m_file = NULL;
+	}
+
+	if (m_badHeaders > 0U)
+		::fprintf(stderr, "DVTOOLFileReader: %u of %u radio headers had an invalid checksum\n", m_badHeaders, m_headers);
+}
+
+uint32_t CDVTOOLFileReader::getCount() const
+{
+	return m_count;
+}
+
+unsigned int CDVTOOLFileReader::getHeaders() const
+{
+	return m_headers;
+}
+
+unsigned int CDVTOOLFileReader::getBadHeaders() const
+{
+	return m_badHeaders;
+}
+
+unsigned int CDVTOOLFileReader::rawRead(uint8_t* buffer, unsigned int length)
+{
+	unsigned int n = 0U;
+
+	if (!m_pending.empty()) {
+		n = (unsigned int)m_pending.size();
+		if (n > length)
+			n = length;
+
+		::memcpy(buffer, m_pending.data(), n);
+		m_pending.erase(0U, n);
+	}
+
+	if (n < length)
+		n += (unsigned int)::fread(buffer + n, sizeof(uint8_t), length - n, m_file);
+
+	return n;
+}
+
+// A pointer to the next length bytes, in place when mapped and otherwise read
+// into the buffer, or NULL if there are fewer left
+const uint8_t* CDVTOOLFileReader::rawGet(uint8_t* buffer, unsigned int length)
+{
+	assert(buffer != NULL);
+
+	if (m_data != NULL) {
+		if (m_size - m_pos < length)
+			return NULL;
+
+		const uint8_t* p = m_data + m_pos;
+		m_pos += length;
+
+		return p;
+	}
+
+	if (rawRead(buffer, length) != length)
+		return NULL;
+
+	return buffer;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+bool CDVTOOLFileReader::map()
+{
+	int fd = ::open(m_filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	// Only regular files can be mapped, anything else is read with stdio
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || uint64_t(st.st_size) > uint64_t(SIZE_MAX)) {
+		::close(fd);
+		return false;
+	}
+
+	void* p = ::mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+	::close(fd);
+
+	if (p == MAP_FAILED)
+		return false;
+
+	::madvise(p, size_t(st.st_size), MADV_SEQUENTIAL);
+
+	m_data = (const uint8_t*)p;
+	m_size = uint64_t(st.st_size);
+	m_pos  = 0U;
+
+	return true;
+}
+
+void CDVTOOLFileReader::unmap()
+{
+	::munmap((void*)m_data, size_t(m_size));
+
+	m_data = NULL;
+	m_size = 0U;
+}
+#else
+bool CDVTOOLFileReader::map()
+{
+	return false;
+}
+
+void CDVTOOLFileReader::unmap()
+{
+}
+#endif
@@ -0,0 +1,76 @@
+/*
+ *   Copyright (C) 2026 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef	DVTOOLFileReader_H
+#define DVTOOLFileReader_H
+
+#include <cstdio>
+#include <cstdint>
+
+#include <string>
+
+const unsigned int DVTOOL_SIGNATURE_LENGTH = 6U;
+
+// read() returns the D-Star AMBE data, with FEC, from the voice records one
+// after another, the radio headers, slow data and end of transmission
+// records are skipped. A regular file is memory mapped where possible. A file
+// name of "-" reads from standard input, and the bytes already taken from it
+// when looking for the signature may be passed to open().
+class CDVTOOLFileReader {
+public:
+	CDVTOOLFileReader(const std::string& filename);
+	~CDVTOOLFileReader();
+
+	bool open(const uint8_t* data = NULL, unsigned int length = 0U);
+
+	unsigned int read(uint8_t* buffer, unsigned int length);
+
+	void close();
+
+	// The record count from the file header, zero if it wasn't known when written
+	uint32_t getCount() const;
+
+	unsigned int getHeaders() const;
+	unsigned int getBadHeaders() const;
+
+	static bool isDVTOOL(const uint8_t* data, unsigned int length);
+
+private:
+	std::string    m_filename;
+	FILE*          m_file;
+	const uint8_t* m_data;
+	uint64_t       m_size;
+	uint64_t       m_pos;
+	std::string    m_pending;
+	uint32_t       m_count;
+	unsigned int   m_headers;
+	unsigned int   m_badHeaders;
+	uint8_t        m_frame[9U];
+	unsigned int   m_frameLen;
+	unsigned int   m_framePos;
+
+	bool readRecord();
+
+	unsigned int rawRead(uint8_t* buffer, unsigned int length);
+	const uint8_t* rawGet(uint8_t* buffer, unsigned int length);
+
+	bool map();
+	void unmap();
+};
+
+#endif
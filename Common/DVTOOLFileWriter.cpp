@@ -18,6 +18,7 @@
 
 #include "DVTOOLFileWriter.h"
 #include "DVTOOLChecksum.h"
+#include "Utils.h"
 
 #include <cassert>
 #include <cstring>
@@ -40,6 +41,12 @@ const size_t  TRAILER_DATA_LENGTH = 12U;
 const uint8_t HEADER_MASK  = 0x80;
 const uint8_t TRAILER_MASK = 0x40;
 
+// The length, DSVT signature, flag, fixed data and sequence number before the payload
+const unsigned int RECORD_HEADER_LENGTH = 17U;
+
+// Records are written out once this much has been collected
+const unsigned int BUFFER_LENGTH = 65536U;
+
 const size_t LONG_CALLSIGN_LENGTH      = 8U;
 const size_t SHORT_CALLSIGN_LENGTH     = 4U;
 const size_t RADIO_HEADER_LENGTH_BYTES = 41U;
@@ -48,27 +55,43 @@ CDVTOOLFileWriter::CDVTOOLFileWriter(const std::string& filename) :
 m_filename(filename),
 m_file(),
 m_count(0U),
+m_header(0U),
 m_sequence(0U),
-m_offset(0)
+m_offset(0),
+m_buffer(NULL),
+m_length(0U),
+m_flushed(false)
 {
+	m_buffer = new uint8_t[BUFFER_LENGTH];
 }
 
 CDVTOOLFileWriter::~CDVTOOLFileWriter()
 {
+	delete[] m_buffer;
 }
 
-bool CDVTOOLFileWriter::open()
+bool CDVTOOLFileWriter::open(unsigned int frames)
 {
-	m_file = ::fopen(m_filename.c_str(), "wb");
+	if (m_filename == STREAM_NAME)
+		m_file = CUtils::getStdout();
+	else
+		m_file = ::fopen(m_filename.c_str(), "wb");
 	if (m_file == NULL)
 		return false;
 
-	::fwrite(DVTOOL_SIGNATURE, DVTOOL_SIGNATURE_LENGTH, 1U, m_file);
+	m_length  = 0U;
+	m_flushed = false;
+
+	::memcpy(m_buffer, DVTOOL_SIGNATURE, DVTOOL_SIGNATURE_LENGTH);
+	m_length += DVTOOL_SIGNATURE_LENGTH;
+
+	m_offset = long(m_length);
 
-	m_offset = ::ftell(m_file);
+	// The radio header record plus the frames, the trailer isn't counted
+	m_header = (frames > 0U) ? frames + 1U : 0U;
 
-	uint32_t dummy = 0U;
-	::fwrite(&dummy, sizeof(uint32_t), 1U, m_file);
+	setCount(m_buffer + m_length, m_header);
+	m_length += sizeof(uint32_t);
 
 	m_sequence = 0U;
 	m_count = 0U;
@@ -98,112 +121,140 @@ bool CDVTOOLFileWriter::writeHeader(const uint8_t* buffer, unsigned int length)
 	assert(buffer != NULL);
 	assert(length > 0U);
 
-	// uint16_t little-endian
-	uint16_t len = uint16SwapOnBE(length + 15U);
-	::fwrite(&len, sizeof(uint16_t), 1U, m_file);
-
-	::fwrite(DSVT_SIGNATURE, DSVT_SIGNATURE_LENGTH, 1U, m_file);
+	if (!addRecord(HEADER_FLAG, HEADER_MASK, buffer, length))
+		return false;
 
-	uint8_t byte = HEADER_FLAG;
-	::fwrite(&byte, sizeof(uint8_t), 1U, m_file);
+	m_count++;
 
-	::fwrite(FIXED_DATA, FIXED_DATA_LENGTH, 1U, m_file);
+	return true;
+}
 
-	byte = HEADER_MASK;
-	::fwrite(&byte, sizeof(uint8_t), 1U, m_file);
+bool CDVTOOLFileWriter::write(const uint8_t* buffer, unsigned int length)
+{
+	assert(buffer != NULL);
+	assert(length > 0U);
 
-	::fwrite(buffer, length, 1U, m_file);
+	if (!addRecord(DATA_FLAG, m_sequence, buffer, length))
+		return false;
 
 	m_count++;
+	m_sequence++;
+	if (m_sequence >= 0x15U)
+		m_sequence = 0U;
 
 	return true;
 }
 
-bool CDVTOOLFileWriter::write(const uint8_t* buffer, unsigned int length)
+bool CDVTOOLFileWriter::write(const uint8_t* frames, unsigned int length, unsigned int count)
 {
-	assert(buffer != NULL);
+	assert(frames != NULL);
 	assert(length > 0U);
 
+	for (unsigned int i = 0U; i < count; i++, frames += length) {
+		if (!write(frames, length))
+			return false;
+	}
+
+	return true;
+}
+
+// Adds a complete record to the buffer, which is written out when full
+bool CDVTOOLFileWriter::addRecord(uint8_t flag, uint8_t mask, const uint8_t* payload, unsigned int length)
+{
+	assert(payload != NULL);
+	assert(length + RECORD_HEADER_LENGTH <= BUFFER_LENGTH);
+
+	if (m_length + RECORD_HEADER_LENGTH + length > BUFFER_LENGTH) {
+		if (!flush())
+			return false;
+	}
+
+	uint8_t* p = m_buffer + m_length;
+
 	// uint16_t little-endian
-	uint16_t len = uint16SwapOnBE(length + 15U);
-	::fwrite(&len, sizeof(uint16_t), 1U, m_file);
+	unsigned int len = length + 15U;
+	p[0U] = uint8_t(len >> 0);
+	p[1U] = uint8_t(len >> 8);
 
-	::fwrite(DSVT_SIGNATURE, DSVT_SIGNATURE_LENGTH, 1U, m_file);
+	::memcpy(p + 2U, DSVT_SIGNATURE, DSVT_SIGNATURE_LENGTH);
 
-	uint8_t byte = DATA_FLAG;
-	::fwrite(&byte, sizeof(uint8_t), 1U, m_file);
+	p[6U] = flag;
 
-	::fwrite(FIXED_DATA, FIXED_DATA_LENGTH, 1U, m_file);
+	::memcpy(p + 7U, FIXED_DATA, FIXED_DATA_LENGTH);
 
-	byte = m_sequence;
-	::fwrite(&byte, sizeof(uint8_t), 1U, m_file);
+	p[16U] = mask;
 
-	::fwrite(buffer, length, 1U, m_file);
+	::memcpy(p + RECORD_HEADER_LENGTH, payload, length);
 
-	m_count++;
-	m_sequence++;
-	if (m_sequence >= 0x15U)
-		m_sequence = 0U;
+	m_length += RECORD_HEADER_LENGTH + length;
 
 	return true;
 }
 
-void CDVTOOLFileWriter::close()
+bool CDVTOOLFileWriter::flush()
 {
-	writeTrailer();
+	if (m_length == 0U)
+		return true;
 
-	::fseek(m_file, m_offset, SEEK_SET);
+	unsigned int length = m_length;
 
-	// uint32_t big-endian
-	uint32_t count = uint32SwapOnLE(m_count);
-	::fwrite(&count, sizeof(uint32_t), 1U, m_file);
+	m_length  = 0U;
+	m_flushed = true;
 
-	::fclose(m_file);
-	m_file = NULL;
+	if (::fwrite(m_buffer, sizeof(uint8_t), length, m_file) != length) {
+		::fprintf(stderr, "DVTOOLFileWriter: could not write to the DV-Tool file %s\n", m_filename.c_str());
+		return false;
+	}
+
+	return true;
 }
 
-bool CDVTOOLFileWriter::writeTrailer()
+void CDVTOOLFileWriter::close()
 {
-	// uint16_t little-endian
-	uint16_t len = uint16SwapOnBE(27U);
-	::fwrite(&len, sizeof(uint16_t), 1U, m_file);
+	writeTrailer();
 
-	::fwrite(DSVT_SIGNATURE, DSVT_SIGNATURE_LENGTH, 1U, m_file);
+	// While the start of the file is still in the buffer the count can be
+	// corrected there, even on a stream
+	if (!m_flushed && m_count != m_header) {
+		setCount(m_buffer + m_offset, m_count);
+		m_header = m_count;
+	}
 
-	uint8_t byte = DATA_FLAG;
-	::fwrite(&byte, sizeof(uint8_t), 1U, m_file);
+	flush();
 
-	::fwrite(FIXED_DATA, FIXED_DATA_LENGTH, 1U, m_file);
+	if (m_filename == STREAM_NAME) {
+		if (m_header > 0U && m_count != m_header)
+			::fprintf(stderr, "DVTOOLFileWriter: the header has a count of %u but %u records were written\n", m_header, m_count);
 
-	byte = TRAILER_MASK | m_sequence;
-	::fwrite(&byte, sizeof(uint8_t), 1U, m_file);
+		::fflush(m_file);
+		m_file = NULL;
+		return;
+	}
 
-	::fwrite(TRAILER_DATA, TRAILER_DATA_LENGTH, 1U, m_file);
+	if (m_count != m_header) {
+		::fseek(m_file, m_offset, SEEK_SET);
 
-	return true;
+		uint8_t count[sizeof(uint32_t)];
+		setCount(count, m_count);
+		::fwrite(count, sizeof(uint8_t), sizeof(uint32_t), m_file);
+	}
+
+	::fclose(m_file);
+	m_file = NULL;
 }
 
-uint16_t CDVTOOLFileWriter::uint16SwapOnBE(uint16_t value) const
+bool CDVTOOLFileWriter::writeTrailer()
 {
-// GNU specific
-#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
-	return ((value & 0x00FFU) << 8) |
-	       ((value & 0xFF00U) >> 8);
-#else
-	return value;
-#endif
+	return addRecord(DATA_FLAG, TRAILER_MASK | m_sequence, TRAILER_DATA, TRAILER_DATA_LENGTH);
 }
 
-uint32_t CDVTOOLFileWriter::uint32SwapOnLE(uint32_t value) const
+void CDVTOOLFileWriter::setCount(uint8_t* p, uint32_t count) const
 {
-// GNU specific
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-	return ((value & 0xFF000000U) >> 24) |
-	       ((value & 0x00FF0000U) >> 8) |
-	       ((value & 0x0000FF00U) << 8) |
-	       ((value & 0x000000FFU) << 24);
-#else
-	return value;
-#endif
-}
+	assert(p != NULL);
 
+	// uint32_t big-endian
+	p[0U] = uint8_t(count >> 24);
+	p[1U] = uint8_t(count >> 16);
+	p[2U] = uint8_t(count >> 8);
+	p[3U] = uint8_t(count >> 0);
+}
@@ -24,30 +24,43 @@
 
 #include <string>
 
+// The records are collected in a buffer and written out in large blocks. A
+// file name of "-" writes to standard output. As the record count in the
+// file header can't be updated at the end once it has been written out, it
+// must be passed to open() if it is to be correct, otherwise it is zero.
 class CDVTOOLFileWriter {
 public:
 	CDVTOOLFileWriter(const std::string& filename);
 	~CDVTOOLFileWriter();
 
-	bool open();
+	bool open(unsigned int frames = 0U);
 
 	bool write(const uint8_t* buffer, unsigned int length);
 
+	// Writes count frames of the given length held one after another
+	bool write(const uint8_t* frames, unsigned int length, unsigned int count);
+
 	void close();
 
 private:
 	std::string m_filename;
 	FILE*       m_file;
 	uint32_t    m_count;
+	uint32_t    m_header;
 	uint8_t     m_sequence;
 	long        m_offset;
+	uint8_t*    m_buffer;
+	unsigned int m_length;
+	bool        m_flushed;
 
 	bool writeHeader();
 	bool writeHeader(const uint8_t* buffer, unsigned int length);
 	bool writeTrailer();
 
-	uint16_t uint16SwapOnBE(uint16_t value) const;
-	uint32_t uint32SwapOnLE(uint32_t value) const;
+	bool addRecord(uint8_t flag, uint8_t mask, const uint8_t* payload, unsigned int length);
+	bool flush();
+
+	void setCount(uint8_t* p, uint32_t count) const;
 };
 
 #endif
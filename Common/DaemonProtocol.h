@@ -0,0 +1,74 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	DaemonProtocol_H
+#define	DaemonProtocol_H
+
+#include <cstdint>
+
+// The protocol spoken by ambedaemon over a Unix domain stream socket, all
+// values are little endian.
+//
+// Every message starts with a 4 byte header:
+//   type (DAEMON_MESSAGE)                         1 byte
+//   reserved, zero                                1 byte
+//   payload length                                2 bytes
+//
+// A session is started by the client with OPEN:
+//   input mode, AMBE_MODE or DAEMON_AUDIO_MODE    1 byte
+//   input FEC flag                                1 byte
+//   output mode, AMBE_MODE or DAEMON_AUDIO_MODE   1 byte
+//   output FEC flag                               1 byte
+//
+// Audio in and frames out is an encode, frames in and audio out a decode, and
+// frames in one mode to frames in another a transcode. The daemon replies
+// with OPEN:
+//   input frame length in bytes                   1 byte
+//   input frame duration in 20ms blocks           1 byte
+//   output frame length in bytes                  1 byte
+//   output frame duration in 20ms blocks          1 byte
+// where the audio side has a length of zero and 1 block, or with ERROR and a
+// text payload, after which the connection is closed. The AMBE chip is used
+// by one session at a time, so the reply to an OPEN which needs it waits
+// until any other session using it has been closed, and only one of the
+// modes may use it.
+//
+// The client then sends AUDIO, whole 20ms blocks of 160 16-bit samples at
+// 8kHz, or FRAME, whole frames, in messages of any size up to the maximum.
+// Each one is answered with the output that it completed, as one or more
+// AUDIO or FRAME messages, or none if it didn't complete a frame, so the
+// client must keep reading while it sends. Sending CLOSE ends the session,
+// the daemon answers with CLOSE after the last of the output and another
+// session may be opened on the same connection.
+
+enum DAEMON_MESSAGE {
+	DAEMON_OPEN  = 0x01,
+	DAEMON_AUDIO = 0x02,
+	DAEMON_FRAME = 0x03,
+	DAEMON_CLOSE = 0x04,
+	DAEMON_ERROR = 0x05
+};
+
+// In place of a mode in OPEN for the audio side of an encode or decode
+const uint8_t DAEMON_AUDIO_MODE = 0xFFU;
+
+const unsigned int DAEMON_HEADER_LENGTH   = 4U;
+const unsigned int DAEMON_OPEN_LENGTH     = 4U;
+const unsigned int DAEMON_MAX_PAYLOAD     = 65535U;
+
+#endif
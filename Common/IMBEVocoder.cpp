@@ -0,0 +1,158 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "IMBEVocoder.h"
+#include "IMBEFEC.h"
+#include "Metrics.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+const uint8_t  BIT_MASK_TABLE8[]  = { 0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02U, 0x01U };
+
+#define WRITE_BIT8(p,i,b)   p[(i)>>3] = (b) ? (p[(i)>>3] | BIT_MASK_TABLE8[(i)&7]) : (p[(i)>>3] & ~BIT_MASK_TABLE8[(i)&7])
+#define READ_BIT8(p,i)     (p[(i)>>3] & BIT_MASK_TABLE8[(i)&7])
+
+const unsigned int IMBE_LENGTH     = 11U;
+const unsigned int IMBE_FEC_LENGTH = 18U;
+
+// The vocoder works at a much lower level than full scale
+const float IMBE_ENCODE_GAIN = 3000.0F / 32767.0F;
+const float IMBE_DECODE_GAIN = 32768.0F / 4000.0F;
+
+// The number of bits in each of the eight IMBE parameters
+const unsigned int IMBE_BITS[] = {12U, 12U, 12U, 12U, 11U, 11U, 11U, 7U};
+
+CIMBEVocoder::CIMBEVocoder(bool fec) :
+m_vocoder(),
+m_fec(fec)
+{
+}
+
+CIMBEVocoder::~CIMBEVocoder()
+{
+}
+
+bool CIMBEVocoder::open()
+{
+	::fprintf(stdout, "Using open source IMBE vocoder by Pavel Yazev\n");
+
+	return true;
+}
+
+unsigned int CIMBEVocoder::getFrameLength() const
+{
+	return m_fec ? IMBE_FEC_LENGTH : IMBE_LENGTH;
+}
+
+ENCODE_RESULT CIMBEVocoder::encode(const int16_t* audio, uint8_t* frame)
+{
+	assert(audio != NULL);
+	assert(frame != NULL);
+
+	int16_t audioInt[AUDIO_BLOCK_SIZE];
+	for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++)
+		audioInt[i] = int16_t(float(audio[i]) * IMBE_ENCODE_GAIN);
+
+	int16_t frameInt[8U];
+	m_vocoder.imbe_encode(frameInt, audioInt);
+
+	uint8_t imbe[IMBE_LENGTH];
+	unsigned int offset = 0U;
+
+	for (unsigned int n = 0U; n < 8U; n++) {
+		int16_t mask = int16_t(1 << (IMBE_BITS[n] - 1U));
+		for (unsigned int i = 0U; i < IMBE_BITS[n]; i++, mask >>= 1, offset++)
+			WRITE_BIT8(imbe, offset, (frameInt[n] & mask) != 0);
+	}
+
+	if (m_fec) {
+		uint64_t start = CMetrics::start();
+
+		CIMBEFEC fec;
+		fec.encode(frame, imbe);
+
+		CMetrics::stop(STAGE_FEC, start);
+	} else {
+		::memcpy(frame, imbe, IMBE_LENGTH);
+	}
+
+	return ENCODE_FRAME;
+}
+
+bool CIMBEVocoder::decode(const uint8_t* frame, int16_t* audio)
+{
+	assert(frame != NULL);
+	assert(audio != NULL);
+
+	uint8_t imbe[IMBE_LENGTH];
+	if (m_fec) {
+		uint64_t start = CMetrics::start();
+
+		CIMBEFEC fec;
+		fec.decode(frame, imbe);
+
+		// The code bits aren't used to correct anything, but those that don't
+		// match the frame as it would be encoded show the errors received
+		if (CMetrics::isEnabled()) {
+			uint8_t check[IMBE_FEC_LENGTH];
+			fec.encode(check, imbe);
+
+			unsigned int errors = 0U;
+			for (unsigned int i = 0U; i < IMBE_FEC_LENGTH; i++) {
+				for (uint8_t bits = check[i] ^ frame[i]; bits != 0U; bits &= bits - 1U)
+					errors++;
+			}
+
+			CMetrics::add(COUNTER_FEC_ERRORS, errors);
+		}
+
+		CMetrics::stop(STAGE_FEC, start);
+	} else {
+		::memcpy(imbe, frame, IMBE_LENGTH);
+	}
+
+	int16_t frameInt[8U] = {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000};
+	unsigned int offset = 0U;
+
+	for (unsigned int n = 0U; n < 8U; n++) {
+		int16_t mask = int16_t(1 << (IMBE_BITS[n] - 1U));
+		for (unsigned int i = 0U; i < IMBE_BITS[n]; i++, mask >>= 1, offset++)
+			frameInt[n] |= READ_BIT8(imbe, offset) != 0x00U ? mask : 0x0000;
+	}
+
+	int16_t audioInt[AUDIO_BLOCK_SIZE];
+	m_vocoder.imbe_decode(frameInt, audioInt);
+
+	for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++) {
+		float sample = float(audioInt[i]) * IMBE_DECODE_GAIN;
+		if (sample > 32767.0F)
+			sample = 32767.0F;
+		else if (sample < -32768.0F)
+			sample = -32768.0F;
+
+		audio[i] = int16_t(sample);
+	}
+
+	return true;
+}
+
+void CIMBEVocoder::close()
+{
+}
@@ -0,0 +1,47 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(IMBEVocoder_H)
+#define	IMBEVocoder_H
+
+#include "Vocoder.h"
+
+#include "imbe_vocoder.h"
+
+// The open source IMBE vocoder by Pavel Yazev for P25, with or without the
+// P25 FEC
+class CIMBEVocoder : public CVocoder {
+public:
+	CIMBEVocoder(bool fec);
+	virtual ~CIMBEVocoder();
+
+	virtual bool open();
+
+	virtual unsigned int getFrameLength() const;
+
+	virtual ENCODE_RESULT encode(const int16_t* audio, uint8_t* frame);
+	virtual bool decode(const uint8_t* frame, int16_t* audio);
+
+	virtual void close();
+
+private:
+	imbe_vocoder m_vocoder;
+	bool         m_fec;
+};
+
+#endif
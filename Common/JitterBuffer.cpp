@@ -0,0 +1,221 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "JitterBuffer.h"
+#include "Metrics.h"
+
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+
+CJitterBuffer::CJitterBuffer(CAMBEFileReader* reader, unsigned int frameLength, unsigned int frameMs, bool live) :
+m_reader(reader),
+m_frameLength(frameLength),
+m_frameMs(frameMs),
+m_live(live),
+m_frames(),
+m_thread(),
+m_mutex(),
+m_cond(),
+m_ended(false),
+m_stop(false),
+m_playing(false),
+m_target(JITTER_MIN_TARGET),
+m_concealed(0U),
+m_last(),
+m_haveLast(false),
+m_ticks(0U),
+m_minDepth(JITTER_MAX_FRAMES),
+m_underrun(false),
+m_next(),
+m_played(0U),
+m_late(0U),
+m_repeated(0U),
+m_silent(0U),
+m_dropped(0U),
+m_delayTotal(0U),
+m_delayMax(0U)
+{
+	assert(reader != NULL);
+	assert(frameLength > 0U && frameLength <= VOCODER_MAX_FRAME_LENGTH);
+	assert(frameMs > 0U);
+}
+
+CJitterBuffer::~CJitterBuffer()
+{
+}
+
+void CJitterBuffer::start()
+{
+	m_next = std::chrono::steady_clock::now();
+
+	m_thread = std::thread(&CJitterBuffer::readThread, this);
+}
+
+// The thread only finishes at the end of the input
+void CJitterBuffer::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_cond.notify_all();
+
+	m_thread.join();
+}
+
+JITTER_FRAME CJitterBuffer::get(uint8_t* frame)
+{
+	assert(frame != NULL);
+
+	// After falling well behind, such as when the output was blocked, the
+	// clock starts again rather than rushing to catch up
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - m_next > std::chrono::seconds(1))
+		m_next = now;
+
+	std::this_thread::sleep_until(m_next);
+	m_next += std::chrono::milliseconds(m_frameMs);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!m_playing) {
+			if (m_frames.size() >= m_target || (m_ended && !m_frames.empty()))
+				m_playing = true;
+			else
+				return m_ended ? JITTER_END : JITTER_WAIT;
+		}
+
+		if (m_frames.empty()) {
+			if (m_ended)
+				return JITTER_END;
+
+			// Only the first frame period of an underrun raises the target
+			if (m_concealed == 0U && m_target < JITTER_MAX_TARGET)
+				m_target++;
+
+			m_concealed++;
+			m_underrun = true;
+
+			CMetrics::add(COUNTER_JITTER_CONCEALED);
+
+			if (m_haveLast && m_concealed <= JITTER_MAX_REPEATS) {
+				::memcpy(frame, m_last, m_frameLength);
+				m_repeated++;
+				return JITTER_REPEAT;
+			}
+
+			m_silent++;
+			return JITTER_SILENCE;
+		}
+
+		// Without sequence numbers the first frame after an underrun is
+		// taken to be the one that was missing
+		if (m_concealed > 0U) {
+			m_late++;
+			m_concealed = 0U;
+			CMetrics::add(COUNTER_JITTER_LATE);
+		}
+
+		const CJitterEntry& entry = m_frames.front();
+		::memcpy(frame, entry.m_data, m_frameLength);
+		::memcpy(m_last, entry.m_data, m_frameLength);
+		m_haveLast = true;
+
+		CMetrics::stop(STAGE_JITTER, entry.m_arrival);
+
+		m_frames.pop_front();
+		m_played++;
+
+		unsigned int depth = (unsigned int)m_frames.size();
+
+		m_delayTotal += depth;
+		if (depth > m_delayMax)
+			m_delayMax = depth;
+
+		if (depth < m_minDepth)
+			m_minDepth = depth;
+
+		if (++m_ticks >= JITTER_ADAPT_FRAMES) {
+			if (m_minDepth > m_target)
+				drop(m_minDepth - m_target);
+			else if (!m_underrun && m_target > JITTER_MIN_TARGET)
+				m_target--;
+
+			m_ticks    = 0U;
+			m_minDepth = JITTER_MAX_FRAMES;
+			m_underrun = false;
+		}
+	}
+
+	m_cond.notify_all();
+
+	return JITTER_FRAME_OK;
+}
+
+void CJitterBuffer::printStats() const
+{
+	double mean = (m_played > 0U) ? double(m_delayTotal) / double(m_played) : 0.0;
+
+	::fprintf(stdout, "Jitter buffer: %u frames played, %u late, %u repeated, %u silent, %u dropped, delay %.0fms mean %ums max\n",
+		m_played, m_late, m_repeated, m_silent, m_dropped, mean * double(m_frameMs), m_delayMax * m_frameMs);
+}
+
+void CJitterBuffer::readThread()
+{
+	for (;;) {
+		uint64_t start = CMetrics::start();
+
+		CJitterEntry entry;
+		if (m_reader->read(entry.m_data, m_frameLength) != m_frameLength)
+			break;
+
+		CMetrics::stop(STAGE_READ, start);
+		CMetrics::add(COUNTER_FRAMES_IN);
+
+		entry.m_arrival = CMetrics::start();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (!m_live)
+			m_cond.wait(lock, [this] { return m_stop || m_frames.size() < m_target; });
+
+		if (m_stop)
+			break;
+
+		if (m_frames.size() >= JITTER_MAX_FRAMES)
+			drop(1U);
+
+		m_frames.push_back(entry);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ended = true;
+}
+
+// The oldest frames go first, called with the lock held
+void CJitterBuffer::drop(unsigned int n)
+{
+	for (unsigned int i = 0U; i < n && !m_frames.empty(); i++) {
+		m_frames.pop_front();
+		m_dropped++;
+		CMetrics::add(COUNTER_JITTER_DROPPED);
+	}
+}
@@ -0,0 +1,115 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	JitterBuffer_H
+#define	JitterBuffer_H
+
+#include "AMBEFileReader.h"
+#include "Vocoder.h"
+
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <deque>
+
+#include <cstdint>
+
+enum JITTER_FRAME {
+	JITTER_FRAME_OK,
+	JITTER_REPEAT,
+	JITTER_SILENCE,
+	JITTER_WAIT,
+	JITTER_END
+};
+
+// The depth aimed for starts at the minimum and grows by a frame on each
+// underrun, up to the maximum target
+const unsigned int JITTER_MIN_TARGET = 2U;
+const unsigned int JITTER_MAX_TARGET = 10U;
+
+// The most frames held, the oldest is dropped beyond this
+const unsigned int JITTER_MAX_FRAMES = 25U;
+
+// How many times the last frame is repeated before silence is played
+const unsigned int JITTER_MAX_REPEATS = 3U;
+
+// How often, in frames, the depth is brought back towards the target
+const unsigned int JITTER_ADAPT_FRAMES = 250U;
+
+// Frames are read from the reader on a thread of their own, as they arrive,
+// and handed out by get() once every frame period of a monotonic clock.
+// When a frame is missing the last one is repeated a few times and then
+// silence is asked for. The target depth grows after an underrun, and if
+// there have been none for a while it shrinks again, with any frames above
+// it dropped, so that the delay stays bounded. A live input is never held
+// up, otherwise the reader waits until there is room so that a file is
+// played out at the real rate without any frames being dropped.
+class CJitterBuffer {
+public:
+	CJitterBuffer(CAMBEFileReader* reader, unsigned int frameLength, unsigned int frameMs, bool live);
+	~CJitterBuffer();
+
+	void start();
+
+	// Waits until the next frame period, JITTER_WAIT means that nothing is
+	// played while the buffer fills
+	JITTER_FRAME get(uint8_t* frame);
+
+	void stop();
+
+	void printStats() const;
+
+private:
+	struct CJitterEntry {
+		uint8_t  m_data[VOCODER_MAX_FRAME_LENGTH];
+		uint64_t m_arrival;
+	};
+
+	CAMBEFileReader*         m_reader;
+	unsigned int             m_frameLength;
+	unsigned int             m_frameMs;
+	bool                     m_live;
+	std::deque<CJitterEntry> m_frames;
+	std::thread              m_thread;
+	std::mutex               m_mutex;
+	std::condition_variable  m_cond;
+	bool                     m_ended;
+	bool                     m_stop;
+	bool                     m_playing;
+	unsigned int             m_target;
+	unsigned int             m_concealed;
+	uint8_t                  m_last[VOCODER_MAX_FRAME_LENGTH];
+	bool                     m_haveLast;
+	unsigned int             m_ticks;
+	unsigned int             m_minDepth;
+	bool                     m_underrun;
+	std::chrono::steady_clock::time_point m_next;
+	unsigned int             m_played;
+	unsigned int             m_late;
+	unsigned int             m_repeated;
+	unsigned int             m_silent;
+	unsigned int             m_dropped;
+	uint64_t                 m_delayTotal;
+	unsigned int             m_delayMax;
+
+	void readThread();
+	void drop(unsigned int n);
+};
+
+#endif
@@ -0,0 +1,289 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Metrics.h"
+#include "Trace.h"
+
+#include <chrono>
+
+#include <cassert>
+
+const char* COUNTER_NAMES[] = {"frames_in", "frames_out", "dv3000_dropped", "dv3000_resynced", "fec_errors", "jitter_concealed", "jitter_late", "jitter_dropped", "vad_silent"};
+const char* STAGE_NAMES[]   = {"read", "fec", "vocoder", "serial", "write", "jitter"};
+
+std::atomic<bool>                  CMetrics::m_enabled(false);
+bool                               CMetrics::m_print(false);
+std::atomic<CMetrics::CMetricsSet*> CMetrics::m_sets(NULL);
+
+thread_local CMetrics::CMetricsOwner CMetrics::m_owner = {NULL};
+
+FILE*                   CMetrics::m_log = NULL;
+unsigned int            CMetrics::m_interval = 0U;
+std::thread             CMetrics::m_thread;
+std::mutex              CMetrics::m_mutex;
+std::condition_variable CMetrics::m_cond;
+bool                    CMetrics::m_stop = false;
+
+void CMetrics::enable()
+{
+	m_enabled.store(true, std::memory_order_relaxed);
+
+	m_print = true;
+}
+
+bool CMetrics::isEnabled()
+{
+	return m_enabled.load(std::memory_order_relaxed);
+}
+
+// Only the owning thread writes to a set, so a plain load and store is
+// enough and avoids a locked instruction
+void CMetrics::add(METRICS_COUNTER counter, uint64_t n)
+{
+	assert(counter < COUNTER_COUNT);
+
+	if (!isEnabled())
+		return;
+
+	std::atomic<uint64_t>& value = getSet()->m_counters[counter];
+	value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// The stages are also traced, so the clock runs if either is enabled
+uint64_t CMetrics::start()
+{
+	if (!isEnabled() && !CTrace::isEnabled())
+		return 0U;
+
+	return now();
+}
+
+void CMetrics::stop(METRICS_STAGE stage, uint64_t start)
+{
+	assert(stage < STAGE_COUNT);
+
+	if (start == 0U)
+		return;
+
+	uint64_t ns = now() - start;
+
+	CTrace::stage(stage, start, ns);
+
+	if (!isEnabled())
+		return;
+
+	unsigned int bucket = 0U;
+	while (bucket < (METRICS_BUCKETS - 1U) && (ns >> bucket) > 0U)
+		bucket++;
+
+	CMetricsStage& s = getSet()->m_stages[stage];
+	s.m_count.store(s.m_count.load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+	s.m_total.store(s.m_total.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+	if (ns > s.m_max.load(std::memory_order_relaxed))
+		s.m_max.store(ns, std::memory_order_relaxed);
+	s.m_buckets[bucket].store(s.m_buckets[bucket].load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+}
+
+const char* CMetrics::getStageName(unsigned int stage)
+{
+	if (stage >= STAGE_COUNT)
+		return NULL;
+
+	return STAGE_NAMES[stage];
+}
+
+std::string CMetrics::toJSON()
+{
+	uint64_t counters[COUNTER_COUNT] = {0U};
+	uint64_t count[STAGE_COUNT] = {0U};
+	uint64_t total[STAGE_COUNT] = {0U};
+	uint64_t max[STAGE_COUNT] = {0U};
+	uint64_t buckets[STAGE_COUNT][METRICS_BUCKETS] = {{0U}};
+
+	for (CMetricsSet* set = m_sets.load(std::memory_order_acquire); set != NULL; set = set->m_next) {
+		for (unsigned int i = 0U; i < COUNTER_COUNT; i++)
+			counters[i] += set->m_counters[i].load(std::memory_order_relaxed);
+
+		for (unsigned int i = 0U; i < STAGE_COUNT; i++) {
+			const CMetricsStage& s = set->m_stages[i];
+			count[i] += s.m_count.load(std::memory_order_relaxed);
+			total[i] += s.m_total.load(std::memory_order_relaxed);
+
+			uint64_t ns = s.m_max.load(std::memory_order_relaxed);
+			if (ns > max[i])
+				max[i] = ns;
+
+			for (unsigned int j = 0U; j < METRICS_BUCKETS; j++)
+				buckets[i][j] += s.m_buckets[j].load(std::memory_order_relaxed);
+		}
+	}
+
+	char text[200U];
+	std::string json = "{\"counters\":{";
+
+	for (unsigned int i = 0U; i < COUNTER_COUNT; i++) {
+		::snprintf(text, sizeof(text), "%s\"%s\":%llu", (i > 0U) ? "," : "", COUNTER_NAMES[i], (unsigned long long)counters[i]);
+		json += text;
+	}
+
+	json += "},\"stages\":{";
+
+	bool first = true;
+	for (unsigned int i = 0U; i < STAGE_COUNT; i++) {
+		if (count[i] == 0U)
+			continue;
+
+		// The percentiles are the upper bounds of the buckets they fall in
+		uint64_t p50 = 0U;
+		uint64_t p99 = 0U;
+		uint64_t seen = 0U;
+		for (unsigned int j = 0U; j < METRICS_BUCKETS; j++) {
+			seen += buckets[i][j];
+			if (p50 == 0U && seen * 2U >= count[i])
+				p50 = uint64_t(1U) << j;
+			if (p99 == 0U && seen * 100U >= count[i] * 99U)
+				p99 = uint64_t(1U) << j;
+		}
+
+		::snprintf(text, sizeof(text), "%s\"%s\":{\"count\":%llu,\"mean_ns\":%.1f,\"max_ns\":%llu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"buckets\":[",
+			first ? "" : ",", STAGE_NAMES[i], (unsigned long long)count[i], double(total[i]) / double(count[i]), (unsigned long long)max[i], (unsigned long long)p50, (unsigned long long)p99);
+		json += text;
+
+		// Only the buckets in use, as pairs of upper bound and count
+		bool firstBucket = true;
+		for (unsigned int j = 0U; j < METRICS_BUCKETS; j++) {
+			if (buckets[i][j] == 0U)
+				continue;
+
+			::snprintf(text, sizeof(text), "%s[%llu,%llu]", firstBucket ? "" : ",", (unsigned long long)(uint64_t(1U) << j), (unsigned long long)buckets[i][j]);
+			json += text;
+			firstBucket = false;
+		}
+
+		json += "]}";
+		first = false;
+	}
+
+	json += "}}";
+
+	return json;
+}
+
+bool CMetrics::startLog(const std::string& fileName, unsigned int intervalMs)
+{
+	assert(intervalMs > 0U);
+
+	if (m_log != NULL)
+		return false;
+
+	m_log = ::fopen(fileName.c_str(), "at");
+	if (m_log == NULL) {
+		::fprintf(stderr, "Metrics: could not open the file %s\n", fileName.c_str());
+		return false;
+	}
+
+	m_enabled.store(true, std::memory_order_relaxed);
+
+	m_interval = intervalMs;
+	m_stop     = false;
+
+	m_thread = std::thread(&CMetrics::logThread);
+
+	return true;
+}
+
+// The final figures are written as the log is stopped
+void CMetrics::stopLog()
+{
+	if (m_log == NULL)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_cond.notify_all();
+
+	m_thread.join();
+
+	::fclose(m_log);
+	m_log = NULL;
+}
+
+void CMetrics::finish()
+{
+	stopLog();
+
+	if (m_print)
+		::fprintf(stdout, "%s\n", toJSON().c_str());
+}
+
+void CMetrics::logThread()
+{
+	bool stop = false;
+
+	while (!stop) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			stop = m_cond.wait_for(lock, std::chrono::milliseconds(m_interval), [] { return m_stop; });
+		}
+
+		::fprintf(m_log, "%s\n", toJSON().c_str());
+		::fflush(m_log);
+	}
+}
+
+// A thread takes a set given back by one which has finished, or else a new
+// one is added to the list. The figures in a set are never cleared, so those
+// of the threads which have ended still count, and the sets are never freed.
+CMetrics::CMetricsSet* CMetrics::getSet()
+{
+	if (m_owner.m_set != NULL)
+		return m_owner.m_set;
+
+	for (CMetricsSet* set = m_sets.load(std::memory_order_acquire); set != NULL; set = set->m_next) {
+		bool used = false;
+		if (set->m_used.compare_exchange_strong(used, true, std::memory_order_acquire, std::memory_order_relaxed)) {
+			m_owner.m_set = set;
+			return set;
+		}
+	}
+
+	CMetricsSet* set = new CMetricsSet();
+	set->m_used.store(true, std::memory_order_relaxed);
+
+	set->m_next = m_sets.load(std::memory_order_relaxed);
+	while (!m_sets.compare_exchange_weak(set->m_next, set, std::memory_order_release, std::memory_order_relaxed))
+		;
+
+	m_owner.m_set = set;
+
+	return set;
+}
+
+CMetrics::CMetricsOwner::~CMetricsOwner()
+{
+	if (m_set != NULL)
+		m_set->m_used.store(false, std::memory_order_release);
+}
+
+uint64_t CMetrics::now()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,132 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	Metrics_H
+#define	Metrics_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <cstdint>
+#include <cstdio>
+
+enum METRICS_STAGE {
+	STAGE_READ,
+	STAGE_FEC,
+	STAGE_VOCODER,
+	STAGE_SERIAL,
+	STAGE_WRITE,
+	STAGE_JITTER,
+	STAGE_COUNT
+};
+
+enum METRICS_COUNTER {
+	COUNTER_FRAMES_IN,
+	COUNTER_FRAMES_OUT,
+	COUNTER_DV3000_DROPPED,
+	COUNTER_DV3000_RESYNCED,
+	COUNTER_FEC_ERRORS,
+	COUNTER_JITTER_CONCEALED,
+	COUNTER_JITTER_LATE,
+	COUNTER_JITTER_DROPPED,
+	COUNTER_VAD_SILENT,
+	COUNTER_COUNT
+};
+
+// One bucket for each power of two of nanoseconds
+const unsigned int METRICS_BUCKETS = 40U;
+
+// How often the tools append the figures to the file given with -L
+const unsigned int METRICS_LOG_INTERVAL_MS = 1000U;
+
+// Counters and latency histograms for the whole process. Each thread has
+// its own set, found through a thread local pointer, which only that thread
+// updates and so needs no locking. When a thread ends its set is given to
+// the next new thread, so a long running program with a thread for each
+// connection only has as many sets as it had threads at once. The sets
+// are only added together when the figures are read. While disabled,
+// which is the default, each call costs a single relaxed load.
+class CMetrics {
+public:
+	static void enable();
+	static bool isEnabled();
+
+	static void add(METRICS_COUNTER counter, uint64_t n = 1U);
+
+	// A monotonic time in nanoseconds for timing a stage, zero if neither
+	// the metrics nor the trace are enabled
+	static uint64_t start();
+	static void     stop(METRICS_STAGE stage, uint64_t start);
+
+	// The name used for a stage in the JSON, NULL if unknown
+	static const char* getStageName(unsigned int stage);
+
+	// Every figure as a single line of JSON
+	static std::string toJSON();
+
+	// Appends toJSON() to the file every interval until stopLog()
+	static bool startLog(const std::string& fileName, unsigned int intervalMs);
+	static void stopLog();
+
+	// Stops the log and, if enable() was called, prints the figures to standard output
+	static void finish();
+
+private:
+	struct CMetricsStage {
+		std::atomic<uint64_t> m_count;
+		std::atomic<uint64_t> m_total;
+		std::atomic<uint64_t> m_max;
+		std::atomic<uint64_t> m_buckets[METRICS_BUCKETS];
+	};
+
+	struct CMetricsSet {
+		std::atomic<uint64_t> m_counters[COUNTER_COUNT];
+		CMetricsStage         m_stages[STAGE_COUNT];
+		std::atomic<bool>     m_used;
+		CMetricsSet*          m_next;
+	};
+
+	// Gives the set back when its thread ends
+	struct CMetricsOwner {
+		CMetricsSet* m_set;
+
+		~CMetricsOwner();
+	};
+
+	static std::atomic<bool>         m_enabled;
+	static bool                      m_print;
+	static std::atomic<CMetricsSet*> m_sets;
+
+	static thread_local CMetricsOwner m_owner;
+
+	static FILE*                     m_log;
+	static unsigned int              m_interval;
+	static std::thread               m_thread;
+	static std::mutex                m_mutex;
+	static std::condition_variable   m_cond;
+	static bool                      m_stop;
+
+	static CMetricsSet* getSet();
+	static uint64_t     now();
+	static void         logThread();
+};
+
+#endif
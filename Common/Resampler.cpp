@@ -0,0 +1,189 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Resampler.h"
+
+#include <cassert>
+#include <cstring>
+#include <cmath>
+
+// The number of zero crossings of the sinc on each side of its centre
+const unsigned int RESAMPLER_ZERO_CROSSINGS = 16U;
+
+// The cut off as a fraction of the lower of the two Nyquist frequencies
+const double RESAMPLER_CUTOFF = 0.9;
+
+const double RESAMPLER_KAISER_BETA = 8.0;
+
+// Each phase is padded to a multiple of this for the dot product
+const unsigned int RESAMPLER_LANES = 8U;
+
+static unsigned int gcd(unsigned int a, unsigned int b)
+{
+	while (b != 0U) {
+		unsigned int t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+// Modified Bessel function of the first kind, order zero
+static double bessel0(double x)
+{
+	double sum  = 1.0;
+	double term = 1.0;
+
+	for (unsigned int k = 1U; k < 50U; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum  += term;
+		if (term < sum * 1E-12)
+			break;
+	}
+
+	return sum;
+}
+
+// Written with independent partial sums so that the compiler can vectorise it
+static float dot(const float* a, const float* b, unsigned int length)
+{
+	float sum[RESAMPLER_LANES] = {0.0F};
+
+	for (unsigned int i = 0U; i < length; i += RESAMPLER_LANES) {
+		for (unsigned int j = 0U; j < RESAMPLER_LANES; j++)
+			sum[j] += a[i + j] * b[i + j];
+	}
+
+	return ((sum[0U] + sum[4U]) + (sum[1U] + sum[5U])) + ((sum[2U] + sum[6U]) + (sum[3U] + sum[7U]));
+}
+
+CResampler::CResampler(unsigned int inRate, unsigned int outRate, unsigned int blockSize) :
+m_interpolation(0U),
+m_decimation(0U),
+m_taps(0U),
+m_blockSize(blockSize),
+m_coeffs(NULL),
+m_buffer(NULL),
+m_count(0U),
+m_index(0U),
+m_phase(0U),
+m_centre(0U)
+{
+	assert(inRate > 0U);
+	assert(outRate > 0U);
+	assert(blockSize > 0U);
+
+	unsigned int div = gcd(inRate, outRate);
+	m_interpolation = outRate / div;
+	m_decimation    = inRate / div;
+
+	// The filter runs at the interpolated rate, and is widened when decimating
+	double scale = (inRate > outRate) ? double(inRate) / double(outRate) : 1.0;
+
+	m_taps = (unsigned int)::ceil(2.0 * RESAMPLER_ZERO_CROSSINGS * scale);
+	m_taps = (m_taps + RESAMPLER_LANES - 1U) / RESAMPLER_LANES * RESAMPLER_LANES;
+
+	// An even length so that the centre falls on a coefficient
+	unsigned int length = m_taps * m_interpolation;
+	m_centre = length / 2U;
+	double cutoff = RESAMPLER_CUTOFF * 0.5 / (double(m_interpolation) * scale);
+
+	double* prototype = new double[length];
+	for (unsigned int i = 0U; i < length; i++) {
+		double t = double(i) - double(m_centre);
+		double x = 2.0 * cutoff * t;
+		double sinc = (t == 0.0) ? 1.0 : ::sin(M_PI * x) / (M_PI * x);
+
+		double r = t / double(m_centre);
+		double window = (r >= -1.0 && r <= 1.0) ? bessel0(RESAMPLER_KAISER_BETA * ::sqrt(1.0 - r * r)) / bessel0(RESAMPLER_KAISER_BETA) : 0.0;
+
+		prototype[i] = sinc * window;
+	}
+
+	// Phase p holds every Lth coefficient starting at p, reversed so that it
+	// lines up with the input samples in time order, and normalised to unity gain
+	m_coeffs = new float[length];
+	for (unsigned int p = 0U; p < m_interpolation; p++) {
+		double sum = 0.0;
+		for (unsigned int j = 0U; j < m_taps; j++)
+			sum += prototype[p + j * m_interpolation];
+
+		for (unsigned int j = 0U; j < m_taps; j++)
+			m_coeffs[p * m_taps + m_taps - 1U - j] = float(prototype[p + j * m_interpolation] / sum);
+	}
+
+	delete[] prototype;
+
+	m_buffer = new float[m_taps + blockSize];
+
+	reset();
+}
+
+CResampler::~CResampler()
+{
+	delete[] m_coeffs;
+	delete[] m_buffer;
+}
+
+void CResampler::reset()
+{
+	::memset(m_buffer, 0x00U, (m_taps - 1U) * sizeof(float));
+
+	// The buffer starts at the first input sample less m_taps - 1, so the
+	// first output is m_centre samples along at the interpolated rate
+	m_count = m_taps - 1U;
+	m_index = m_centre / m_interpolation;
+	m_phase = m_centre % m_interpolation;
+}
+
+void CResampler::write(const float* data, unsigned int length)
+{
+	assert(data != NULL);
+	assert(length <= m_blockSize);
+
+	// Drop the samples that are no longer needed by any output
+	if (m_index > 0U) {
+		assert(m_index <= m_count);
+		m_count -= m_index;
+		::memmove(m_buffer, m_buffer + m_index, m_count * sizeof(float));
+		m_index = 0U;
+	}
+
+	assert(m_count + length <= m_taps + m_blockSize);
+
+	::memcpy(m_buffer + m_count, data, length * sizeof(float));
+	m_count += length;
+}
+
+unsigned int CResampler::read(float* data, unsigned int length)
+{
+	assert(data != NULL);
+
+	unsigned int n = 0U;
+
+	while (n < length && m_index + m_taps <= m_count) {
+		data[n++] = dot(m_coeffs + m_phase * m_taps, m_buffer + m_index, m_taps);
+
+		m_phase += m_decimation;
+		m_index += m_phase / m_interpolation;
+		m_phase %= m_interpolation;
+	}
+
+	return n;
+}
@@ -0,0 +1,53 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	Resampler_H
+#define	Resampler_H
+
+// A streaming rational resampler. The ratio of the two rates is reduced to
+// L/M and a Kaiser windowed sinc low pass filter is split into L phases, each
+// output sample is then the dot product of one phase with the most recent
+// input samples. The first output is taken at the centre of the filter so
+// that the output isn't delayed relative to the input.
+class CResampler {
+public:
+	CResampler(unsigned int inRate, unsigned int outRate, unsigned int blockSize);
+	~CResampler();
+
+	// Add up to blockSize input samples
+	void         write(const float* data, unsigned int length);
+
+	// Get up to length output samples from the input written so far
+	unsigned int read(float* data, unsigned int length);
+
+	void         reset();
+
+private:
+	unsigned int m_interpolation;
+	unsigned int m_decimation;
+	unsigned int m_taps;
+	unsigned int m_blockSize;
+	float*       m_coeffs;
+	float*       m_buffer;
+	unsigned int m_count;
+	unsigned int m_index;
+	unsigned int m_phase;
+	unsigned int m_centre;
+};
+
+#endif
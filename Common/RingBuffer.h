@@ -0,0 +1,128 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	RingBuffer_H
+#define	RingBuffer_H
+
+#include <algorithm>
+#include <atomic>
+
+#include <cassert>
+
+// A lock free ring buffer for one producer thread and one consumer thread.
+// The producer only moves the input index and the consumer only moves the
+// output index, one slot is always left empty to tell full from empty.
+template<class T> class CRingBuffer {
+public:
+	CRingBuffer(unsigned int length) :
+	m_length(length + 1U),
+	m_buffer(NULL),
+	m_iPtr(0U),
+	m_oPtr(0U)
+	{
+		assert(length > 0U);
+
+		m_buffer = new T[m_length];
+	}
+
+	~CRingBuffer()
+	{
+		delete[] m_buffer;
+	}
+
+	// Producer only
+	unsigned int addData(const T* buffer, unsigned int nSamples)
+	{
+		assert(buffer != NULL);
+
+		unsigned int iPtr = m_iPtr.load(std::memory_order_relaxed);
+		unsigned int oPtr = m_oPtr.load(std::memory_order_acquire);
+
+		nSamples = std::min(nSamples, space(iPtr, oPtr));
+
+		unsigned int first = std::min(nSamples, m_length - iPtr);
+		std::copy(buffer, buffer + first, m_buffer + iPtr);
+		std::copy(buffer + first, buffer + nSamples, m_buffer);
+
+		iPtr += nSamples;
+		if (iPtr >= m_length)
+			iPtr -= m_length;
+
+		m_iPtr.store(iPtr, std::memory_order_release);
+
+		return nSamples;
+	}
+
+	// Consumer only
+	unsigned int getData(T* buffer, unsigned int nSamples)
+	{
+		assert(buffer != NULL);
+
+		unsigned int iPtr = m_iPtr.load(std::memory_order_acquire);
+		unsigned int oPtr = m_oPtr.load(std::memory_order_relaxed);
+
+		nSamples = std::min(nSamples, size(iPtr, oPtr));
+
+		unsigned int first = std::min(nSamples, m_length - oPtr);
+		std::copy(m_buffer + oPtr, m_buffer + oPtr + first, buffer);
+		std::copy(m_buffer, m_buffer + nSamples - first, buffer + first);
+
+		oPtr += nSamples;
+		if (oPtr >= m_length)
+			oPtr -= m_length;
+
+		m_oPtr.store(oPtr, std::memory_order_release);
+
+		return nSamples;
+	}
+
+	// Only to be called when neither thread is using the buffer
+	void clear()
+	{
+		m_iPtr.store(0U);
+		m_oPtr.store(0U);
+	}
+
+	unsigned int freeSpace() const
+	{
+		return space(m_iPtr.load(std::memory_order_acquire), m_oPtr.load(std::memory_order_acquire));
+	}
+
+	unsigned int dataSize() const
+	{
+		return size(m_iPtr.load(std::memory_order_acquire), m_oPtr.load(std::memory_order_acquire));
+	}
+
+private:
+	unsigned int              m_length;
+	T*                        m_buffer;
+	std::atomic<unsigned int> m_iPtr;
+	std::atomic<unsigned int> m_oPtr;
+
+	unsigned int size(unsigned int iPtr, unsigned int oPtr) const
+	{
+		return (iPtr >= oPtr) ? iPtr - oPtr : m_length - oPtr + iPtr;
+	}
+
+	unsigned int space(unsigned int iPtr, unsigned int oPtr) const
+	{
+		return m_length - 1U - size(iPtr, oPtr);
+	}
+};
+
+#endif
@@ -358,4 +358,9 @@ void CSerialController::close()
 	m_fd = -1;
 }
 
+int CSerialController::getFD() const
+{
+	return m_fd;
+}
+
 #endif
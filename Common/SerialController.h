@@ -52,6 +52,11 @@ public:
 
 	void close();
 
+#if !defined(_WIN32) && !defined(_WIN64)
+	// For waiting on the port with poll() or epoll
+	int getFD() const;
+#endif
+
 private:
 	std::string    m_device;
 	SERIAL_SPEED   m_speed;
@@ -0,0 +1,248 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Trace.h"
+
+#include <chrono>
+
+#include <cassert>
+#include <cstring>
+
+std::atomic<bool>               CTrace::m_enabled(false);
+std::atomic<CTrace::CTraceRing*> CTrace::m_rings(NULL);
+std::atomic<unsigned int>       CTrace::m_count(0U);
+
+thread_local CTrace::CTraceOwner CTrace::m_owner = {NULL};
+
+FILE*                   CTrace::m_file = NULL;
+std::thread             CTrace::m_thread;
+std::mutex              CTrace::m_mutex;
+std::condition_variable CTrace::m_cond;
+bool                    CTrace::m_stop = false;
+
+bool CTrace::open(const std::string& fileName)
+{
+	if (m_file != NULL)
+		return false;
+
+	m_file = ::fopen(fileName.c_str(), "wb");
+	if (m_file == NULL) {
+		::fprintf(stderr, "Trace: could not open the file %s\n", fileName.c_str());
+		return false;
+	}
+
+	uint8_t header[TRACE_HEADER_LENGTH];
+	::memset(header, 0x00U, TRACE_HEADER_LENGTH);
+	::memcpy(header, TRACE_MAGIC, 4U);
+	header[4U] = TRACE_VERSION;
+
+	if (::fwrite(header, 1U, TRACE_HEADER_LENGTH, m_file) != TRACE_HEADER_LENGTH) {
+		::fprintf(stderr, "Trace: could not write to the file %s\n", fileName.c_str());
+		::fclose(m_file);
+		m_file = NULL;
+		return false;
+	}
+
+	m_stop = false;
+
+	m_thread = std::thread(&CTrace::writeThread);
+
+	m_enabled.store(true, std::memory_order_relaxed);
+
+	return true;
+}
+
+// Whatever is left in the rings is written out before the file is closed
+void CTrace::close()
+{
+	if (m_file == NULL)
+		return;
+
+	m_enabled.store(false, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_cond.notify_all();
+
+	m_thread.join();
+
+	::fclose(m_file);
+	m_file = NULL;
+
+	uint64_t dropped = 0U;
+	for (CTraceRing* ring = m_rings.load(std::memory_order_acquire); ring != NULL; ring = ring->m_next)
+		dropped += ring->m_dropped.load(std::memory_order_relaxed);
+
+	if (dropped > 0U)
+		::fprintf(stderr, "Trace: %llu events were dropped\n", (unsigned long long)dropped);
+}
+
+bool CTrace::isEnabled()
+{
+	return m_enabled.load(std::memory_order_relaxed);
+}
+
+void CTrace::event(TRACE_TYPE type, const uint8_t* data, unsigned int length)
+{
+	assert(data != NULL);
+
+	if (!isEnabled())
+		return;
+
+	CTraceEvent event;
+	event.m_time   = now();
+	event.m_length = (length > 0xFFFFU) ? 0xFFFFU : uint16_t(length);
+	event.m_type   = uint8_t(type);
+	event.m_stage  = 0U;
+
+	::memset(event.m_data, 0x00U, TRACE_DATA_LENGTH);
+	::memcpy(event.m_data, data, (length < TRACE_DATA_LENGTH) ? length : TRACE_DATA_LENGTH);
+
+	add(event);
+}
+
+void CTrace::stage(unsigned int stage, uint64_t start, uint64_t ns)
+{
+	if (!isEnabled())
+		return;
+
+	CTraceEvent event;
+	event.m_time   = start;
+	event.m_length = 0U;
+	event.m_type   = uint8_t(TRACE_STAGE);
+	event.m_stage  = uint8_t(stage);
+
+	::memset(event.m_data, 0x00U, TRACE_DATA_LENGTH);
+	for (unsigned int i = 0U; i < 8U; i++)
+		event.m_data[i] = uint8_t(ns >> (i * 8U));
+
+	add(event);
+}
+
+// Only the owning thread moves the head and only the writer the tail
+void CTrace::add(const CTraceEvent& event)
+{
+	CTraceRing* ring = getRing();
+
+	unsigned int head = ring->m_head.load(std::memory_order_relaxed);
+	unsigned int tail = ring->m_tail.load(std::memory_order_acquire);
+
+	if (head - tail >= TRACE_RING_EVENTS) {
+		ring->m_dropped.store(ring->m_dropped.load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+		return;
+	}
+
+	ring->m_events[head % TRACE_RING_EVENTS] = event;
+
+	ring->m_head.store(head + 1U, std::memory_order_release);
+}
+
+// A thread takes a ring given back by one which has finished, or else a new
+// one is added to the list. The rings are never freed.
+CTrace::CTraceRing* CTrace::getRing()
+{
+	if (m_owner.m_ring != NULL)
+		return m_owner.m_ring;
+
+	for (CTraceRing* ring = m_rings.load(std::memory_order_acquire); ring != NULL; ring = ring->m_next) {
+		bool used = false;
+		if (ring->m_used.compare_exchange_strong(used, true, std::memory_order_acquire, std::memory_order_relaxed)) {
+			m_owner.m_ring = ring;
+			return ring;
+		}
+	}
+
+	CTraceRing* ring = new CTraceRing();
+	ring->m_used.store(true, std::memory_order_relaxed);
+	ring->m_thread = uint16_t(m_count.fetch_add(1U, std::memory_order_relaxed) + 1U);
+
+	ring->m_next = m_rings.load(std::memory_order_relaxed);
+	while (!m_rings.compare_exchange_weak(ring->m_next, ring, std::memory_order_release, std::memory_order_relaxed))
+		;
+
+	m_owner.m_ring = ring;
+
+	return ring;
+}
+
+CTrace::CTraceOwner::~CTraceOwner()
+{
+	if (m_ring != NULL)
+		m_ring->m_used.store(false, std::memory_order_release);
+}
+
+uint64_t CTrace::now()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void CTrace::writeThread()
+{
+	bool stop = false;
+
+	while (!stop) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			stop = m_cond.wait_for(lock, std::chrono::milliseconds(TRACE_FLUSH_MS), [] { return m_stop; });
+		}
+
+		if (!flush()) {
+			::fprintf(stderr, "Trace: could not write to the file, stopping\n");
+			m_enabled.store(false, std::memory_order_relaxed);
+			return;
+		}
+	}
+}
+
+// Empties every ring into the file
+bool CTrace::flush()
+{
+	for (CTraceRing* ring = m_rings.load(std::memory_order_acquire); ring != NULL; ring = ring->m_next) {
+		unsigned int head = ring->m_head.load(std::memory_order_acquire);
+		unsigned int tail = ring->m_tail.load(std::memory_order_relaxed);
+
+		for (; tail != head; tail++) {
+			const CTraceEvent& event = ring->m_events[tail % TRACE_RING_EVENTS];
+
+			uint8_t buffer[TRACE_EVENT_LENGTH];
+			for (unsigned int i = 0U; i < 8U; i++)
+				buffer[i] = uint8_t(event.m_time >> (i * 8U));
+
+			buffer[8U]  = uint8_t(ring->m_thread);
+			buffer[9U]  = uint8_t(ring->m_thread >> 8);
+			buffer[10U] = event.m_type;
+			buffer[11U] = event.m_stage;
+			buffer[12U] = uint8_t(event.m_length);
+			buffer[13U] = uint8_t(event.m_length >> 8);
+			buffer[14U] = 0x00U;
+			buffer[15U] = 0x00U;
+
+			::memcpy(buffer + 16U, event.m_data, TRACE_DATA_LENGTH);
+
+			if (::fwrite(buffer, 1U, TRACE_EVENT_LENGTH, m_file) != TRACE_EVENT_LENGTH)
+				return false;
+		}
+
+		ring->m_tail.store(tail, std::memory_order_release);
+	}
+
+	return ::fflush(m_file) == 0;
+}
@@ -0,0 +1,135 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	Trace_H
+#define	Trace_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <cstdint>
+#include <cstdio>
+
+// The trace file format, all values are little endian.
+//
+// File header, 8 bytes:
+//   "ATRC", version (1 byte), 3 reserved bytes
+//
+// Then the events, 32 bytes each, in the order they were written out which
+// is only in time order for each thread:
+//   time in ns from an arbitrary start     8 bytes
+//   thread number                          2 bytes
+//   type (TRACE_TYPE)                      1 byte
+//   stage (METRICS_STAGE) for a stage      1 byte
+//   length of the data in bytes            2 bytes
+//   reserved                               2 bytes
+//   the first TRACE_DATA_LENGTH bytes of the data, or for a stage its
+//   duration in ns (8 bytes)              16 bytes
+
+const uint8_t  TRACE_MAGIC[]  = {'A', 'T', 'R', 'C'};
+const uint8_t  TRACE_VERSION  = 1U;
+
+const unsigned int TRACE_HEADER_LENGTH = 8U;
+const unsigned int TRACE_EVENT_LENGTH  = 32U;
+const unsigned int TRACE_DATA_LENGTH   = 16U;
+
+enum TRACE_TYPE {
+	TRACE_PACKET_TX = 1,
+	TRACE_PACKET_RX,
+	TRACE_FRAME_IN,
+	TRACE_FRAME_OUT,
+	TRACE_AUDIO_IN,
+	TRACE_AUDIO_OUT,
+	TRACE_STAGE
+};
+
+// Events for each thread
+const unsigned int TRACE_RING_EVENTS = 4096U;
+
+// How often the rings are written out
+const unsigned int TRACE_FLUSH_MS = 10U;
+
+// Timestamped events kept in binary in a ring for each thread and written to
+// a file by a thread of its own, so that tracing the packets and frames as
+// they pass costs a copy of a few bytes rather than formatting and printing
+// them. A ring belongs to one thread at a time and is passed on to a new
+// thread once its owner has finished. If the writer falls behind an event
+// is dropped rather than the caller waiting. AMBETRACE turns the file into
+// text or Chrome trace JSON.
+class CTrace {
+public:
+	static bool open(const std::string& fileName);
+	static void close();
+
+	static bool isEnabled();
+
+	// A packet, frame or block of audio, only the start of which is kept
+	static void event(TRACE_TYPE type, const uint8_t* data, unsigned int length);
+
+	// A stage of the work which took ns from start, on the CMetrics clock
+	static void stage(unsigned int stage, uint64_t start, uint64_t ns);
+
+private:
+	struct CTraceEvent {
+		uint64_t m_time;
+		uint16_t m_length;
+		uint8_t  m_type;
+		uint8_t  m_stage;
+		uint8_t  m_data[TRACE_DATA_LENGTH];
+	};
+
+	struct CTraceRing {
+		CTraceEvent               m_events[TRACE_RING_EVENTS];
+		std::atomic<unsigned int> m_head;
+		std::atomic<unsigned int> m_tail;
+		std::atomic<uint64_t>     m_dropped;
+		std::atomic<bool>         m_used;
+		uint16_t                  m_thread;
+		CTraceRing*               m_next;
+	};
+
+	// Gives the ring back when its thread ends
+	struct CTraceOwner {
+		CTraceRing* m_ring;
+
+		~CTraceOwner();
+	};
+
+	static std::atomic<bool>         m_enabled;
+	static std::atomic<CTraceRing*>  m_rings;
+	static std::atomic<unsigned int> m_count;
+
+	static thread_local CTraceOwner  m_owner;
+
+	static FILE*                     m_file;
+	static std::thread               m_thread;
+	static std::mutex                m_mutex;
+	static std::condition_variable   m_cond;
+	static bool                      m_stop;
+
+	static CTraceRing* getRing();
+	static void        add(const CTraceEvent& event);
+	static uint64_t    now();
+	static void        writeThread();
+	static bool        flush();
+};
+
+#endif
@@ -73,12 +73,58 @@ void CUtils::dump(const char* title, const unsigned char* data, unsigned int len
 #if defined(_WIN32) || defined(_WIN64)
 
 #include <Windows.h>
+#include <fcntl.h>
+#include <io.h>
 
 void CUtils::sleep(unsigned int ms)
 {
 	::Sleep(ms);
 }
 
+FILE* CUtils::getStdin()
+{
+	::_setmode(::_fileno(stdin), _O_BINARY);
+
+	return stdin;
+}
+
+FILE* CUtils::getStdout()
+{
+	static FILE* fp = NULL;
+
+	if (fp != NULL)
+		return fp;
+
+	::fflush(stdout);
+
+	int fd = ::_dup(::_fileno(stdout));
+	if (fd < 0)
+		return NULL;
+
+	::_setmode(fd, _O_BINARY);
+	::_dup2(::_fileno(stderr), ::_fileno(stdout));
+
+	fp = ::_fdopen(fd, "wb");
+	if (fp != NULL)
+		::setvbuf(fp, NULL, _IONBF, 0U);
+
+	return fp;
+}
+
+bool CUtils::seek(FILE* fp, int64_t offset, int whence)
+{
+	assert(fp != NULL);
+
+	return ::_fseeki64(fp, offset, whence) == 0;
+}
+
+int64_t CUtils::tell(FILE* fp)
+{
+	assert(fp != NULL);
+
+	return ::_ftelli64(fp);
+}
+
 #else
 
 #include <unistd.h>
@@ -88,4 +134,49 @@ void CUtils::sleep(unsigned int ms)
 	::usleep(ms * 1000);
 }
 
+FILE* CUtils::getStdin()
+{
+	return stdin;
+}
+
+FILE* CUtils::getStdout()
+{
+	static FILE* fp = NULL;
+
+	if (fp != NULL)
+		return fp;
+
+	::fflush(stdout);
+
+	int fd = ::dup(STDOUT_FILENO);
+	if (fd < 0)
+		return NULL;
+
+	::dup2(STDERR_FILENO, STDOUT_FILENO);
+
+	fp = ::fdopen(fd, "wb");
+	if (fp != NULL)
+		::setvbuf(fp, NULL, _IONBF, 0U);
+
+	return fp;
+}
+
+// off_t is 64 bits with _FILE_OFFSET_BITS=64, which the Makefile sets
+bool CUtils::seek(FILE* fp, int64_t offset, int whence)
+{
+	assert(fp != NULL);
+
+	if (int64_t(off_t(offset)) != offset)
+		return false;
+
+	return ::fseeko(fp, off_t(offset), whence) == 0;
+}
+
+int64_t CUtils::tell(FILE* fp)
+{
+	assert(fp != NULL);
+
+	return int64_t(::ftello(fp));
+}
+
 #endif
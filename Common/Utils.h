@@ -19,12 +19,30 @@
 #ifndef	Utils_H
 #define	Utils_H
 
+#include <cstdint>
+#include <cstdio>
+
+// The name used on the command line for standard input or output
+const char STREAM_NAME[] = "-";
+
 class CUtils {
 public:
 	static void dump(const char* title, const unsigned char* data, unsigned int length);
 
 	static void sleep(unsigned int ms);
 
+	// Standard input, in binary mode
+	static FILE* getStdin();
+
+	// The original standard output, in binary mode and unbuffered. Standard
+	// output is then pointed at standard error so that messages printed by
+	// the tools don't end up in the data stream.
+	static FILE* getStdout();
+
+	// fseek() and ftell() with 64 bit offsets, even where a long is 32 bits
+	static bool    seek(FILE* fp, int64_t offset, int whence);
+	static int64_t tell(FILE* fp);
+
 private:
 };
 
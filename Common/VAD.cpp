@@ -0,0 +1,61 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "VAD.h"
+
+#include <cassert>
+#include <cmath>
+
+CVAD::CVAD(float level, unsigned int hangover) :
+m_threshold(0.0F),
+m_hangover(hangover),
+m_count(0U)
+{
+	// The threshold is kept as a mean square of full scale samples, so that
+	// no logarithm is needed for each block
+	m_threshold = 32768.0F * 32768.0F * ::powf(10.0F, level / 10.0F);
+}
+
+CVAD::~CVAD()
+{
+}
+
+bool CVAD::process(const int16_t* audio, unsigned int length)
+{
+	assert(audio != NULL);
+	assert(length > 0U);
+
+	float energy = 0.0F;
+	for (unsigned int i = 0U; i < length; i++)
+		energy += float(audio[i]) * float(audio[i]);
+
+	if ((energy / float(length)) >= m_threshold) {
+		m_count = m_hangover + 1U;
+		return true;
+	}
+
+	if (m_count > 0U)
+		m_count--;
+
+	return m_count > 0U;
+}
+
+void CVAD::reset()
+{
+	m_count = 0U;
+}
@@ -0,0 +1,50 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef	VAD_H
+#define	VAD_H
+
+#include <cstdint>
+
+// The default level, in dBFS, below which a block is taken to be silent
+const float VAD_DEFAULT_LEVEL = -50.0F;
+
+// How many blocks are still taken to be speech after the level drops, so
+// that the quiet ends of words aren't cut off
+const unsigned int VAD_HANGOVER_BLOCKS = 10U;
+
+// A simple voice activity detector for 16-bit audio. A block is speech if
+// its RMS level is at or above the threshold, or was within the last few
+// blocks. It has no knowledge of the vocoder or the size of its frames.
+class CVAD {
+public:
+	CVAD(float level, unsigned int hangover = VAD_HANGOVER_BLOCKS);
+	~CVAD();
+
+	// Returns true if the block should be encoded as speech
+	bool process(const int16_t* audio, unsigned int length);
+
+	void reset();
+
+private:
+	float        m_threshold;
+	unsigned int m_hangover;
+	unsigned int m_count;
+};
+
+#endif
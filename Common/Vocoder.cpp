@@ -0,0 +1,85 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Vocoder.h"
+#include "Codec2Vocoder.h"
+#include "IMBEVocoder.h"
+#include "DV3000SerialController.h"
+
+CVocoder::~CVocoder()
+{
+}
+
+unsigned int CVocoder::getFrameBlocks() const
+{
+	return 1U;
+}
+
+bool CVocoder::reset()
+{
+	return false;
+}
+
+bool CVocoder::usesHardware(AMBE_MODE mode)
+{
+	switch (mode) {
+	case MODE_DSTAR:
+	case MODE_DMR:
+		return true;
+#if defined(HAVE_USB3000_P25)
+	case MODE_P25:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+unsigned int CVocoder::getModeFrameLength(AMBE_MODE mode, bool fec)
+{
+	switch (mode) {
+	case MODE_DSTAR:
+		return fec ? 9U : 6U;
+	case MODE_DMR:
+		return fec ? 9U : 7U;
+	case MODE_P25:
+		return fec ? 18U : 11U;
+	case MODE_M17_3200:
+	case MODE_M17_1600:
+		return 8U;
+	default:
+		return 0U;
+	}
+}
+
+CVocoder* CVocoder::create(AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, bool reset, bool debug)
+{
+	if (usesHardware(mode))
+		return new CDV3000SerialController(port, speed, mode, fec, reset, debug);
+
+	switch (mode) {
+	case MODE_M17_3200:
+		return new CCodec2Vocoder(true);
+	case MODE_M17_1600:
+		return new CCodec2Vocoder(false);
+	case MODE_P25:
+		return new CIMBEVocoder(fec);
+	default:
+		return NULL;
+	}
+}
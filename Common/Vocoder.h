@@ -0,0 +1,95 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if !defined(Vocoder_H)
+#define	Vocoder_H
+
+#include <string>
+
+#include <cstdint>
+
+enum AMBE_MODE {
+	MODE_DSTAR,
+	MODE_DMR,
+	MODE_P25,
+	MODE_M17_3200,
+	MODE_M17_1600,
+	MODE_UNKNOWN
+};
+
+const unsigned int AUDIO_SAMPLE_RATE = 8000U;
+const unsigned int AUDIO_BLOCK_SIZE = AUDIO_SAMPLE_RATE / 50U;
+
+// The longest frame of any vocoder, and the most audio blocks one holds
+const unsigned int VOCODER_MAX_FRAME_LENGTH = 18U;
+const unsigned int VOCODER_MAX_FRAME_BLOCKS = 2U;
+
+// The result of encoding one block, a Codec2 1600 frame needs two
+enum ENCODE_RESULT {
+	ENCODE_FRAME,
+	ENCODE_MORE,
+	ENCODE_ERROR
+};
+
+// A vocoder converts between 20ms blocks of AUDIO_BLOCK_SIZE 16-bit samples
+// at 8kHz, at full scale, and the encoded frames of its mode. Most frames
+// hold one block, but a Codec2 1600 frame holds two, and so encode() only
+// returns a frame for every second block and decode() returns two blocks.
+// Nothing here knows about files, so an instance can be used for any source
+// of audio or frames, one per stream as the state carries over between
+// frames.
+class CVocoder {
+public:
+	virtual ~CVocoder();
+
+	virtual bool open() = 0;
+
+	// The length of an encoded frame in bytes
+	virtual unsigned int getFrameLength() const = 0;
+
+	// The number of 20ms audio blocks in an encoded frame
+	virtual unsigned int getFrameBlocks() const;
+
+	// ENCODE_FRAME when frame holds a complete frame, ENCODE_MORE when
+	// another block is needed first, and ENCODE_ERROR if the vocoder failed,
+	// such as the chip not answering
+	virtual ENCODE_RESULT encode(const int16_t* audio, uint8_t* frame) = 0;
+
+	// Writes getFrameBlocks() * AUDIO_BLOCK_SIZE samples to audio, false if
+	// the vocoder failed
+	virtual bool decode(const uint8_t* frame, int16_t* audio) = 0;
+
+	virtual void close() = 0;
+
+	// Returns to the state of a new stream so that an open vocoder can be
+	// reused, false if it can't be done and a new one is needed
+	virtual bool reset();
+
+	// The DV3000 on the given port is used for the modes the software can't
+	// handle, NULL is returned for an unknown mode
+	static CVocoder* create(AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, bool reset, bool debug);
+
+	// Whether create() will use the DV3000 for a mode
+	static bool usesHardware(AMBE_MODE mode);
+
+	// The frame length of a mode without creating a vocoder, which for the
+	// DV3000 modes needs a port, 0 for an unknown mode
+	static unsigned int getModeFrameLength(AMBE_MODE mode, bool fec);
+};
+
+#endif
@@ -17,10 +17,420 @@
  */
 
 #include "WAVFileReader.h"
+#include "Utils.h"
 
 #include <cassert>
 #include <cstring>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define	WAV_USE_SSE
+#endif
+
+// Files are read in chunks of this many samples on a separate thread
+const unsigned int WAV_READ_CHUNK  = 65536U;
+const unsigned int WAV_READ_CHUNKS = 4U;
+
+static unsigned int getUInt16(const uint8_t* p)
+{
+	return (p[0U] << 0) | (p[1U] << 8);
+}
+
+static unsigned int getUInt32(const uint8_t* p)
+{
+	return (p[0U] << 0) | (p[1U] << 8) | (p[2U] << 16) | (p[3U] << 24);
+}
+
+// Take one channel, or the mix of both, from interleaved stereo. The output
+// may be the same buffer as the input, each group of four frames is loaded
+// before its output is stored, and the output never catches up with the input.
+static void selectChannel(WAV_CHANNEL channel, const float* in, float* out, unsigned int frames)
+{
+	unsigned int i = 0U;
+
+#if defined(WAV_USE_SSE)
+	const __m128 half = _mm_set1_ps(0.5F);
+
+	for (; i + 4U <= frames; i += 4U) {
+		__m128 a = _mm_loadu_ps(in + i * 2U + 0U);
+		__m128 b = _mm_loadu_ps(in + i * 2U + 4U);
+
+		__m128 left  = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+		switch (channel) {
+			case CHANNEL_LEFT:
+				_mm_storeu_ps(out + i, left);
+				break;
+			case CHANNEL_RIGHT:
+				_mm_storeu_ps(out + i, right);
+				break;
+			default:
+				_mm_storeu_ps(out + i, _mm_mul_ps(half, _mm_add_ps(left, right)));
+				break;
+		}
+	}
+#endif
+
+	for (; i < frames; i++) {
+		float left  = in[i * 2U + 0U];
+		float right = in[i * 2U + 1U];
+
+		switch (channel) {
+			case CHANNEL_LEFT:
+				out[i] = left;
+				break;
+			case CHANNEL_RIGHT:
+				out[i] = right;
+				break;
+			default:
+				out[i] = 0.5F * (left + right);
+				break;
+		}
+	}
+}
+
+bool CWAVFileReader::openStream()
+{
+	m_stream = CUtils::getStdin();
+
+	uint8_t header[12U];
+	if (::fread(header, 1U, 12U, m_stream) != 12U || ::memcmp(header + 0U, "RIFF", 4U) != 0 || ::memcmp(header + 8U, "WAVE", 4U) != 0) {
+		::fprintf(stderr, "WAVFileReader: standard input has no \"WAVE\" header\n");
+		return false;
+	}
+
+	bool format = false;
+
+	for (;;) {
+		uint8_t chunk[8U];
+		if (::fread(chunk, 1U, 8U, m_stream) != 8U) {
+			::fprintf(stderr, "WAVFileReader: standard input has no \"data\" chunk\n");
+			return false;
+		}
+
+		unsigned int length = getUInt32(chunk + 4U);
+
+		if (::memcmp(chunk, "data", 4U) == 0) {
+			if (!format) {
+				::fprintf(stderr, "WAVFileReader: standard input has no \"fmt \" chunk\n");
+				return false;
+			}
+
+			break;
+		}
+
+		if (::memcmp(chunk, "fmt ", 4U) != 0 || length < 16U || length > 40U) {
+			// Chunks are padded to an even length
+			if (!skipStream(length + (length & 1U)))
+				return false;
+			continue;
+		}
+
+		uint8_t buffer[40U];
+		if (::fread(buffer, 1U, length, m_stream) != length) {
+			::fprintf(stderr, "WAVFileReader: standard input is corrupt, cannot read the \"fmt \" chunk\n");
+			return false;
+		}
+
+		if ((length & 1U) == 1U && !skipStream(1U))
+			return false;
+
+		unsigned int tag = getUInt16(buffer + 0U);
+		m_channels       = getUInt16(buffer + 2U);
+		m_sampleRate     = getUInt32(buffer + 4U);
+		unsigned int width = getUInt16(buffer + 14U);
+
+		// WAVE_FORMAT_EXTENSIBLE carries the real format in the sub format GUID
+		if (tag == 0xFFFEU && length >= 26U)
+			tag = getUInt16(buffer + 24U);
+
+		if (m_channels == 0U || m_channels > 2U) {
+			::fprintf(stderr, "WAVFileReader: standard input has %u channels, not 1 or 2\n", m_channels);
+			return false;
+		}
+
+		if (width == 8U && tag == 1U) {
+			m_streamFormat = FORMAT_8BIT;
+		} else if (width == 16U && tag == 1U) {
+			m_streamFormat = FORMAT_16BIT;
+		} else if (width == 32U && tag == 3U) {
+			m_streamFormat = FORMAT_32BIT;
+		} else {
+			::fprintf(stderr, "WAVFileReader: standard input has sample width %u and format %u\n", width, tag);
+			return false;
+		}
+
+		format = true;
+	}
+
+	m_streamBuffer = new uint8_t[m_blockSize * 2U * sizeof(float)];
+
+	return true;
+}
+
+bool CWAVFileReader::skipStream(unsigned int length)
+{
+	assert(m_stream != NULL);
+
+	uint8_t buffer[256U];
+
+	while (length > 0U) {
+		unsigned int n = (length > 256U) ? 256U : length;
+
+		if (::fread(buffer, 1U, n, m_stream) != n) {
+			::fprintf(stderr, "WAVFileReader: standard input is corrupt, cannot skip a chunk\n");
+			return false;
+		}
+
+		length -= n;
+	}
+
+	return true;
+}
+
+unsigned int CWAVFileReader::readStream(float* data, unsigned int length)
+{
+	assert(m_stream != NULL);
+	assert(data != NULL);
+
+	if (length > m_blockSize)
+		length = m_blockSize;
+
+	unsigned int width = 1U;
+	if (m_streamFormat == FORMAT_16BIT)
+		width = 2U;
+	else if (m_streamFormat == FORMAT_32BIT)
+		width = 4U;
+
+	unsigned int frame = width * m_channels;
+
+	size_t n = ::fread(m_streamBuffer, frame, length, m_stream);
+	if (n == 0U)
+		return 0U;
+
+	unsigned int elements = (unsigned int)n * m_channels;
+	const uint8_t* p = m_streamBuffer;
+
+	switch (m_streamFormat) {
+		case FORMAT_8BIT:
+			for (unsigned int i = 0U; i < elements; i++)
+				data[i] = (float(p[i]) - 127.0F) / 128.0F;
+			break;
+
+		case FORMAT_16BIT:
+			for (unsigned int i = 0U; i < elements; i++, p += 2U)
+				data[i] = float(int16_t(getUInt16(p))) / 32768.0F;
+			break;
+
+		case FORMAT_32BIT:
+			for (unsigned int i = 0U; i < elements; i++, p += 4U) {
+				uint32_t value = getUInt32(p);
+				::memcpy(data + i, &value, sizeof(float));
+			}
+			break;
+	}
+
+	return (unsigned int)n;
+}
+
+bool CWAVFileReader::open()
+{
+	if (m_fileName == STREAM_NAME)
+		return openStream();
+
+	if (!openFile())
+		return false;
+
+	startThread();
+
+	return true;
+}
+
+void CWAVFileReader::rewind()
+{
+	if (m_stream != NULL) {
+		::fprintf(stderr, "WAVFileReader: standard input cannot be rewound\n");
+		return;
+	}
+
+	stopThread();
+
+	rewindFile();
+
+	if (m_resampler != NULL)
+		m_resampler->reset();
+
+	startThread();
+}
+
+void CWAVFileReader::close()
+{
+	if (m_stream != NULL) {
+		closeStream();
+		return;
+	}
+
+	stopThread();
+
+	closeFile();
+}
+
+void CWAVFileReader::setConversion(unsigned int sampleRate, WAV_CHANNEL channel)
+{
+	assert(sampleRate > 0U);
+	assert(m_channels > 0U);
+
+	delete m_resampler;
+	m_resampler = NULL;
+
+	if (m_convertBuffer == NULL)
+		m_convertBuffer = new float[m_blockSize * 2U];
+
+	if (m_sampleRate != sampleRate)
+		m_resampler = new CResampler(m_sampleRate, sampleRate, m_blockSize);
+
+	m_channel = channel;
+	m_convert = true;
+}
+
+unsigned int CWAVFileReader::read(float* data, unsigned int length)
+{
+	assert(data != NULL);
+
+	if (!m_convert)
+		return readRaw(data, length);
+
+	assert(length <= m_blockSize);
+
+	if (m_resampler == NULL) {
+		if (m_channels == 1U)
+			return readRaw(data, length);
+
+		unsigned int n = readRaw(m_convertBuffer, length);
+		selectChannel(m_channel, m_convertBuffer, data, n);
+		return n;
+	}
+
+	unsigned int n = m_resampler->read(data, length);
+
+	while (n < length) {
+		unsigned int count = readRaw(m_convertBuffer, m_blockSize);
+		if (count == 0U)
+			break;
+
+		if (m_channels == 2U)
+			selectChannel(m_channel, m_convertBuffer, m_convertBuffer, count);
+
+		m_resampler->write(m_convertBuffer, count);
+
+		n += m_resampler->read(data + n, length - n);
+	}
+
+	return n;
+}
+
+unsigned int CWAVFileReader::readRaw(float* data, unsigned int length)
+{
+	assert(data != NULL);
+
+	if (m_stream != NULL)
+		return readStream(data, length);
+
+	assert(m_ring != NULL);
+
+	unsigned int elements = length * m_channels;
+
+	// Only a short read at the end of the file
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait(lock, [this, elements] { return m_eof || m_ring->dataSize() >= elements; });
+	}
+
+	unsigned int n = m_ring->getData(data, elements);
+
+	notify();
+
+	return n / m_channels;
+}
+
+void CWAVFileReader::startThread()
+{
+	assert(m_channels > 0U);
+
+	if (m_ring == NULL) {
+		m_ring  = new CRingBuffer<float>(WAV_READ_CHUNK * WAV_READ_CHUNKS);
+		m_chunk = new float[WAV_READ_CHUNK];
+	}
+
+	m_ring->clear();
+
+	m_stop = false;
+	m_eof  = false;
+
+	m_thread = std::thread(&CWAVFileReader::ioThread, this);
+}
+
+void CWAVFileReader::stopThread()
+{
+	if (!m_thread.joinable())
+		return;
+
+	m_stop = true;
+	notify();
+
+	m_thread.join();
+}
+
+void CWAVFileReader::ioThread()
+{
+	// Whole frames only
+	unsigned int frames = WAV_READ_CHUNK / m_channels;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this, frames] { return m_stop || m_ring->freeSpace() >= frames * m_channels; });
+		}
+
+		if (m_stop)
+			break;
+
+		unsigned int n = readFile(m_chunk, frames);
+		if (n > 0U)
+			m_ring->addData(m_chunk, n * m_channels);
+
+		if (n < frames)
+			m_eof = true;
+
+		notify();
+
+		if (m_eof)
+			break;
+	}
+}
+
+// Taking the lock, even briefly, means that a notification can't be lost
+// between the other thread testing its condition and starting to wait
+void CWAVFileReader::notify()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+
+	m_cond.notify_all();
+}
+
+void CWAVFileReader::closeStream()
+{
+	assert(m_stream != NULL);
+
+	m_stream = NULL;
+
+	delete[] m_streamBuffer;
+	m_streamBuffer = NULL;
+}
+
 #if defined(_WIN32) || defined(_WIN64)
 
 const int WAVE_FORMAT_IEEE_FLOAT = 3;
@@ -30,6 +440,20 @@ m_fileName(fileName),
 m_blockSize(blockSize),
 m_channels(0U),
 m_sampleRate(0U),
+m_stream(NULL),
+m_streamFormat(FORMAT_16BIT),
+m_streamBuffer(NULL),
+m_convert(false),
+m_channel(CHANNEL_MIX),
+m_resampler(NULL),
+m_convertBuffer(NULL),
+m_ring(NULL),
+m_chunk(NULL),
+m_thread(),
+m_mutex(),
+m_cond(),
+m_stop(false),
+m_eof(false),
 m_format(FORMAT_16BIT),
 m_buffer8(NULL),
 m_buffer16(NULL),
@@ -40,17 +464,23 @@ m_offset(0L)
 {
 	assert(blockSize > 0U);
 
-	m_buffer8  = new uint8_t[blockSize * 4U];
-	m_buffer16 = new int16_t[blockSize * 4U];
+	m_buffer8  = new uint8_t[WAV_READ_CHUNK];
+	m_buffer16 = new int16_t[WAV_READ_CHUNK];
 }
 
 CWAVFileReader::~CWAVFileReader()
 {
+	stopThread();
+
 	delete[] m_buffer8;
 	delete[] m_buffer16;
+	delete[] m_convertBuffer;
+	delete[] m_chunk;
+	delete m_resampler;
+	delete m_ring;
 }
 
-bool CWAVFileReader::open()
+bool CWAVFileReader::openFile()
 {
 	m_handle = ::mmioOpen(LPSTR(m_fileName.c_str()), 0, MMIO_READ | MMIO_ALLOCBUF);
 	if (m_handle == NULL) {
@@ -144,7 +574,7 @@ bool CWAVFileReader::open()
 	return true;
 }
 
-unsigned int CWAVFileReader::read(float* data, unsigned int length)
+unsigned int CWAVFileReader::readFile(float* data, unsigned int length)
 {
 	assert(m_handle != NULL);
 	assert(data != NULL);
@@ -197,14 +627,14 @@ unsigned int CWAVFileReader::read(float* data, unsigned int length)
 	return n / m_channels;
 }
 
-void CWAVFileReader::rewind()
+void CWAVFileReader::rewindFile()
 {
 	assert(m_handle != NULL);
 
 	::mmioSeek(m_handle, m_offset, SEEK_SET);
 }
 
-void CWAVFileReader::close()
+void CWAVFileReader::closeFile()
 {
 	assert(m_handle != NULL);
 
@@ -233,6 +663,20 @@ m_fileName(fileName),
 m_blockSize(blockSize),
 m_channels(0U),
 m_sampleRate(0U),
+m_stream(NULL),
+m_streamFormat(FORMAT_16BIT),
+m_streamBuffer(NULL),
+m_convert(false),
+m_channel(CHANNEL_MIX),
+m_resampler(NULL),
+m_convertBuffer(NULL),
+m_ring(NULL),
+m_chunk(NULL),
+m_thread(),
+m_mutex(),
+m_cond(),
+m_stop(false),
+m_eof(false),
 m_file(NULL)
 {
 	assert(blockSize > 0U);
@@ -240,9 +684,15 @@ m_file(NULL)
 
 CWAVFileReader::~CWAVFileReader()
 {
+	stopThread();
+
+	delete[] m_convertBuffer;
+	delete[] m_chunk;
+	delete m_resampler;
+	delete m_ring;
 }
 
-bool CWAVFileReader::open()
+bool CWAVFileReader::openFile()
 {
 	SF_INFO info;
 	info.format = 0;
@@ -256,10 +706,17 @@ bool CWAVFileReader::open()
 	m_channels   = info.channels;
 	m_sampleRate = info.samplerate;
 
+	if (m_channels == 0U || m_channels > 2U) {
+		::fprintf(stderr, "WAVFileReader: %s has %u channels, not 1 or 2\n", m_fileName.c_str(), m_channels);
+		::sf_close(m_file);
+		m_file = NULL;
+		return false;
+	}
+
 	return true;
 }
 
-unsigned int CWAVFileReader::read(float* data, unsigned int length)
+unsigned int CWAVFileReader::readFile(float* data, unsigned int length)
 {
 	assert(m_file != NULL);
 	assert(data != NULL);
@@ -267,23 +724,21 @@ unsigned int CWAVFileReader::read(float* data, unsigned int length)
 	if (length == 0U)
 		return 0U;
 
-	unsigned int elements = length * m_channels;
-
-	sf_count_t n = ::sf_readf_float(m_file, data, elements);
-	if (n == 0U)
+	sf_count_t n = ::sf_readf_float(m_file, data, length);
+	if (n <= 0)
 		return 0U;
 
-	return n / m_channels;
+	return (unsigned int)n;
 }
 
-void CWAVFileReader::rewind()
+void CWAVFileReader::rewindFile()
 {
 	assert(m_file != NULL);
 
 	::sf_seek(m_file, 0, SEEK_SET);
 }
 
-void CWAVFileReader::close()
+void CWAVFileReader::closeFile()
 {
 	assert(m_file != NULL);
 
@@ -19,11 +19,18 @@
 #ifndef	WAVFileReader_H
 #define WAVFileReader_H
 
+#include "RingBuffer.h"
+#include "Resampler.h"
+
+#include <condition_variable>
+#include <atomic>
 #include <string>
+#include <thread>
+#include <mutex>
 
+#include <cstdint>
 #include <cstdio>
 
-
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
 #include <mmsystem.h>
@@ -37,6 +44,22 @@ enum WAVFORMAT {
 	FORMAT_32BIT
 };
 
+enum WAV_CHANNEL {
+	CHANNEL_MIX,
+	CHANNEL_LEFT,
+	CHANNEL_RIGHT
+};
+
+// A file name of "-" reads a WAV stream from standard input. The chunk sizes
+// in the stream header are ignored and the data is read until end of file,
+// and such a stream can't be rewound.
+//
+// After setConversion() is called read() returns mono audio at the given
+// sample rate, whatever the rate and number of channels in the file. Stereo
+// is either mixed down or only one of the channels is used.
+//
+// Files are read ahead in large chunks by a separate thread, and passed to
+// read() through a ring buffer.
 class CWAVFileReader {
 public:
 	CWAVFileReader(const std::string& fileName, unsigned int blockSize);
@@ -45,6 +68,7 @@ public:
 	bool         open();
 	unsigned int read(float* data, unsigned int length);
 	void         rewind();
+	void         setConversion(unsigned int sampleRate, WAV_CHANNEL channel = CHANNEL_MIX);
 	void         close();
 
 	unsigned int getSampleRate() const;
@@ -55,6 +79,20 @@ private:
 	unsigned int   m_blockSize;
 	unsigned short m_channels;
 	unsigned int   m_sampleRate;
+	FILE*          m_stream;
+	WAVFORMAT      m_streamFormat;
+	uint8_t*       m_streamBuffer;
+	bool           m_convert;
+	WAV_CHANNEL    m_channel;
+	CResampler*    m_resampler;
+	float*         m_convertBuffer;
+	CRingBuffer<float>* m_ring;
+	float*         m_chunk;
+	std::thread    m_thread;
+	std::mutex     m_mutex;
+	std::condition_variable m_cond;
+	std::atomic<bool> m_stop;
+	std::atomic<bool> m_eof;
 #if defined(_WIN32) || defined(_WIN64)
 	WAVFORMAT      m_format;
 	uint8_t*       m_buffer8;
@@ -66,6 +104,23 @@ private:
 #else
 	SNDFILE*       m_file;
 #endif
+
+	bool         openFile();
+	unsigned int readFile(float* data, unsigned int length);
+	void         rewindFile();
+	void         closeFile();
+
+	unsigned int readRaw(float* data, unsigned int length);
+
+	void         startThread();
+	void         stopThread();
+	void         ioThread();
+	void         notify();
+
+	bool         openStream();
+	bool         skipStream(unsigned int length);
+	unsigned int readStream(float* data, unsigned int length);
+	void         closeStream();
 };
 
 #endif
@@ -17,8 +17,224 @@
  */
 
 #include "WAVFileWriter.h"
+#include "Utils.h"
 
 #include <cassert>
+#include <cstring>
+
+const unsigned int WAV_STREAM_HEADER_LENGTH = 44U;
+
+// Files are written in chunks of this many samples on a separate thread
+const unsigned int WAV_WRITE_CHUNK  = 65536U;
+const unsigned int WAV_WRITE_CHUNKS = 4U;
+
+static void setUInt16(uint8_t* p, unsigned int value)
+{
+	p[0U] = (value >> 0) & 0xFFU;
+	p[1U] = (value >> 8) & 0xFFU;
+}
+
+static void setUInt32(uint8_t* p, unsigned int value)
+{
+	p[0U] = (value >> 0)  & 0xFFU;
+	p[1U] = (value >> 8)  & 0xFFU;
+	p[2U] = (value >> 16) & 0xFFU;
+	p[3U] = (value >> 24) & 0xFFU;
+}
+
+bool CWAVFileWriter::openStream()
+{
+	m_stream = CUtils::getStdout();
+	if (m_stream == NULL) {
+		::fprintf(stderr, "WAVFileWriter: could not open standard output\n");
+		return false;
+	}
+
+	m_streamBuffer = new uint8_t[m_blockSize * m_channels * (m_sampleWidth / 8U)];
+
+	uint8_t header[WAV_STREAM_HEADER_LENGTH];
+
+	::memcpy(header + 0U, "RIFF", 4U);
+	setUInt32(header + 4U, 0xFFFFFFFFU);
+	::memcpy(header + 8U, "WAVE", 4U);
+
+	::memcpy(header + 12U, "fmt ", 4U);
+	setUInt32(header + 16U, 16U);
+	setUInt16(header + 20U, m_sampleWidth == 32U ? 3U : 1U);		// IEEE Float or PCM
+	setUInt16(header + 22U, m_channels);
+	setUInt32(header + 24U, m_sampleRate);
+	setUInt32(header + 28U, m_sampleRate * m_channels * m_sampleWidth / 8U);
+	setUInt16(header + 32U, m_channels * m_sampleWidth / 8U);
+	setUInt16(header + 34U, m_sampleWidth);
+
+	::memcpy(header + 36U, "data", 4U);
+	setUInt32(header + 40U, 0xFFFFFFFFU);
+
+	if (::fwrite(header, 1U, WAV_STREAM_HEADER_LENGTH, m_stream) != WAV_STREAM_HEADER_LENGTH) {
+		::fprintf(stderr, "WAVFileWriter: could not write to standard output\n");
+		return false;
+	}
+
+	return true;
+}
+
+bool CWAVFileWriter::writeStream(const float* buffer, unsigned int length)
+{
+	assert(m_stream != NULL);
+	assert(buffer != NULL);
+	assert(length > 0U && length <= m_blockSize);
+
+	unsigned int elements = length * m_channels;
+	uint8_t* p = m_streamBuffer;
+
+	switch (m_sampleWidth) {
+		case 8U:
+			for (unsigned int i = 0U; i < elements; i++)
+				*p++ = uint8_t(buffer[i] * 128.0F + 127.0F);
+			break;
+
+		case 16U:
+			for (unsigned int i = 0U; i < elements; i++) {
+				setUInt16(p, uint16_t(int16_t(buffer[i] * 32768.0F)));
+				p += 2U;
+			}
+			break;
+
+		case 32U:
+			for (unsigned int i = 0U; i < elements; i++) {
+				uint32_t value;
+				::memcpy(&value, buffer + i, sizeof(uint32_t));
+				setUInt32(p, value);
+				p += 4U;
+			}
+			break;
+	}
+
+	size_t bytes = p - m_streamBuffer;
+
+	return ::fwrite(m_streamBuffer, 1U, bytes, m_stream) == bytes;
+}
+
+bool CWAVFileWriter::open()
+{
+	if (m_fileName == STREAM_NAME)
+		return openStream();
+
+	if (!openFile())
+		return false;
+
+	if (m_ring == NULL) {
+		m_ring  = new CRingBuffer<float>(WAV_WRITE_CHUNK * WAV_WRITE_CHUNKS);
+		m_chunk = new float[WAV_WRITE_CHUNK];
+	}
+
+	m_ring->clear();
+
+	m_stop  = false;
+	m_error = false;
+
+	m_thread = std::thread(&CWAVFileWriter::ioThread, this);
+
+	return true;
+}
+
+bool CWAVFileWriter::write(const float* buffer, unsigned int length)
+{
+	if (m_stream != NULL)
+		return writeStream(buffer, length);
+
+	assert(m_ring != NULL);
+	assert(buffer != NULL);
+	assert(length > 0U && length <= m_blockSize);
+
+	unsigned int elements = length * m_channels;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait(lock, [this, elements] { return m_error || m_ring->freeSpace() >= elements; });
+	}
+
+	if (m_error)
+		return false;
+
+	m_ring->addData(buffer, elements);
+
+	notify();
+
+	return true;
+}
+
+void CWAVFileWriter::close()
+{
+	if (m_stream != NULL) {
+		closeStream();
+		return;
+	}
+
+	stopThread();
+
+	closeFile();
+}
+
+// Anything still in the ring buffer is written before the thread exits
+void CWAVFileWriter::stopThread()
+{
+	if (!m_thread.joinable())
+		return;
+
+	m_stop = true;
+	notify();
+
+	m_thread.join();
+}
+
+void CWAVFileWriter::ioThread()
+{
+	// Whole frames only
+	unsigned int chunk = WAV_WRITE_CHUNK / m_channels * m_channels;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this, chunk] { return m_stop || m_ring->dataSize() >= chunk; });
+		}
+
+		unsigned int n = m_ring->getData(m_chunk, chunk);
+
+		notify();
+
+		if (n > 0U && !m_error && !writeFile(m_chunk, n / m_channels)) {
+			::fprintf(stderr, "WAVFileWriter: could not write to the file %s\n", m_fileName.c_str());
+			m_error = true;
+			notify();
+		}
+
+		if (m_stop && m_ring->dataSize() == 0U)
+			break;
+	}
+}
+
+// Taking the lock, even briefly, means that a notification can't be lost
+// between the other thread testing its condition and starting to wait
+void CWAVFileWriter::notify()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+
+	m_cond.notify_all();
+}
+
+void CWAVFileWriter::closeStream()
+{
+	assert(m_stream != NULL);
+
+	::fflush(m_stream);
+	m_stream = NULL;
+
+	delete[] m_streamBuffer;
+	m_streamBuffer = NULL;
+}
 
 #if defined(_WIN32) || defined(_WIN64)
 
@@ -30,6 +246,15 @@ m_sampleRate(sampleRate),
 m_channels(channels),
 m_sampleWidth(sampleWidth),
 m_blockSize(blockSize),
+m_stream(NULL),
+m_streamBuffer(NULL),
+m_ring(NULL),
+m_chunk(NULL),
+m_thread(),
+m_mutex(),
+m_cond(),
+m_stop(false),
+m_error(false),
 m_buffer8(NULL),
 m_buffer16(NULL),
 m_handle(NULL),
@@ -41,17 +266,21 @@ m_child()
 	assert(sampleWidth == 8U || sampleWidth == 16U || sampleWidth == 32U);
 	assert(blockSize > 0U);
 
-	m_buffer8  = new uint8_t[blockSize * channels];
-	m_buffer16 = new int16_t[blockSize * channels];
+	m_buffer8  = new uint8_t[WAV_WRITE_CHUNK];
+	m_buffer16 = new int16_t[WAV_WRITE_CHUNK];
 }
 
 CWAVFileWriter::~CWAVFileWriter()
 {
+	stopThread();
+
 	delete[] m_buffer8;
 	delete[] m_buffer16;
+	delete[] m_chunk;
+	delete m_ring;
 }
 
-bool CWAVFileWriter::open()
+bool CWAVFileWriter::openFile()
 {
 	m_handle = ::mmioOpen(LPSTR(m_fileName.c_str()), 0, MMIO_WRITE | MMIO_CREATE | MMIO_ALLOCBUF);
 	if (m_handle == NULL) {
@@ -109,7 +338,7 @@ bool CWAVFileWriter::open()
 	return true;
 }
 
-bool CWAVFileWriter::write(const float* buffer, unsigned int length)
+bool CWAVFileWriter::writeFile(const float* buffer, unsigned int length)
 {
 	assert(m_handle != NULL);
 	assert(buffer != NULL);
@@ -152,7 +381,7 @@ bool CWAVFileWriter::write(const float* buffer, unsigned int length)
 	return n == bytes;
 }
 
-void CWAVFileWriter::close()
+void CWAVFileWriter::closeFile()
 {
 	assert(m_handle != NULL);
 
@@ -171,6 +400,15 @@ m_sampleRate(sampleRate),
 m_channels(channels),
 m_sampleWidth(sampleWidth),
 m_blockSize(blockSize),
+m_stream(NULL),
+m_streamBuffer(NULL),
+m_ring(NULL),
+m_chunk(NULL),
+m_thread(),
+m_mutex(),
+m_cond(),
+m_stop(false),
+m_error(false),
 m_file(NULL)
 {
 	assert(sampleRate > 0U);
@@ -181,9 +419,13 @@ m_file(NULL)
 
 CWAVFileWriter::~CWAVFileWriter()
 {
+	stopThread();
+
+	delete[] m_chunk;
+	delete m_ring;
 }
 
-bool CWAVFileWriter::open()
+bool CWAVFileWriter::openFile()
 {
 	SF_INFO info;
 	info.samplerate = m_sampleRate;
@@ -199,20 +441,18 @@ bool CWAVFileWriter::open()
 	return true;
 }
 
-bool CWAVFileWriter::write(const float* buffer, unsigned int length)
+bool CWAVFileWriter::writeFile(const float* buffer, unsigned int length)
 {
 	assert(m_file != NULL);
 	assert(buffer != NULL);
-	assert(length > 0U && length <= m_blockSize);
+	assert(length > 0U && length * m_channels <= WAV_WRITE_CHUNK);
 
-	unsigned int elements = length * m_channels;
-
-	sf_count_t n = ::sf_writef_float(m_file, buffer, elements);
+	sf_count_t n = ::sf_writef_float(m_file, buffer, length);
 
-	return n == elements;
+	return n == sf_count_t(length);
 }
 
-void CWAVFileWriter::close()
+void CWAVFileWriter::closeFile()
 {
 	assert(m_file != NULL);
 
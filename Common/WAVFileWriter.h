@@ -19,8 +19,15 @@
 #ifndef	WAVFileWriter_H
 #define WAVFileWriter_H
 
+#include "RingBuffer.h"
+
+#include <condition_variable>
+#include <atomic>
 #include <string>
+#include <thread>
+#include <mutex>
 
+#include <cstdint>
 #include <cstdio>
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -30,6 +37,12 @@
 #include <sndfile.h>
 #endif
 
+// A file name of "-" writes to standard output. As the header can't be
+// updated at the end, the RIFF and data chunk sizes are set to 0xFFFFFFFF
+// as is usual for WAV streams.
+//
+// Files are written behind in large chunks by a separate thread, write()
+// only copies the audio into a ring buffer.
 class CWAVFileWriter {
 public:
 	CWAVFileWriter(const std::string& fileName, unsigned int sampleRate, unsigned int channels, unsigned int sampleWidth, unsigned int blockSize);
@@ -45,6 +58,15 @@ private:
 	unsigned short m_channels;
 	unsigned short m_sampleWidth;
 	unsigned int   m_blockSize;
+	FILE*          m_stream;
+	uint8_t*       m_streamBuffer;
+	CRingBuffer<float>* m_ring;
+	float*         m_chunk;
+	std::thread    m_thread;
+	std::mutex     m_mutex;
+	std::condition_variable m_cond;
+	std::atomic<bool> m_stop;
+	std::atomic<bool> m_error;
 #if defined(_WIN32) || defined(_WIN64)
 	uint8_t*       m_buffer8;
 	int16_t*       m_buffer16;
@@ -54,6 +76,18 @@ private:
 #else
 	SNDFILE*       m_file;
 #endif
+
+	bool openFile();
+	bool writeFile(const float* buffer, unsigned int length);
+	void closeFile();
+
+	void stopThread();
+	void ioThread();
+	void notify();
+
+	bool openStream();
+	bool writeStream(const float* buffer, unsigned int length);
+	void closeStream();
 };
 
 #endif
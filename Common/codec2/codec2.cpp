@@ -33,16 +33,19 @@
 #include <string.h>
 #include <math.h>
 
+#include <chrono>
+
 #include "nlp.h"
 #include "lpc.h"
 #include "quantise.h"
 #include "codec2.h"
 #include "codec2_internal.h"
+#include "codec2_fft.h"
 
 #define HPF_BETA 0.125
 #define BPF_N 101
 
-CKissFFT kiss;
+CFFTBackend fft_backend;
 
 /*---------------------------------------------------------------------------* \
 
@@ -73,7 +76,8 @@ CKissFFT kiss;
 
 \*---------------------------------------------------------------------------*/
 
-CCodec2::CCodec2(bool is_3200)
+CCodec2::CCodec2(bool is_3200) :
+scratch(CODEC2_SCRATCH_SIZE)
 {
 	c2.mode = is_3200 ? 3200 : 1600;
 
@@ -89,31 +93,11 @@ CCodec2::CCodec2(bool is_3200)
 	c2.w.resize(m_pitch);
 	c2.Sn.resize(m_pitch);
 
-	for(int i=0; i<m_pitch; i++)
-		c2.Sn[i] = 1.0;
-	c2.hpf_states[0] = c2.hpf_states[1] = 0.0;
-	for(int i=0; i<2*n_samp; i++)
-		c2.Sn_[i] = 0;
-	kiss.fft_alloc(c2.fft_fwd_cfg, FFT_ENC, false);
-	kiss.fftr_alloc(c2.fftr_fwd_cfg, FFT_ENC, false);
+	fft_backend.fft_alloc(c2.fft_fwd_cfg, FFT_ENC, false);
+	fft_backend.fftr_alloc(c2.fftr_fwd_cfg, FFT_ENC, false);
 	make_analysis_window(&c2.c2const, &c2.fft_fwd_cfg, c2.w.data(), c2.W);
 	make_synthesis_window(&c2.c2const, c2.Pn.data());
-	kiss.fftr_alloc(c2.fftr_inv_cfg, FFT_DEC, true);
-	c2.prev_f0_enc = 1/P_MAX_S;
-	c2.bg_est = 0.0;
-	c2.ex_phase = 0.0;
-
-	for(int l=1; l<=MAX_AMP; l++)
-		c2.prev_model_dec.A[l] = 0.0;
-	c2.prev_model_dec.Wo = TWO_PI/c2.c2const.p_max;
-	c2.prev_model_dec.L = PI/c2.prev_model_dec.Wo;
-	c2.prev_model_dec.voiced = 0;
-
-	for(int i=0; i<LPC_ORD; i++)
-	{
-		c2.prev_lsps_dec[i] = i*PI/(LPC_ORD+1);
-	}
-	c2.prev_e_dec = 1;
+	fft_backend.fftr_alloc(c2.fftr_inv_cfg, FFT_DEC, true);
 
 	nlp.nlp_create(&c2.c2const);
 
@@ -122,14 +106,11 @@ CCodec2::CCodec2(bool is_3200)
 	c2.beta = LPCPF_BETA;
 	c2.gamma = LPCPF_GAMMA;
 
-	c2.xq_enc[0] = c2.xq_enc[1] = 0.0;
-	c2.xq_dec[0] = c2.xq_dec[1] = 0.0;
-
 	c2.smoothing = 0;
 
 	c2.bpf_buf.resize(BPF_N+4*c2.n_samp);
-	for(int i=0; i<BPF_N+4*c2.n_samp; i++)
-		c2.bpf_buf[i] = 0.0;
+
+	codec2_reset();
 
 	c2.softdec = NULL;
 	c2.gray = 1;
@@ -140,6 +121,8 @@ CCodec2::CCodec2(bool is_3200)
 
 	decode = NULL;
 	m_decode_gain = 1.0f;
+	m_timing_enabled = false;
+	codec2_reset_timing();
 
 	if ( 3200 == c2.mode)
 	{
@@ -153,6 +136,51 @@ CCodec2::CCodec2(bool is_3200)
 	}
 }
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_reset
+
+  Returns the encoder and decoder states to those of a newly created
+  instance, without building the windows and FFT tables again, so that
+  an instance can be reused for a new stream.
+
+\*---------------------------------------------------------------------------*/
+
+void CCodec2::codec2_reset()
+{
+	for(int i=0; i<c2.m_pitch; i++)
+		c2.Sn[i] = 1.0;
+	c2.hpf_states[0] = c2.hpf_states[1] = 0.0;
+	for(int i=0; i<2*c2.n_samp; i++)
+		c2.Sn_[i] = 0;
+	c2.prev_f0_enc = 1/P_MAX_S;
+	c2.bg_est = 0.0;
+	c2.ex_phase = 0.0;
+
+	for(int l=1; l<=MAX_AMP; l++)
+		c2.prev_model_dec.A[l] = 0.0;
+	c2.prev_model_dec.Wo = TWO_PI/c2.c2const.p_max;
+	c2.prev_model_dec.L = PI/c2.prev_model_dec.Wo;
+	c2.prev_model_dec.voiced = 0;
+
+	for(int i=0; i<LPC_ORD; i++)
+	{
+		c2.prev_lsps_dec[i] = i*PI/(LPC_ORD+1);
+	}
+	c2.prev_e_dec = 1;
+	c2.next_rn = 1;
+	c2.enc_subframe = 0;
+	c2.enc_nbit = 0;
+
+	c2.xq_enc[0] = c2.xq_enc[1] = 0.0;
+	c2.xq_dec[0] = c2.xq_dec[1] = 0.0;
+
+	for(int i=0; i<BPF_N+4*c2.n_samp; i++)
+		c2.bpf_buf[i] = 0.0;
+
+	nlp.nlp_reset();
+}
+
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: codec2_destroy
@@ -183,6 +211,7 @@ CCodec2::~CCodec2()
 void CCodec2::codec2_set_mode(bool m)
 {
 	c2.mode = m ? 3200 : 1600;
+	c2.enc_subframe = 0;
 	if (c2.mode == 3200){
 		encode = &CCodec2::codec2_encode_3200;
 		decode = &CCodec2::codec2_decode_3200;
@@ -231,6 +260,7 @@ int CCodec2::codec2_samples_per_frame()
 void CCodec2::codec2_encode(unsigned char *bits, const short *speech)
 {
 	assert(encode != NULL);
+	assert(c2.enc_subframe == 0);
 
 	(*this.*encode)(bits, speech);
 }
@@ -242,6 +272,94 @@ void CCodec2::codec2_decode(short *speech, const unsigned char *bits)
 	(*this.*decode)(speech, bits);
 }
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_encode_10ms
+
+  Streaming encoder.  Takes 10ms (80 samples) of speech at a time and
+  analyses it straight away, so the work on the first part of a frame is
+  done while the rest of it is still being captured.  Returns true, with
+  the whole frame in bits, on the call that completes a frame (every
+  second call for 3200, every fourth for 1600), otherwise false with bits
+  untouched.  The frames produced are identical to codec2_encode().
+
+\*---------------------------------------------------------------------------*/
+
+bool CCodec2::codec2_encode_10ms(unsigned char *bits, const short *speech)
+{
+	int bytes     = (codec2_bits_per_frame() + 7) / 8;
+	int subframes = codec2_samples_per_frame() / c2.n_samp;
+
+	if (c2.enc_subframe == 0)
+	{
+		memset(c2.enc_bits, '\0', sizeof(c2.enc_bits));
+		c2.enc_nbit = 0;
+	}
+
+	if (3200 == c2.mode)
+		encode_subframe_3200(c2.enc_subframe, c2.enc_bits, &c2.enc_nbit, speech);
+	else
+		encode_subframe_1600(c2.enc_subframe, c2.enc_bits, &c2.enc_nbit, speech);
+
+	if (++c2.enc_subframe < subframes)
+		return false;
+
+	assert(c2.enc_nbit == (unsigned)codec2_bits_per_frame());
+
+	c2.enc_subframe = 0;
+	memcpy(bits, c2.enc_bits, bytes);
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_set_timing
+
+  Turns the per stage encoder timing on or off.  When it is off, which is
+  the default, the clock is never read.
+
+\*---------------------------------------------------------------------------*/
+
+void CCodec2::codec2_set_timing(bool enable)
+{
+	m_timing_enabled = enable;
+}
+
+void CCodec2::codec2_reset_timing()
+{
+	for (int i=0; i<C2_STAGE_COUNT; i++)
+	{
+		m_timing.ns[i]    = 0U;
+		m_timing.calls[i] = 0U;
+	}
+}
+
+const char* CCodec2::codec2_stage_name(int stage)
+{
+	static const char* names[C2_STAGE_COUNT] = {"dft_speech", "nlp", "pitch_refinement", "amplitudes", "voicing", "lsp", "quantise"};
+
+	assert(stage >= 0 && stage < C2_STAGE_COUNT);
+
+	return names[stage];
+}
+
+std::chrono::steady_clock::time_point CCodec2::timing_start() const
+{
+	if (!m_timing_enabled)
+		return std::chrono::steady_clock::time_point();
+
+	return std::chrono::steady_clock::now();
+}
+
+void CCodec2::timing_stop(int stage, const std::chrono::steady_clock::time_point& start)
+{
+	if (!m_timing_enabled)
+		return;
+
+	m_timing.ns[stage] += (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	m_timing.calls[stage]++;
+}
 
 /*---------------------------------------------------------------------------*\
 
@@ -270,6 +388,26 @@ void CCodec2::codec2_decode(short *speech, const unsigned char *bits)
 \*---------------------------------------------------------------------------*/
 
 void CCodec2::codec2_encode_3200(unsigned char *bits, const short *speech)
+{
+	unsigned int nbit = 0;
+	int i;
+
+	memset(bits, '\0', ((codec2_bits_per_frame() + 7) / 8));
+
+	for(i=0; i<2; i++)
+		encode_subframe_3200(i, bits, &nbit, &speech[i*c2.n_samp]);
+
+	assert(nbit == (unsigned)codec2_bits_per_frame());
+}
+
+/*---------------------------------------------------------------------------*
+  FUNCTION....: encode_subframe_3200
+
+  Analyses one 10ms sub-frame of a 3200 frame and packs its parameters.
+
+\*---------------------------------------------------------------------------*/
+
+void CCodec2::encode_subframe_3200(int sub, unsigned char *bits, unsigned int *nbit, const short *speech)
 {
 	MODEL   model;
 	float   ak[LPC_ORD+1];
@@ -278,32 +416,39 @@ void CCodec2::codec2_encode_3200(unsigned char *bits, const short *speech)
 	int     Wo_index, e_index;
 	int     lspd_indexes[LPC_ORD];
 	int     i;
-	unsigned int nbit = 0;
 
-	memset(bits, '\0', ((codec2_bits_per_frame() + 7) / 8));
+	analyse_one_frame(&model, speech);
 
 	/* first 10ms analysis frame - we just want voicing */
 
-	analyse_one_frame(&model, speech);
-	qt.pack(bits, &nbit, model.voiced, 1);
+	std::chrono::steady_clock::time_point t = timing_start();
+	qt.pack(bits, nbit, model.voiced, 1);
+	timing_stop(C2_STAGE_QUANTISE, t);
+
+	if (sub == 0)
+		return;
 
 	/* second 10ms analysis frame */
 
-	analyse_one_frame(&model, &speech[c2.n_samp]);
-	qt.pack(bits, &nbit, model.voiced, 1);
+	t = timing_start();
 	Wo_index = qt.encode_Wo(&c2.c2const, model.Wo, WO_BITS);
-	qt.pack(bits, &nbit, Wo_index, WO_BITS);
+	qt.pack(bits, nbit, Wo_index, WO_BITS);
+	timing_stop(C2_STAGE_QUANTISE, t);
+
+	t = timing_start();
+	e = qt.speech_to_uq_lsps(lsps, ak, c2.Sn.data(), c2.w.data(), c2.m_pitch, LPC_ORD, scratch);
+	timing_stop(C2_STAGE_LSP, t);
 
-	e = qt.speech_to_uq_lsps(lsps, ak, c2.Sn.data(), c2.w.data(), c2.m_pitch, LPC_ORD);
+	t = timing_start();
 	e_index = qt.encode_energy(e, E_BITS);
-	qt.pack(bits, &nbit, e_index, E_BITS);
+	qt.pack(bits, nbit, e_index, E_BITS);
 
 	qt.encode_lspds_scalar(lspd_indexes, lsps, LPC_ORD);
 	for(i=0; i<LSPD_SCALAR_INDEXES; i++)
 	{
-		qt.pack(bits, &nbit, lspd_indexes[i], qt.lspd_bits(i));
+		qt.pack(bits, nbit, lspd_indexes[i], qt.lspd_bits(i));
 	}
-	assert(nbit == (unsigned)codec2_bits_per_frame());
+	timing_stop(C2_STAGE_QUANTISE, t);
 }
 
 
@@ -328,7 +473,8 @@ void CCodec2::codec2_decode_3200(short speech[], const unsigned char * bits)
 	float   ak[2][LPC_ORD+1];
 	int     i,j;
 	unsigned int nbit = 0;
-	std::complex<float>    Aw[FFT_ENC];
+	CScratchFrame frame(scratch);
+	std::complex<float>   *Aw = frame.alloc<std::complex<float>>(FFT_ENC);
 
 	/* only need to zero these out due to (unused) snr calculation */
 
@@ -373,7 +519,7 @@ void CCodec2::codec2_decode_3200(short speech[], const unsigned char * bits)
 	for(i=0; i<2; i++)
 	{
 		lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD);
-		qt.aks_to_M2(&(c2.fftr_fwd_cfg), &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, c2.lpc_pf, c2.bass_boost, c2.beta, c2.gamma, Aw);
+		qt.aks_to_M2(&(c2.fftr_fwd_cfg), &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, c2.lpc_pf, c2.bass_boost, c2.beta, c2.gamma, Aw, scratch);
 		qt.apply_lpc_correction(&model[i]);
 		synthesise_one_frame(&speech[c2.n_samp*i], &model[i], Aw, m_decode_gain);
 	}
@@ -416,59 +562,72 @@ void CCodec2::codec2_decode_3200(short speech[], const unsigned char * bits)
 
 void CCodec2::codec2_encode_1600(unsigned char * bits, const short speech[])
 {
-	MODEL   model;
-	float   lsps[LPC_ORD];
-	float   ak[LPC_ORD+1];
-	float   e;
-	int     lsp_indexes[LPC_ORD];
-	int     Wo_index, e_index;
-	int     i;
 	unsigned int nbit = 0;
+	int i;
 
 	memset(bits, '\0',  ((codec2_bits_per_frame() + 7) / 8));
 
-	/* frame 1: - voicing ---------------------------------------------*/
+	for(i=0; i<4; i++)
+		encode_subframe_1600(i, bits, &nbit, &speech[i*c2.n_samp]);
 
-	analyse_one_frame(&model, speech);
-	qt.pack(bits, &nbit, model.voiced, 1);
+	assert(nbit == (unsigned)codec2_bits_per_frame());
+}
 
-	/* frame 2: - voicing, scalar Wo & E -------------------------------*/
+/*---------------------------------------------------------------------------*
+  FUNCTION....: encode_subframe_1600
 
-	analyse_one_frame(&model, &speech[c2.n_samp]);
-	qt.pack(bits, &nbit, model.voiced, 1);
+  Analyses one 10ms sub-frame of a 1600 frame and packs its parameters.
 
-	Wo_index = qt.encode_Wo(&c2.c2const, model.Wo, WO_BITS);
-	qt.pack(bits, &nbit, Wo_index, WO_BITS);
+\*---------------------------------------------------------------------------*/
 
-	/* need to run this just to get LPC energy */
-	e = qt.speech_to_uq_lsps(lsps, ak, c2.Sn.data(), c2.w.data(), c2.m_pitch, LPC_ORD);
-	e_index = qt.encode_energy(e, E_BITS);
-	qt.pack(bits, &nbit, e_index, E_BITS);
+void CCodec2::encode_subframe_1600(int sub, unsigned char *bits, unsigned int *nbit, const short *speech)
+{
+	MODEL   model;
+	float   lsps[LPC_ORD];
+	float   ak[LPC_ORD+1];
+	float   e;
+	int     lsp_indexes[LPC_ORD];
+	int     Wo_index, e_index;
+	int     i;
+
+	analyse_one_frame(&model, speech);
 
-	/* frame 3: - voicing ---------------------------------------------*/
+	/* frames 1 and 3: - voicing ---------------------------------------*/
 
-	analyse_one_frame(&model, &speech[2*c2.n_samp]);
-	qt.pack(bits, &nbit, model.voiced, 1);
+	std::chrono::steady_clock::time_point t = timing_start();
+	qt.pack(bits, nbit, model.voiced, 1);
+	timing_stop(C2_STAGE_QUANTISE, t);
 
-	/* frame 4: - voicing, scalar Wo & E, scalar LSPs ------------------*/
+	if (sub == 0 || sub == 2)
+		return;
 
-	analyse_one_frame(&model, &speech[3*c2.n_samp]);
-	qt.pack(bits, &nbit, model.voiced, 1);
+	/* frames 2 and 4: - voicing, scalar Wo & E ------------------------*/
 
+	t = timing_start();
 	Wo_index = qt.encode_Wo(&c2.c2const, model.Wo, WO_BITS);
-	qt.pack(bits, &nbit, Wo_index, WO_BITS);
+	qt.pack(bits, nbit, Wo_index, WO_BITS);
+	timing_stop(C2_STAGE_QUANTISE, t);
+
+	/* in frame 2 need to run this just to get LPC energy */
+	t = timing_start();
+	e = qt.speech_to_uq_lsps(lsps, ak, c2.Sn.data(), c2.w.data(), c2.m_pitch, LPC_ORD, scratch);
+	timing_stop(C2_STAGE_LSP, t);
 
-	e = qt.speech_to_uq_lsps(lsps, ak, c2.Sn.data(), c2.w.data(), c2.m_pitch, LPC_ORD);
+	t = timing_start();
 	e_index = qt.encode_energy(e, E_BITS);
-	qt.pack(bits, &nbit, e_index, E_BITS);
+	qt.pack(bits, nbit, e_index, E_BITS);
 
-	qt.encode_lsps_scalar(lsp_indexes, lsps, LPC_ORD);
-	for(i=0; i<LSP_SCALAR_INDEXES; i++)
+	/* frame 4: - scalar LSPs ------------------------------------------*/
+
+	if (sub == 3)
 	{
-		qt.pack(bits, &nbit, lsp_indexes[i], qt.lsp_bits(i));
+		qt.encode_lsps_scalar(lsp_indexes, lsps, LPC_ORD);
+		for(i=0; i<LSP_SCALAR_INDEXES; i++)
+		{
+			qt.pack(bits, nbit, lsp_indexes[i], qt.lsp_bits(i));
+		}
 	}
-
-	assert(nbit == (unsigned)codec2_bits_per_frame());
+	timing_stop(C2_STAGE_QUANTISE, t);
 }
 
 
@@ -494,7 +653,8 @@ void CCodec2::codec2_decode_1600(short speech[], const unsigned char * bits)
 	int     i,j;
 	unsigned int nbit = 0;
 	float   weight;
-	std::complex<float>    Aw[FFT_ENC];
+	CScratchFrame frame(scratch);
+	std::complex<float>   *Aw = frame.alloc<std::complex<float>>(FFT_ENC);
 
 	/* only need to zero these out due to (unused) snr calculation */
 
@@ -555,7 +715,7 @@ void CCodec2::codec2_decode_1600(short speech[], const unsigned char * bits)
 	for(i=0; i<4; i++)
 	{
 		lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD);
-		qt.aks_to_M2(&(c2.fftr_fwd_cfg), &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, c2.lpc_pf, c2.bass_boost, c2.beta, c2.gamma, Aw);
+		qt.aks_to_M2(&(c2.fftr_fwd_cfg), &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, c2.lpc_pf, c2.bass_boost, c2.beta, c2.gamma, Aw, scratch);
 		qt.apply_lpc_correction(&model[i]);
 		synthesise_one_frame(&speech[c2.n_samp*i], &model[i], Aw, m_decode_gain);
 	}
@@ -582,9 +742,10 @@ void CCodec2::codec2_decode_1600(short speech[], const unsigned char * bits)
 void CCodec2::synthesise_one_frame(short speech[], MODEL *model, std::complex<float> Aw[], float gain)
 {
 	int     i;
+	CScratchFrame frame(scratch);
 
 	/* LPC based phase synthesis */
-	std::complex<float> H[MAX_AMP+1];
+	std::complex<float> *H = frame.alloc<std::complex<float>>(MAX_AMP+1);
 	sample_phase(model, H, Aw);
 	phase_synth_zero_order(c2.n_samp, model, &c2.ex_phase, H);
 
@@ -623,7 +784,8 @@ void CCodec2::synthesise_one_frame(short speech[], MODEL *model, std::complex<fl
 
 void CCodec2::analyse_one_frame(MODEL *model, const short *speech)
 {
-	std::complex<float>    Sw[FFT_ENC];
+	CScratchFrame frame(scratch);
+	std::complex<float>   *Sw = frame.alloc<std::complex<float>>(FFT_ENC);
 	float   pitch;
 	int     i;
 	int     n_samp = c2.n_samp;
@@ -636,19 +798,30 @@ void CCodec2::analyse_one_frame(MODEL *model, const short *speech)
 	for(i=0; i<n_samp; i++)
 		c2.Sn[i+m_pitch-n_samp] = speech[i];
 
+	std::chrono::steady_clock::time_point t = timing_start();
 	dft_speech(&c2.c2const, c2.fft_fwd_cfg, Sw, c2.Sn.data(), c2.w.data());
+	timing_stop(C2_STAGE_DFT, t);
 
 	/* Estimate pitch */
-	nlp.nlp(c2.Sn.data(), n_samp, &pitch, &c2.prev_f0_enc);
+	t = timing_start();
+	nlp.nlp(c2.Sn.data(), n_samp, &pitch, &c2.prev_f0_enc, scratch);
 	model->Wo = TWO_PI/pitch;
 	model->L = PI/model->Wo;
+	timing_stop(C2_STAGE_NLP, t);
 
 	/* estimate model parameters */
+	t = timing_start();
 	two_stage_pitch_refinement(&c2.c2const, model, Sw);
+	timing_stop(C2_STAGE_PITCH, t);
 
 	/* estimate phases when doing ML experiments */
+	t = timing_start();
 	estimate_amplitudes(model, Sw, 0);
+	timing_stop(C2_STAGE_AMPLITUDES, t);
+
+	t = timing_start();
 	est_voicing_mbe(&c2.c2const, model, Sw, c2.W);
+	timing_stop(C2_STAGE_VOICING, t);
 }
 
 
@@ -822,8 +995,9 @@ void CCodec2::phase_synth_zero_order(
 {
 	int   m;
 	float new_phi;
-	std::complex<float>  Ex[MAX_AMP+1];	  /* excitation samples */
-	std::complex<float>  A_[MAX_AMP+1];	  /* synthesised harmonic samples */
+	CScratchFrame frame(scratch);
+	std::complex<float> *Ex = frame.alloc<std::complex<float>>(MAX_AMP+1);	  /* excitation samples */
+	std::complex<float> *A_ = frame.alloc<std::complex<float>>(MAX_AMP+1);	  /* synthesised harmonic samples */
 
 	/*
 	   Update excitation fundamental phase track, this sets the position
@@ -1075,7 +1249,7 @@ void CCodec2::make_analysis_window(C2CONST *c2const, FFT_STATE *fft_fwd_cfg, flo
 	for(i=FFT_ENC-nw/2,j=m_pitch/2-nw/2; i<FFT_ENC; i++,j++)
 		wshift[i].real(w[j]);
 
-	kiss.fft(*fft_fwd_cfg, wshift, temp);
+	fft_backend.fft(*fft_fwd_cfg, wshift, temp);
 
 	/*
 	    Re-arrange W[] to be symmetrical about FFT_ENC/2.  Makes later
@@ -1142,7 +1316,7 @@ void CCodec2::dft_speech(C2CONST *c2const, FFT_STATE &fft_fwd_cfg, std::complex<
     for(i=0; i<nw/2; i++)
         Sw[FFT_ENC-nw/2+i].real(Sn[i+m_pitch/2-nw/2]*w[i+m_pitch/2-nw/2]);
 
-    nlp.codec2_fft_inplace(fft_fwd_cfg, Sw);
+    nlp.codec2_fft_inplace(fft_fwd_cfg, Sw, scratch);
 }
 
 /*---------------------------------------------------------------------------*\
@@ -1475,8 +1649,9 @@ void CCodec2::synthesise(
 )
 {
 	int   i,l,j,b;	        /* loop variables */
-	std::complex<float>  Sw_[FFT_DEC/2+1];	/* DFT of synthesised signal */
-	float sw_[FFT_DEC];	        /* synthesised signal */
+	CScratchFrame frame(scratch);
+	std::complex<float> *Sw_ = frame.alloc<std::complex<float>>(FFT_DEC/2+1);	/* DFT of synthesised signal */
+	float *sw_ = frame.alloc<float>(FFT_DEC);	        /* synthesised signal */
 
 	if (shift)
 	{
@@ -1508,7 +1683,7 @@ void CCodec2::synthesise(
 
 	/* Perform inverse DFT */
 
-	kiss.fftri(*fftr_inv_cfg, Sw_,sw_);
+	fft_backend.fftri(*fftr_inv_cfg, Sw_,sw_);
 
 	/* Overlap add to previous samples */
 
@@ -1527,9 +1702,8 @@ void CCodec2::synthesise(
 
 int CCodec2::codec2_rand(void)
 {
-	static unsigned long next = 1;
-	next = next * 1103515245 + 12345;
-	return((unsigned)(next/65536) % 32768);
+	c2.next_rn = c2.next_rn * 1103515245 + 12345;
+	return((unsigned)(c2.next_rn/65536) % 32768);
 }
 
 /*---------------------------------------------------------------------------*\
@@ -1690,8 +1864,10 @@ void CCodec2::lsp_to_lpc(float *lsp, float *ak, int order)
 	int i,j;
 	float xout1,xout2,xin1,xin2;
 	float *pw,*n1,*n2,*n3,*n4 = 0;
-	float freq[order];
-	float Wp[(order * 4) + 2];
+	float freq[LPC_MAX_ORDER];
+	float Wp[(LPC_MAX_ORDER * 4) + 2];
+
+	assert(order <= LPC_MAX_ORDER);
 
 	/* convert from radians to the x=cos(w) domain */
 
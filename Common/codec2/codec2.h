@@ -30,12 +30,14 @@
 #define  __CODEC2__
 
 #include <complex>
+#include <chrono>
 
 #include "codec2_internal.h"
 #include "defines.h"
 #include "kiss_fft.h"
 #include "nlp.h"
 #include "quantise.h"
+#include "scratch.h"
 
 #define CODEC2_MODE_3200 	0
 #define CODEC2_MODE_1600 	2
@@ -46,6 +48,26 @@
 
 #define CODEC2_RAND_MAX 32767
 
+/* encoder stages that can be timed */
+
+enum C2_STAGE {
+	C2_STAGE_DFT,
+	C2_STAGE_NLP,
+	C2_STAGE_PITCH,
+	C2_STAGE_AMPLITUDES,
+	C2_STAGE_VOICING,
+	C2_STAGE_LSP,
+	C2_STAGE_QUANTISE,
+	C2_STAGE_COUNT
+};
+
+using C2_TIMING = struct c2_timing_tag {
+	unsigned long long ns[C2_STAGE_COUNT];       /* total time spent in each stage            */
+	unsigned long long calls[C2_STAGE_COUNT];    /* number of times each stage ran            */
+};
+
+#define CODEC2_SCRATCH_SIZE 16384	/* per instance scratch memory in bytes, the deepest call chain needs about 12k */
+
 class CCodec2
 {
 public:
@@ -53,12 +75,19 @@ public:
 	~CCodec2();
 	void codec2_encode(unsigned char *bits, const short *speech_in);
 	void codec2_decode(short *speech_out, const unsigned char *bits);
+	bool codec2_encode_10ms(unsigned char *bits, const short *speech_in);
 	void codec2_set_mode(bool);
+	void codec2_reset();
 	bool codec2_get_mode() {return (c2.mode == 3200); };
 	int  codec2_samples_per_frame();
 	int  codec2_bits_per_frame();
 	void set_decode_gain(float g){ m_decode_gain = g; }
 
+	void codec2_set_timing(bool enable);
+	void codec2_reset_timing();
+	const C2_TIMING& codec2_get_timing() const { return m_timing; }
+	static const char* codec2_stage_name(int stage);
+
 private:
 	// merged from other files
 	void sample_phase(MODEL *model, std::complex<float> filter_phase[], std::complex<float> A[]);
@@ -86,17 +115,25 @@ private:
 	void synthesise_one_frame(short speech[], MODEL *model, std::complex<float> Aw[], float gain);
 	void codec2_encode_3200(unsigned char *bits, const short *speech);
 	void codec2_encode_1600(unsigned char *bits, const short *speech);
+	void encode_subframe_3200(int sub, unsigned char *bits, unsigned int *nbit, const short *speech);
+	void encode_subframe_1600(int sub, unsigned char *bits, unsigned int *nbit, const short *speech);
 	void codec2_decode_3200(short *speech, const unsigned char *bits);
 	void codec2_decode_1600(short *speech, const unsigned char *bits);
 	void ear_protection(float in_out[], int n);
 	void lsp_to_lpc(float *freq, float *ak, int lpcrdr);
 
+	std::chrono::steady_clock::time_point timing_start() const;
+	void timing_stop(int stage, const std::chrono::steady_clock::time_point& start);
+
 	void (CCodec2::*encode)(unsigned char *bits, const short *speech);
 	void (CCodec2::*decode)(short *speech, const unsigned char *bits);
 	Cnlp nlp;
 	CQuantize qt;
 	CODEC2 c2;
+	CScratch scratch;
 	float m_decode_gain;
+	bool m_timing_enabled;
+	C2_TIMING m_timing;
 };
 
 #endif
@@ -0,0 +1,42 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_fft.h
+  AUTHOR......: Jonathan Naylor G4KLX
+  DATE CREATED: 19 October 2026
+
+  Selects the FFT used by Codec 2 at build time. Define USE_KISS_FFT to
+  use the generic kiss FFT in place of the radix-4 one.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  Copyright (C) 2026 Jonathan Naylor G4KLX
+
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_FFT__
+#define __CODEC2_FFT__
+
+#if defined(USE_KISS_FFT)
+#include "kiss_fft.h"
+typedef CKissFFT CFFTBackend;
+#else
+#include "radix4_fft.h"
+typedef CRadix4FFT CFFTBackend;
+#endif
+
+extern CFFTBackend fft_backend;
+
+#endif
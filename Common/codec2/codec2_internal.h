@@ -44,6 +44,10 @@ using CODEC2 = struct codec2_tag {
 	float              bg_est;                   /* background noise estimate for post filter */
 	float              prev_f0_enc;              /* previous frame's f0    estimate           */
 	float              prev_e_dec;               /* previous frame's LPC energy               */
+	unsigned long      next_rn;                  /* state of the phase randomiser             */
+	int                enc_subframe;             /* next 10ms sub-frame for the streaming API */
+	unsigned int       enc_nbit;                 /* bits packed so far into enc_bits          */
+	unsigned char      enc_bits[8];              /* frame being built by the streaming API    */
 	float              beta;                     /* LPC post filter parameters                */
 	float              gamma;
 	float              xq_enc[2];                /* joint pitch and energy VQ states          */
@@ -376,10 +376,17 @@ void CKissFFT::fftr(FFTR_STATE &st, const float *timedata, std::complex<float> *
 {
 	assert(st.substate.inverse == false);
 
-	auto ncfft = st.substate.nfft;
-
 	/*perform the parallel fft of two real signals packed in real,imag*/
 	fft( st.substate, (const std::complex<float>*)timedata, st.tmpbuf.data());
+
+	fftr_split(st, freqdata);
+}
+
+/* separate the packed complex transform in st.tmpbuf into the spectrum of the real input */
+void CKissFFT::fftr_split(FFTR_STATE &st, std::complex<float> *freqdata)
+{
+	auto ncfft = st.substate.nfft;
+
 	/* The real part of the DC element of the frequency spectrum in st->tmpbuf
 	 * contains the sum of the even-numbered elements of the input time sequence
 	 * The imag part is the sum of the odd-numbered elements
@@ -415,6 +422,14 @@ void CKissFFT::fftri(FFTR_STATE &st, const std::complex<float> *freqdata, float
 {
 	assert(st.substate.inverse == true);
 
+	fftri_merge(st, freqdata);
+
+	fft (st.substate, st.tmpbuf.data(), (std::complex<float> *)timedata);
+}
+
+/* pack the spectrum of a real signal into st.tmpbuf ready for the half length inverse transform */
+void CKissFFT::fftri_merge(FFTR_STATE &st, const std::complex<float> *freqdata)
+{
 	auto ncfft = st.substate.nfft;
 
 	st.tmpbuf[0].real(freqdata[0].real() + freqdata[ncfft].real());
@@ -431,5 +446,4 @@ void CKissFFT::fftri(FFTR_STATE &st, const std::complex<float> *freqdata, float
 		st.tmpbuf[k] = fek + fok;
 		st.tmpbuf[ncfft - k] = std::conj(fek - fok);
 	}
-	fft (st.substate, st.tmpbuf.data(), (std::complex<float> *)timedata);
 }
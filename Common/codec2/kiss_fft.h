@@ -23,6 +23,9 @@ public:
 	void fftr_alloc(FFTR_STATE &state, int nfft, const bool inverse_fft);
 	void fftr(FFTR_STATE &cfg,const float *timedata,std::complex<float> *freqdata);
 	void fftri(FFTR_STATE &cfg,const std::complex<float> *freqdata,float *timedata);
+protected:
+	void fftr_split(FFTR_STATE &cfg, std::complex<float> *freqdata);
+	void fftri_merge(FFTR_STATE &cfg, const std::complex<float> *freqdata);
 private:
 	void kf_bfly2(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m);
 	void kf_bfly3(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m);
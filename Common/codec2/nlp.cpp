@@ -31,9 +31,7 @@
 
 #include "defines.h"
 #include "nlp.h"
-#include "kiss_fft.h"
-
-extern CKissFFT kiss;
+#include "codec2_fft.h"
 
 /*---------------------------------------------------------------------------*\
 
@@ -170,10 +168,6 @@ void Cnlp::nlp_create(C2CONST *c2const)
 	if (Fs == 16000)
 	{
 		snlp.Sn16k.resize(FDMDV_OS_TAPS_16K + c2const->n_samp);
-		for(i=0; i<FDMDV_OS_TAPS_16K; i++)
-		{
-			snlp.Sn16k[i] = 0.0;
-		}
 
 		/* most processing occurs at 8 kHz sample rate so halve m */
 
@@ -187,14 +181,38 @@ void Cnlp::nlp_create(C2CONST *c2const)
 		snlp.w[i] = 0.5 - 0.5*cosf(2*PI*i/(m/DEC-1));
 	}
 
+	nlp_reset();
+
+	fft_backend.fft_alloc(snlp.fft_cfg, PE_FFT_SIZE, false);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  nlp_reset()
+
+  Clears the filter memories so that the next speech is treated as the
+  start of a new stream.
+
+\*---------------------------------------------------------------------------*/
+
+void Cnlp::nlp_reset()
+{
+	int  i;
+
+	if (snlp.Fs == 16000)
+	{
+		for(i=0; i<FDMDV_OS_TAPS_16K; i++)
+		{
+			snlp.Sn16k[i] = 0.0;
+		}
+	}
+
 	for(i=0; i<PMAX_M; i++)
 		snlp.sq[i] = 0.0;
 	snlp.mem_x = 0.0;
 	snlp.mem_y = 0.0;
 	for(i=0; i<NLP_NTAP; i++)
 		snlp.mem_fir[i] = 0.0;
-
-	kiss.fft_alloc(snlp.fft_cfg, PE_FFT_SIZE, false);
 }
 
 /*---------------------------------------------------------------------------*\
@@ -246,11 +264,13 @@ float Cnlp::nlp(
 	float *pitch,  /* estimated pitch period in samples at current Fs    */
 //	std::complex<float>   Sw[],   /* Freq domain version of Sn[]                        */
 //	float  W[],    /* Freq domain window                                 */
-	float *prev_f0 /* previous pitch f0 in Hz, memory for pitch tracking */
+	float *prev_f0, /* previous pitch f0 in Hz, memory for pitch tracking */
+	CScratch &scratch /* working memory                                  */
 )
 {
+	CScratchFrame frame(scratch);
 	float  notch;		    /* current notch filter output          */
-	std::complex<float>   Fw[PE_FFT_SIZE]; /* DFT of squared signal (input/output) */
+	std::complex<float>  *Fw = frame.alloc<std::complex<float>>(PE_FFT_SIZE); /* DFT of squared signal (input/output) */
 	float  gmax;
 	int    gmax_bin;
 	int    m, i, j;
@@ -287,7 +307,7 @@ float Cnlp::nlp(
 		m /= 2;
 		n /= 2;
 
-		float Sn8k[n];
+		float *Sn8k = frame.alloc<float>(n);
 		fdmdv_16_to_8(Sn8k, &snlp.Sn16k[FDMDV_OS_TAPS_16K], n);
 
 		/* Square latest input samples */
@@ -341,7 +361,7 @@ float Cnlp::nlp(
 
 	// FIXME: check if this can be converted to a real fft
 	// since all imag inputs are 0
-	codec2_fft_inplace(snlp.fft_cfg, Fw);
+	codec2_fft_inplace(snlp.fft_cfg, Fw, scratch);
 
 	for(i=0; i<PE_FFT_SIZE; i++)
 		Fw[i].real(Fw[i].real() * Fw[i].real() + Fw[i].imag() * Fw[i].imag());
@@ -501,20 +521,29 @@ void Cnlp::fdmdv_16_to_8(float out8k[], float in16k[], int n)
 // not noticeable
 // the reduced usage of RAM and increased performance on STM32 platforms
 // should be worth it.
-void Cnlp::codec2_fft_inplace(FFT_STATE &cfg, std::complex<float> *inout)
+void Cnlp::codec2_fft_inplace(FFT_STATE &cfg, std::complex<float> *inout, CScratch &scratch)
 {
-	std::complex<float> in[512];
-	// decide whether to use the local stack based buffer for in
+#if !defined(USE_KISS_FFT)
+	// the radix-4 FFT works in place so needs no copy of the input
+	if (cfg.nfft == 512 || cfg.nfft == 256)
+	{
+		fft_backend.fft(cfg, inout, inout);
+		return;
+	}
+#endif
+	CScratchFrame frame(scratch);
+	std::complex<float> *in = frame.alloc<std::complex<float>>(512);
+	// decide whether to use the local scratch buffer for in
 	// or to allow kiss_fft to allocate RAM
 	// second part is just to play safe since first method
 	// is much faster and uses less RAM
 	if (cfg.nfft <= 512)
 	{
 		memcpy(in, inout, cfg.nfft*sizeof(std::complex<float>));
-		kiss.fft(cfg, in, inout);
+		fft_backend.fft(cfg, in, inout);
 	}
 	else
 	{
-		kiss.fft(cfg, inout, inout);
+		fft_backend.fft(cfg, inout, inout);
 	}
 }
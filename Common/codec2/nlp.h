@@ -32,6 +32,7 @@
 #include <vector>
 
 #include "defines.h"
+#include "scratch.h"
 
 /*---------------------------------------------------------------------------*\
 
@@ -73,9 +74,10 @@ using NLP = struct nlp_tag
 class Cnlp {
 public:
 	void nlp_create(C2CONST *c2const);
+	void nlp_reset();
 	void nlp_destroy();
-	float nlp(float Sn[], int n, float *pitch_samples, float *prev_f0);
-	void codec2_fft_inplace(FFT_STATE &cfg, std::complex<float> *inout);
+	float nlp(float Sn[], int n, float *pitch_samples, float *prev_f0, CScratch &scratch);
+	void codec2_fft_inplace(FFT_STATE &cfg, std::complex<float> *inout, CScratch &scratch);
 
 private:
 	float post_process_sub_multiples(std::complex<float> Fw[], int pmax, float gmax, int gmax_bin, float *prev_f0);
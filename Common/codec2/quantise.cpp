@@ -34,11 +34,10 @@
 #include "defines.h"
 #include "quantise.h"
 #include "lpc.h"
-#include "kiss_fft.h"
-
-extern CKissFFT kiss;
+#include "codec2_fft.h"
 
 #define LSP_DELTA1 0.01         /* grid spacing for LSP root searches */
+#define LSP_MAX_GRID 256        /* maximum number of LSP search grid points */
 
 /*---------------------------------------------------------------------------*\
 
@@ -69,14 +68,16 @@ int CQuantize::lspd_bits(int i)
 void CQuantize::encode_lspds_scalar(int indexes[], float lsp[], int order)
 {
 	int   i,k,m;
-	float lsp_hz[order];
-	float lsp__hz[order];
-	float dlsp[order];
-	float dlsp_[order];
-	float wt[order];
+	float lsp_hz[LPC_MAX_ORDER];
+	float lsp__hz[LPC_MAX_ORDER];
+	float dlsp[LPC_MAX_ORDER];
+	float dlsp_[LPC_MAX_ORDER];
+	float wt[LPC_MAX_ORDER];
 	const float *cb;
 	float se;
 
+	assert(order <= LPC_MAX_ORDER);
+
 	for(i=0; i<order; i++)
 	{
 		wt[i] = 1.0;
@@ -118,10 +119,12 @@ void CQuantize::encode_lspds_scalar(int indexes[], float lsp[], int order)
 void CQuantize::decode_lspds_scalar( float lsp_[], int indexes[], int   order)
 {
 	int   i,k;
-	float lsp__hz[order];
-	float dlsp_[order];
+	float lsp__hz[LPC_MAX_ORDER];
+	float dlsp_[LPC_MAX_ORDER];
 	const float *cb;
 
+	assert(order <= LPC_MAX_ORDER);
+
 	for(i=0; i<order; i++)
 	{
 
@@ -224,12 +227,13 @@ int CQuantize::check_lsp_order(float lsp[], int order)
 
 \*---------------------------------------------------------------------------*/
 
-void CQuantize::lpc_post_filter(FFTR_STATE *fftr_fwd_cfg, float Pw[], float ak[], int order, float beta, float gamma, int bass_boost, float E)
+void CQuantize::lpc_post_filter(FFTR_STATE *fftr_fwd_cfg, float Pw[], float ak[], int order, float beta, float gamma, int bass_boost, float E, CScratch &scratch)
 {
+	CScratchFrame frame(scratch);
 	int   i;
-	float x[FFT_ENC];   /* input to FFTs                */
-	std::complex<float>  Ww[FFT_ENC/2+1];  /* weighting spectrum           */
-	float Rw[FFT_ENC/2+1];  /* R = WA                       */
+	float *x = frame.alloc<float>(FFT_ENC);   /* input to FFTs                */
+	std::complex<float> *Ww = frame.alloc<std::complex<float>>(FFT_ENC/2+1);  /* weighting spectrum           */
+	float *Rw = frame.alloc<float>(FFT_ENC/2+1);  /* R = WA                       */
 	float e_before, e_after, gain;
 	float Pfw;
 	float max_Rw, min_Rw;
@@ -249,7 +253,7 @@ void CQuantize::lpc_post_filter(FFTR_STATE *fftr_fwd_cfg, float Pw[], float ak[]
 		x[i] = ak[i] * coeff;
 		coeff *= gamma;
 	}
-	kiss.fftr(*fftr_fwd_cfg, x, Ww);
+	fft_backend.fftr(*fftr_fwd_cfg, x, Ww);
 
 	for(i=0; i<FFT_ENC/2; i++)
 	{
@@ -332,9 +336,11 @@ void CQuantize::aks_to_M2(
 	int           bass_boost,  /* enable LPC filter 0-1kHz 3dB boost */
 	float         beta,
 	float         gamma,       /* LPC post filter parameters */
-	std::complex<float>          Aw[]         /* output power spectrum */
+	std::complex<float>          Aw[],        /* output power spectrum */
+	CScratch     &scratch      /* working memory */
 )
 {
+	CScratchFrame frame(scratch);
 	int i,m;		/* loop variables */
 	int am,bm;		/* limits of current band */
 	float r;		/* no. rads/bin */
@@ -346,7 +352,7 @@ void CQuantize::aks_to_M2(
 
 	/* Determine DFT of A(exp(jw)) --------------------------------------------*/
 	{
-		float a[FFT_ENC];  /* input to FFT for power spectrum */
+		float *a = frame.alloc<float>(FFT_ENC);  /* input to FFT for power spectrum */
 
 		for(i=0; i<FFT_ENC; i++)
 		{
@@ -355,12 +361,12 @@ void CQuantize::aks_to_M2(
 
 		for(i=0; i<=order; i++)
 			a[i] = ak[i];
-		kiss.fftr(*fftr_fwd_cfg, a, Aw);
+		fft_backend.fftr(*fftr_fwd_cfg, a, Aw);
 	}
 
 	/* Determine power spectrum P(w) = E/(A(exp(jw))^2 ------------------------*/
 
-	float Pw[FFT_ENC/2];
+	float *Pw = frame.alloc<float>(FFT_ENC/2);
 
 	for(i=0; i<FFT_ENC/2; i++)
 	{
@@ -368,7 +374,7 @@ void CQuantize::aks_to_M2(
 	}
 
 	if (pf)
-		lpc_post_filter(fftr_fwd_cfg, Pw, ak, order, beta, gamma, bass_boost, E);
+		lpc_post_filter(fftr_fwd_cfg, Pw, ak, order, beta, gamma, bass_boost, E, scratch);
 	else
 	{
 		for(i=0; i<FFT_ENC/2; i++)
@@ -489,14 +495,17 @@ float CQuantize::decode_Wo(C2CONST *c2const, int index, int bits)
 
 \*---------------------------------------------------------------------------*/
 
-float CQuantize::speech_to_uq_lsps(float lsp[], float ak[], float Sn[], float w[], int m_pitch, int order)
+float CQuantize::speech_to_uq_lsps(float lsp[], float ak[], float Sn[], float w[], int m_pitch, int order, CScratch &scratch)
 {
+	CScratchFrame frame(scratch);
 	int   i, roots;
-	float Wn[m_pitch];
-	float R[order+1];
+	float *Wn = frame.alloc<float>(m_pitch);
+	float R[LPC_MAX_ORDER+1];
 	float e, E;
 	Clpc lpc;
 
+	assert(order <= LPC_MAX_ORDER);
+
 	e = 0.0;
 	for(i=0; i<m_pitch; i++)
 	{
@@ -528,7 +537,7 @@ float CQuantize::speech_to_uq_lsps(float lsp[], float ak[], float Sn[], float w[
 	for(i=0; i<=order; i++)
 		ak[i] *= powf(0.994,(float)i);
 
-	roots = lpc_to_lsp(ak, order, lsp, 5, LSP_DELTA1);
+	roots = lpc_to_lsp(ak, order, lsp, 5, LSP_DELTA1, scratch);
 	if (roots != order)
 	{
 		/* if root finding fails use some benign LSP values instead */
@@ -554,10 +563,12 @@ void CQuantize::encode_lsps_scalar(int indexes[], float lsp[], int order)
 {
 	int    i,k,m;
 	float  wt[1];
-	float  lsp_hz[order];
+	float  lsp_hz[LPC_MAX_ORDER];
 	const float *cb;
 	float se;
 
+	assert(order <= LPC_MAX_ORDER);
+
 	/* convert from radians to Hz so we can use human readable
 	   frequencies */
 
@@ -590,9 +601,11 @@ void CQuantize::encode_lsps_scalar(int indexes[], float lsp[], int order)
 void CQuantize::decode_lsps_scalar(float lsp[], int indexes[], int order)
 {
 	int    i,k;
-	float  lsp_hz[order];
+	float  lsp_hz[LPC_MAX_ORDER];
 	const float *cb;
 
+	assert(order <= LPC_MAX_ORDER);
+
 	for(i=0; i<order; i++)
 	{
 		k = lsp_cb[i].k;
@@ -721,128 +734,156 @@ float CQuantize::decode_energy(int index, int bits)
 
   This function converts LPC coefficients to LSP coefficients.
 
+  P'(z) and Q'(z) are evaluated together on a grid of x = cos(w) in one
+  pass. The roots are then searched for alternately in each polynomial,
+  each search starting from the previous root. As the roots of the two
+  interlace, a grid interval where only the other polynomial changes
+  sign holds two roots and is split at the other polynomial's root. Each
+  root found is polished with Newton iterations kept inside its bracket.
+
 \*---------------------------------------------------------------------------*/
 
-int CQuantize::lpc_to_lsp(float *a, int order, float *freq, int nb, float delta)
+int CQuantize::lpc_to_lsp(float *a, int order, float *freq, int nb, float delta, CScratch &scratch)
 /*  float *a 		     	lpc coefficients			*/
 /*  int order			order of LPC coefficients (10) 		*/
 /*  float *freq 	      	LSP frequencies in radians      	*/
-/*  int nb			number of sub-intervals (4) 		*/
-/*  float delta			grid spacing interval (0.02) 		*/
+/*  int nb			maximum number of Newton iterations (5)	*/
+/*  float delta			grid spacing interval (0.01) 		*/
+/*  CScratch &scratch		working memory				*/
 {
-	float psuml,psumr,psumm,temp_xr,xl,xr,xm = 0;
-	float temp_psumr;
-	int i,j,m,flag,k;
-	float *px;                	/* ptrs of respective P'(z) & Q'(z)	*/
-	float *qx;
-	float *p;
-	float *q;
-	float *pt;                	/* ptr used for cheb_poly_eval()
-				   whether P' or Q' 			*/
+	CScratchFrame frame(scratch);
+	float P[LPC_MAX_ORDER/2 + 1];	/* coefficients of P'(z) & Q'(z)	*/
+	float Q[LPC_MAX_ORDER/2 + 1];
+	float *xg = frame.alloc<float>(LSP_MAX_GRID);	/* grid points and P', Q' at them */
+	float *pg = frame.alloc<float>(LSP_MAX_GRID);
+	float *qg = frame.alloc<float>(LSP_MAX_GRID);
+	float *t0 = frame.alloc<float>(LSP_MAX_GRID);	/* T[i-2] and T[i-1] at each point */
+	float *t1 = frame.alloc<float>(LSP_MAX_GRID);
+	float xl,xr,xm,psuml,psumr,psumm;
+	int i,j,g,m,ngrid,found;
 	int roots=0;              	/* number of roots found 	        */
-	float Q[order + 1];
-	float P[order + 1];
 
-	flag = 1;
-	m = order/2;            	/* order of P'(z) & Q'(z) polynimials 	*/
+	assert(order <= LPC_MAX_ORDER);
+	assert((2.0 / delta) + 2.0 <= LSP_MAX_GRID);
 
-	/* Allocate memory space for polynomials */
+	m = order/2;            	/* order of P'(z) & Q'(z) polynimials 	*/
 
 	/* determine P'(z)'s and Q'(z)'s coefficients where
 	  P'(z) = P(z)/(1 + z^(-1)) and Q'(z) = Q(z)/(1-z^(-1)) */
 
-	px = P;                      /* initilaise ptrs */
-	qx = Q;
-	p = px;
-	q = qx;
-	*px++ = 1.0;
-	*qx++ = 1.0;
+	P[0] = 1.0;
+	Q[0] = 1.0;
 	for(i=1; i<=m; i++)
 	{
-		*px++ = a[i]+a[order+1-i]-*p++;
-		*qx++ = a[i]-a[order+1-i]+*q++;
+		P[i] = a[i]+a[order+1-i]-P[i-1];
+		Q[i] = a[i]-a[order+1-i]+Q[i-1];
 	}
-	px = P;
-	qx = Q;
 	for(i=0; i<m; i++)
 	{
-		*px = 2**px;
-		*qx = 2**qx;
-		px++;
-		qx++;
+		P[i] *= 2;
+		Q[i] *= 2;
 	}
-	px = P;             	/* re-initialise ptrs 			*/
-	qx = Q;
+
+	/* Evaluate P'(z) and Q'(z) together on the whole grid, which runs
+	   from x = 1 down past x = -1. Each step of the Chebyshev recurrence
+	   is independent across the grid points so these loops vectorise. */
+
+	for(g=0; g<LSP_MAX_GRID; g++)
+	{
+		xg[g] = 1.0f - g*delta;
+		t0[g] = 1.0;
+		t1[g] = xg[g];
+		pg[g] = P[m] + P[m-1]*xg[g];
+		qg[g] = Q[m] + Q[m-1]*xg[g];
+	}
+
+	for(i=2; i<=m; i++)
+	{
+		const float pc = P[m-i];
+		const float qc = Q[m-i];
+
+		for(g=0; g<LSP_MAX_GRID; g++)
+		{
+			float t = (2*xg[g])*t1[g] - t0[g];
+			t0[g] = t1[g];
+			t1[g] = t;
+			pg[g] += pc*t;
+			qg[g] += qc*t;
+		}
+	}
+
+	/* only search down to the first grid point below x = -1 */
+
+	ngrid = 1;
+	while(xg[ngrid-1] >= -1.0)
+		ngrid++;
 
 	/* Search for a zero in P'(z) polynomial first and then alternate to Q'(z).
 	Keep alternating between the two polynomials as each zero is found 	*/
 
-	xr = 0;             	/* initialise xr to zero 		*/
 	xl = 1.0;               	/* start at point xl = 1 		*/
-
+	g = 1;				/* first grid point below xl		*/
 
 	for(j=0; j<order; j++)
 	{
-		if(j%2)            	/* determines whether P' or Q' is eval. */
-			pt = qx;
-		else
-			pt = px;
+		const float *pt = (j%2) ? Q : P;	/* polynomial being searched	*/
+		const float *ht = (j%2) ? P : Q;	/* the other, its roots interlace */
+		const float *pv = (j%2) ? qg : pg;
+		const float *hv = (j%2) ? pg : qg;
 
-		psuml = cheb_poly_eva(pt,xl,order);	/* evals poly. at xl 	*/
-		flag = 1;
-		while(flag && (xr >= -1.0))
-		{
-			xr = xl - delta ;                  	/* interval spacing 	*/
-			psumr = cheb_poly_eva(pt,xr,order);/* poly(xl-delta_x) 	*/
-			temp_psumr = psumr;
-			temp_xr = xr;
-
-			/* if no sign change increment xr and re-evaluate
-			   poly(xr). Repeat til sign change.  if a sign change has
-			   occurred the interval is bisected and then checked again
-			   for a sign change which determines in which interval the
-			   zero lies in.  If there is no sign change between poly(xm)
-			   and poly(xl) set interval between xm and xr else set
-			   interval between xl and xr and repeat till root is located
-			   within the specified limits  */
+		psuml = cheb_poly_eva(pt,xl,order);
+		found = 0;
+
+		/* step down the grid until the sign changes */
 
+		for(; g<ngrid; g++)
+		{
+			xr = xg[g];
+			psumr = pv[g];
 			if(((psumr*psuml)<0.0) || (psumr == 0.0))
 			{
-				roots++;
+				found = 1;
+				break;
+			}
 
-				psumm=psuml;
-				for(k=0; k<=nb; k++)
-				{
-					xm = (xl+xr)/2;        	/* bisect the interval 	*/
-					psumm=cheb_poly_eva(pt,xm,order);
-					if(psumm*psuml>0.)
-					{
-						psuml=psumm;
-						xl=xm;
-					}
-					else
-					{
-						psumr=psumm;
-						xr=xm;
-					}
-				}
+			/* if a root of the other polynomial lies in this interval
+			   then so do two of this one, one either side of it, so
+			   split the interval at the other root 			*/
 
-				/* once zero is found, reset initial interval to xr 	*/
-				freq[j] = (xm);
-				xl = xm;
-				flag = 0;       		/* reset flag for next search 	*/
-			}
-			else
+			if((xl == xg[g-1]) && ((hv[g]*hv[g-1]) < 0.0))
 			{
-				psuml=temp_psumr;
-				xl=temp_xr;
+				xm = lsp_refine(ht, order, xg[g], hv[g], xg[g-1], hv[g-1], nb);
+				psumm = cheb_poly_eva(pt,xm,order);
+				if(((psumm*psuml)<0.0) || (psumm == 0.0))
+				{
+					xr = xm;
+					psumr = psumm;
+					found = 1;
+					break;
+				}
 			}
+
+			xl = xr;
+			psuml = psumr;
 		}
+
+		if (!found)
+			break;
+
+		roots++;
+
+		freq[j] = lsp_refine(pt, order, xr, psumr, xl, psuml, nb);
+
+		/* next search starts at this root */
+
+		xl = freq[j];
+		while(g < ngrid && xg[g] >= xl)
+			g++;
 	}
 
 	/* convert from x domain to radians */
 
-	for(i=0; i<order; i++)
+	for(i=0; i<roots; i++)
 	{
 		freq[i] = acosf(freq[i]);
 	}
@@ -850,6 +891,63 @@ int CQuantize::lpc_to_lsp(float *a, int order, float *freq, int nb, float delta)
 	return(roots);
 }
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: lsp_refine()
+  AUTHOR......: Jonathan Naylor G4KLX
+  DATE CREATED: 19 October 2026
+
+  Polishes a root of a Chebyshev series bracketed by [xr, xl]. Starts
+  from the secant estimate and takes Newton steps, falling back to
+  bisection whenever a step would leave the bracket.
+
+\*---------------------------------------------------------------------------*/
+
+float CQuantize::lsp_refine(const float *coef, int order, float xr, float psumr, float xl, float psuml, int nb)
+{
+	float x,xn,psum,deriv;
+	int k;
+
+	if (psumr == 0.0)
+		return xr;
+
+	x = xr - psumr*(xl - xr)/(psuml - psumr);
+
+	for(k=0; k<nb; k++)
+	{
+		psum = cheb_poly_eva_deriv(coef, x, order, &deriv);
+		if (psum == 0.0)
+			break;
+
+		/* shrink the bracket to the side holding the root */
+
+		if ((psum*psumr) < 0.0)
+		{
+			xl = x;
+			psuml = psum;
+		}
+		else
+		{
+			xr = x;
+			psumr = psum;
+		}
+
+		xn = (deriv != 0.0) ? x - psum/deriv : xr;
+		if (!(xn > xr && xn < xl))
+			xn = (xl + xr)/2;
+
+		if (fabsf(xn - x) < 1E-6)
+		{
+			x = xn;
+			break;
+		}
+
+		x = xn;
+	}
+
+	return x;
+}
+
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: cheb_poly_eva()
@@ -858,40 +956,72 @@ int CQuantize::lpc_to_lsp(float *a, int order, float *freq, int nb, float delta)
 
   This function evalutes a series of chebyshev polynomials
 
-  FIXME: performing memory allocation at run time is very inefficient,
-  replace with stack variables of MAX_P size.
-
 \*---------------------------------------------------------------------------*/
 
-float CQuantize::cheb_poly_eva(float *coef,float x,int order)
+float CQuantize::cheb_poly_eva(const float *coef,float x,int order)
 /*  float coef[]  	coefficients of the polynomial to be evaluated 	*/
 /*  float x   		the point where polynomial is to be evaluated 	*/
 /*  int order 		order of the polynomial 			*/
 {
 	int i;
-	float *t,*u,*v,sum;
-	float T[(order / 2) + 1];
-
-	/* Initialise pointers */
-
-	t = T;                          	/* T[i-2] 			*/
-	*t++ = 1.0;
-	u = t--;                        	/* T[i-1] 			*/
-	*u++ = x;
-	v = u--;                        	/* T[i] 			*/
+	float T[LPC_MAX_ORDER/2 + 1];
+	float sum;
 
 	/* Evaluate chebyshev series formulation using iterative approach 	*/
 
+	T[0] = 1.0;
+	T[1] = x;
 	for(i=2; i<=order/2; i++)
-		*v++ = (2*x)*(*u++) - *t++;  	/* T[i] = 2*x*T[i-1] - T[i-2]	*/
+		T[i] = (2*x)*T[i-1] - T[i-2];	/* T[i] = 2*x*T[i-1] - T[i-2]	*/
 
 	sum=0.0;                        	/* initialise sum to zero 	*/
-	t = T;                          	/* reset pointer 		*/
-
-	/* Evaluate polynomial and return value also free memory space */
 
 	for(i=0; i<=order/2; i++)
-		sum+=coef[(order/2)-i]**t++;
+		sum+=coef[(order/2)-i]*T[i];
+
+	return sum;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: cheb_poly_eva_deriv()
+  AUTHOR......: Jonathan Naylor G4KLX
+  DATE CREATED: 19 October 2026
+
+  As cheb_poly_eva() but also returns the derivative of the series, using
+  dT[i]/dx = i*U[i-1] where U are the Chebyshev polynomials of the second
+  kind.
+
+\*---------------------------------------------------------------------------*/
+
+float CQuantize::cheb_poly_eva_deriv(const float *coef, float x, int order, float *deriv)
+{
+	int i;
+	float t0,t1,t,u0,u1,u;
+	float sum,dsum;
+
+	sum  = coef[order/2] + coef[order/2 - 1]*x;
+	dsum = coef[order/2 - 1];
+
+	t0 = 1.0;			/* T[i-2], T[i-1] 			*/
+	t1 = x;
+	u0 = 1.0;			/* U[i-2], U[i-1] 			*/
+	u1 = 2*x;
+
+	for(i=2; i<=order/2; i++)
+	{
+		t  = (2*x)*t1 - t0;
+		sum  += coef[(order/2)-i]*t;
+		dsum += coef[(order/2)-i]*i*u1;
+
+		u  = (2*x)*u1 - u0;
+		t0 = t1;
+		t1 = t;
+		u0 = u1;
+		u1 = u;
+	}
+
+	*deriv = dsum;
 
 	return sum;
 }
@@ -29,10 +29,11 @@
 #include <complex>
 
 #include "qbase.h"
+#include "scratch.h"
 
 class CQuantize : public CQbase {
 public:
-	void aks_to_M2(FFTR_STATE *fftr_fwd_cfg, float ak[], int order, MODEL *model, float E, float *snr, int sim_pf, int pf, int bass_boost, float beta, float gamma, std::complex<float> Aw[]);
+	void aks_to_M2(FFTR_STATE *fftr_fwd_cfg, float ak[], int order, MODEL *model, float E, float *snr, int sim_pf, int pf, int bass_boost, float beta, float gamma, std::complex<float> Aw[], CScratch &scratch);
 
 	int   encode_Wo(C2CONST *c2const, float Wo, int bits);
 	float decode_Wo(C2CONST *c2const, int index, int bits);
@@ -53,16 +54,18 @@ public:
 	int lspd_bits(int i);
 
 	void apply_lpc_correction(MODEL *model);
-	float speech_to_uq_lsps(float lsp[], float ak[], float Sn[], float w[], int m_pitch, int order);
+	float speech_to_uq_lsps(float lsp[], float ak[], float Sn[], float w[], int m_pitch, int order, CScratch &scratch);
 	int check_lsp_order(float lsp[], int lpc_order);
 	void bw_expand_lsps(float lsp[], int order, float min_sep_low, float min_sep_high);
+	int lpc_to_lsp (float *a, int lpcrdr, float *freq, int nb, float delta, CScratch &scratch);
 
 private:
 	void compute_weights(const float *x, float *w, int ndim);
 	int find_nearest(const float *codebook, int nb_entries, float *x, int ndim);
-	void lpc_post_filter(FFTR_STATE *fftr_fwd_cfg, float Pw[], float ak[], int order, float beta, float gamma, int bass_boost, float E);
-	int lpc_to_lsp (float *a, int lpcrdr, float *freq, int nb, float delta);
-	float cheb_poly_eva(float *coef,float x,int order);
+	void lpc_post_filter(FFTR_STATE *fftr_fwd_cfg, float Pw[], float ak[], int order, float beta, float gamma, int bass_boost, float E, CScratch &scratch);
+	float lsp_refine(const float *coef, int order, float xr, float psumr, float xl, float psuml, int nb);
+	float cheb_poly_eva(const float *coef,float x,int order);
+	float cheb_poly_eva_deriv(const float *coef, float x, int order, float *deriv);
 };
 
 #endif
@@ -0,0 +1,172 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: radix4_fft.cpp
+  AUTHOR......: Jonathan Naylor G4KLX
+  DATE CREATED: 19 October 2026
+
+  Iterative decimation in time radix-4 FFT, with a single radix-2 stage
+  first when the size is an odd power of two.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  Copyright (C) 2026 Jonathan Naylor G4KLX
+
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+#include <utility>
+
+#include "radix4_fft.h"
+
+template <int N, int LOG2N>
+class CBitReverse
+{
+public:
+	CBitReverse()
+	{
+		for (int i = 0; i < N; i++) {
+			int r = 0;
+			for (int b = 0; b < LOG2N; b++)
+				r |= ((i >> b) & 1) << (LOG2N - 1 - b);
+			index[i] = r;
+		}
+	}
+
+	int index[N];
+};
+
+/*
+ * After the bit reversed load, each group of 4m outputs at the start of a
+ * stage holds four m point transforms, of the samples 4n, 4n+2, 4n+1 and
+ * 4n+3 of that group's input in that order. The twiddle table holds
+ * exp(-+2*pi*i*k/N) already signed for the direction of the transform.
+ * The complex arithmetic is written out on the real and imaginary parts,
+ * which avoids the slow NaN checking path of std::complex multiplication.
+ */
+template <int N, int LOG2N>
+void CRadix4FFT::work(const FFT_STATE &st, const std::complex<float> *fin, std::complex<float> *fout)
+{
+	static const CBitReverse<N, LOG2N> rev;
+
+	if (fin == fout) {
+		for (int i = 0; i < N; i++) {
+			int j = rev.index[i];
+			if (i < j)
+				std::swap(fout[i], fout[j]);
+		}
+	} else {
+		for (int i = 0; i < N; i++)
+			fout[i] = fin[rev.index[i]];
+	}
+
+	float *x = reinterpret_cast<float *>(fout);
+	const float *tw = reinterpret_cast<const float *>(st.twiddles.data());
+
+	// Multiplying by -j for a forward transform and by +j for an inverse one
+	const float sign = st.inverse ? -1.0F : 1.0F;
+
+	int m = 1;
+
+	if ((LOG2N & 1) != 0) {
+		for (int i = 0; i < 2 * N; i += 4) {
+			float ar = x[i + 0], ai = x[i + 1];
+			float br = x[i + 2], bi = x[i + 3];
+			x[i + 0] = ar + br;
+			x[i + 1] = ai + bi;
+			x[i + 2] = ar - br;
+			x[i + 3] = ai - bi;
+		}
+		m = 2;
+	}
+
+	for (; m < N; m *= 4) {
+		const int stride = N / (4 * m);
+
+		for (int g = 0; g < N; g += 4 * m) {
+			float *x0 = x + 2 * g;
+			float *x1 = x0 + 2 * m;
+			float *x2 = x1 + 2 * m;
+			float *x3 = x2 + 2 * m;
+
+			for (int k = 0; k < m; k++) {
+				const float *w1 = tw + 2 * k * stride;
+				const float *w2 = tw + 4 * k * stride;
+				const float *w3 = tw + 6 * k * stride;
+
+				float ar = x0[2 * k], ai = x0[2 * k + 1];
+
+				float br = x2[2 * k], bi = x2[2 * k + 1];
+				float t1r = br * w1[0] - bi * w1[1];
+				float t1i = br * w1[1] + bi * w1[0];
+
+				float cr = x1[2 * k], ci = x1[2 * k + 1];
+				float t2r = cr * w2[0] - ci * w2[1];
+				float t2i = cr * w2[1] + ci * w2[0];
+
+				float dr = x3[2 * k], di = x3[2 * k + 1];
+				float t3r = dr * w3[0] - di * w3[1];
+				float t3i = dr * w3[1] + di * w3[0];
+
+				float s0r = ar + t2r, s0i = ai + t2i;
+				float d0r = ar - t2r, d0i = ai - t2i;
+				float s1r = t1r + t3r, s1i = t1i + t3i;
+				float d1r = t1r - t3r, d1i = t1i - t3i;
+
+				x0[2 * k]     = s0r + s1r;
+				x0[2 * k + 1] = s0i + s1i;
+				x2[2 * k]     = s0r - s1r;
+				x2[2 * k + 1] = s0i - s1i;
+				x1[2 * k]     = d0r + sign * d1i;
+				x1[2 * k + 1] = d0i - sign * d1r;
+				x3[2 * k]     = d0r - sign * d1i;
+				x3[2 * k + 1] = d0i + sign * d1r;
+			}
+		}
+	}
+}
+
+void CRadix4FFT::fft(FFT_STATE &cfg, const std::complex<float> *fin, std::complex<float> *fout)
+{
+	switch (cfg.nfft) {
+	case 512:
+		work<512, 9>(cfg, fin, fout);
+		break;
+	case 256:
+		work<256, 8>(cfg, fin, fout);
+		break;
+	default:
+		CKissFFT::fft(cfg, fin, fout);
+		break;
+	}
+}
+
+void CRadix4FFT::fftr(FFTR_STATE &st, const float *timedata, std::complex<float> *freqdata)
+{
+	assert(st.substate.inverse == false);
+
+	fft(st.substate, (const std::complex<float>*)timedata, st.tmpbuf.data());
+
+	fftr_split(st, freqdata);
+}
+
+void CRadix4FFT::fftri(FFTR_STATE &st, const std::complex<float> *freqdata, float *timedata)
+{
+	assert(st.substate.inverse == true);
+
+	fftri_merge(st, freqdata);
+
+	fft(st.substate, st.tmpbuf.data(), (std::complex<float> *)timedata);
+}
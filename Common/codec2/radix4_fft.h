@@ -0,0 +1,50 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: radix4_fft.h
+  AUTHOR......: Jonathan Naylor G4KLX
+  DATE CREATED: 19 October 2026
+
+  Radix-4 FFT for the power of two sizes used by Codec 2, falling back
+  to the kiss FFT for any other size.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  Copyright (C) 2026 Jonathan Naylor G4KLX
+
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __RADIX4_FFT__
+#define __RADIX4_FFT__
+
+#include "kiss_fft.h"
+
+/*
+ * Uses the same FFT_STATE and FFTR_STATE as the kiss FFT, so the two can
+ * be swapped without changing any of the callers. The 512 and 256 point
+ * transforms are loops over the stages, templated on the size so that the
+ * loop bounds are constants, and work in place.
+ */
+class CRadix4FFT : public CKissFFT
+{
+public:
+	void fft(FFT_STATE &cfg, const std::complex<float> *fin, std::complex<float> *fout);
+	void fftr(FFTR_STATE &cfg, const float *timedata, std::complex<float> *freqdata);
+	void fftri(FFTR_STATE &cfg, const std::complex<float> *freqdata, float *timedata);
+private:
+	template <int N, int LOG2N> void work(const FFT_STATE &st, const std::complex<float> *fin, std::complex<float> *fout);
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: scratch.cpp
+  AUTHOR......: Jonathan Naylor G4KLX
+  DATE CREATED: 19 October 2026
+
+  Per instance scratch memory for the per frame working arrays.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  Copyright (C) 2026 Jonathan Naylor G4KLX
+
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstring>
+
+#include "scratch.h"
+
+CScratch::CScratch(unsigned int size) :
+m_raw(NULL),
+m_base(NULL),
+m_size(size),
+m_used(0U),
+m_peak(0U)
+{
+	m_raw = new unsigned char[size + SCRATCH_ALIGN];
+	::memset(m_raw, 0x00U, size + SCRATCH_ALIGN);
+
+	uintptr_t p = reinterpret_cast<uintptr_t>(m_raw);
+	p = (p + SCRATCH_ALIGN - 1U) & ~uintptr_t(SCRATCH_ALIGN - 1U);
+	m_base = reinterpret_cast<unsigned char*>(p);
+}
+
+CScratch::~CScratch()
+{
+	delete[] m_raw;
+}
+
+void* CScratch::alloc_bytes(size_t bytes)
+{
+	bytes = (bytes + SCRATCH_ALIGN - 1U) & ~size_t(SCRATCH_ALIGN - 1U);
+
+	assert(m_used + bytes <= m_size);
+
+	void* p = m_base + m_used;
+
+	m_used += (unsigned int)bytes;
+	if (m_used > m_peak)
+		m_peak = m_used;
+
+	return p;
+}
@@ -0,0 +1,103 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: scratch.h
+  AUTHOR......: Jonathan Naylor G4KLX
+  DATE CREATED: 19 October 2026
+
+  Per instance scratch memory for the per frame working arrays, so that
+  encoding and decoding neither grow the stack nor touch the heap.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  Copyright (C) 2026 Jonathan Naylor G4KLX
+
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SCRATCH__
+#define __SCRATCH__
+
+#include <cassert>
+#include <cstddef>
+
+#define SCRATCH_ALIGN 64		/* alignment of every allocation, for SIMD	*/
+
+/*
+ * A stack-like arena allocated once. Every allocation is rounded up to
+ * SCRATCH_ALIGN bytes, and is given back in reverse order by releasing
+ * to an earlier mark. The size must cover the deepest call chain; running
+ * out is a programming error and is caught by an assert.
+ */
+class CScratch
+{
+public:
+	CScratch(unsigned int size);
+	~CScratch();
+
+	template <typename T> T* alloc(unsigned int n)
+	{
+		return static_cast<T*>(alloc_bytes(n * sizeof(T)));
+	}
+
+	unsigned int mark() const { return m_used; }
+	void release(unsigned int mark) { assert(mark <= m_used); m_used = mark; }
+
+	unsigned int size() const { return m_size; }
+	unsigned int peak() const { return m_peak; }
+
+private:
+	unsigned char* m_raw;
+	unsigned char* m_base;		/* m_raw rounded up to SCRATCH_ALIGN	*/
+	unsigned int   m_size;
+	unsigned int   m_used;
+	unsigned int   m_peak;		/* high water mark, for sizing		*/
+
+	void* alloc_bytes(size_t bytes);
+
+	CScratch(const CScratch&) = delete;
+	CScratch& operator=(const CScratch&) = delete;
+};
+
+/*
+ * Gives back everything allocated through it when it goes out of scope.
+ */
+class CScratchFrame
+{
+public:
+	CScratchFrame(CScratch& scratch) :
+	m_scratch(scratch),
+	m_mark(scratch.mark())
+	{
+	}
+
+	~CScratchFrame()
+	{
+		m_scratch.release(m_mark);
+	}
+
+	template <typename T> T* alloc(unsigned int n)
+	{
+		return m_scratch.alloc<T>(n);
+	}
+
+private:
+	CScratch&    m_scratch;
+	unsigned int m_mark;
+
+	CScratchFrame(const CScratchFrame&) = delete;
+	CScratchFrame& operator=(const CScratchFrame&) = delete;
+};
+
+#endif
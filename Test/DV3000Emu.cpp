@@ -0,0 +1,93 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "DV3000Emulator.h"
+
+#include <string>
+
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+
+#include <unistd.h>
+
+static volatile sig_atomic_t stopping = 0;
+
+static void sigHandler(int)
+{
+	stopping = 1;
+}
+
+// Runs the DV3000 emulator until SIGINT or SIGTERM, the name of its pseudo
+// terminal is written to a file for the programs under test to use
+int main(int argc, char** argv)
+{
+	unsigned int packet = 0U;
+	unsigned int delay  = 0U;
+
+	int c;
+	while ((c = ::getopt(argc, argv, "d:n:")) != -1) {
+		switch (c) {
+		case 'd':
+			delay = (unsigned int)::atoi(optarg);
+			break;
+		case 'n':
+			packet = (unsigned int)::atoi(optarg);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (optind != (argc - 1)) {
+		::fprintf(stderr, "Usage: DV3000Emu [-n <packet> [-d <delay ms>]] <port file>\n");
+		return 1;
+	}
+
+	::signal(SIGINT, sigHandler);
+	::signal(SIGTERM, sigHandler);
+
+	CDV3000Emulator emulator;
+	emulator.setDelay(packet, delay);
+
+	if (!emulator.start())
+		return 1;
+
+	// Renamed into place so that the name is never read half written
+	std::string fileName = std::string(argv[optind]);
+	std::string tempName = fileName + ".tmp";
+
+	FILE* fp = ::fopen(tempName.c_str(), "wt");
+	if (fp == NULL) {
+		::fprintf(stderr, "DV3000Emu: cannot open %s\n", tempName.c_str());
+		emulator.stop();
+		return 1;
+	}
+
+	::fprintf(fp, "%s\n", emulator.getPort().c_str());
+	::fclose(fp);
+
+	::rename(tempName.c_str(), fileName.c_str());
+
+	while (stopping == 0)
+		::usleep(100000U);
+
+	emulator.stop();
+
+	return 0;
+}
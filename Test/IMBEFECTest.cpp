@@ -0,0 +1,86 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "IMBEFEC.h"
+
+#include <cstdio>
+#include <cstring>
+
+// The length of one 20ms IMBE frame, without and with FEC
+const unsigned int IMBE_LENGTH = 11U;
+const unsigned int FEC_LENGTH  = 18U;
+
+// Applies or removes the P25 FEC on every frame of a raw file, so that the
+// FEC can be checked without the IMBE vocoder
+int main(int argc, char** argv)
+{
+	if (argc != 4 || (::strcmp(argv[1], "encode") != 0 && ::strcmp(argv[1], "decode") != 0)) {
+		::fprintf(stderr, "Usage: IMBEFECTest encode|decode <input> <output>\n");
+		return 1;
+	}
+
+	bool encode = ::strcmp(argv[1], "encode") == 0;
+
+	unsigned int inLength  = encode ? IMBE_LENGTH : FEC_LENGTH;
+	unsigned int outLength = encode ? FEC_LENGTH  : IMBE_LENGTH;
+
+	FILE* in = ::fopen(argv[2], "rb");
+	if (in == NULL) {
+		::fprintf(stderr, "IMBEFECTest: cannot open %s\n", argv[2]);
+		return 1;
+	}
+
+	FILE* out = ::fopen(argv[3], "wb");
+	if (out == NULL) {
+		::fprintf(stderr, "IMBEFECTest: cannot open %s\n", argv[3]);
+		::fclose(in);
+		return 1;
+	}
+
+	CIMBEFEC fec;
+
+	unsigned int frames = 0U;
+	int ret = 0;
+
+	unsigned char inFrame[FEC_LENGTH];
+	unsigned char outFrame[FEC_LENGTH];
+	while (::fread(inFrame, 1U, inLength, in) == inLength) {
+		if (encode)
+			fec.encode(outFrame, inFrame);
+		else
+			fec.decode(inFrame, outFrame);
+
+		if (::fwrite(outFrame, 1U, outLength, out) != outLength) {
+			::fprintf(stderr, "IMBEFECTest: error writing to %s\n", argv[3]);
+			ret = 1;
+			break;
+		}
+
+		frames++;
+	}
+
+	::fclose(in);
+	::fclose(out);
+
+	if (ret == 0 && frames == 0U) {
+		::fprintf(stderr, "IMBEFECTest: %s has no frames\n", argv[2]);
+		ret = 1;
+	}
+
+	return ret;
+}
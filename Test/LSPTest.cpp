@@ -0,0 +1,311 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "codec2/quantise.h"
+#include "codec2/codec2.h"
+
+#include <cstdio>
+#include <cmath>
+
+// The LPC order of Codec2 and the grid used by speech_to_uq_lsps()
+const int   ORDER  = 10;
+const int   NB     = 5;
+const float DELTA  = 0.01F;
+
+const unsigned int FRAMES = 50000U;
+
+// The points of the double precision reference search between x = 1 and -1
+const int REFERENCE_GRID = 2000;
+
+// The current root finder must not differ from the old one by more than
+// this, nor from the reference search by more than MAX_ERROR, in radians
+const double MAX_DIFFERENCE = 0.02;
+const double MAX_ERROR      = 0.005;
+
+// The Chebyshev series and root finder of lpc_to_lsp() from before the grid
+// was evaluated in one pass, kept to compare the current one against
+static float old_cheb_poly_eva(const float* coef, float x, int order)
+{
+	float T[ORDER / 2 + 1];
+	T[0] = 1.0F;
+	T[1] = x;
+	for (int i = 2; i <= order / 2; i++)
+		T[i] = (2 * x) * T[i - 1] - T[i - 2];
+
+	float sum = 0.0F;
+	for (int i = 0; i <= order / 2; i++)
+		sum += coef[(order / 2) - i] * T[i];
+
+	return sum;
+}
+
+static int old_lpc_to_lsp(const float* a, int order, float* freq, int nb, float delta)
+{
+	int m = order / 2;
+
+	float P[ORDER + 1];
+	float Q[ORDER + 1];
+	P[0] = 1.0F;
+	Q[0] = 1.0F;
+	for (int i = 1; i <= m; i++) {
+		P[i] = a[i] + a[order + 1 - i] - P[i - 1];
+		Q[i] = a[i] - a[order + 1 - i] + Q[i - 1];
+	}
+	for (int i = 0; i < m; i++) {
+		P[i] = 2 * P[i];
+		Q[i] = 2 * Q[i];
+	}
+
+	int roots = 0;
+	float xr = 0.0F;
+	float xl = 1.0F;
+	float xm = 0.0F;
+
+	for (int j = 0; j < order; j++) {
+		const float* pt = (j % 2) ? Q : P;
+
+		float psuml = old_cheb_poly_eva(pt, xl, order);
+		bool flag = true;
+		while (flag && (xr >= -1.0)) {
+			xr = xl - delta;
+			float psumr = old_cheb_poly_eva(pt, xr, order);
+			float temp_psumr = psumr;
+			float temp_xr = xr;
+
+			if (((psumr * psuml) < 0.0) || (psumr == 0.0)) {
+				roots++;
+
+				for (int k = 0; k <= nb; k++) {
+					xm = (xl + xr) / 2;
+					float psumm = old_cheb_poly_eva(pt, xm, order);
+					if (psumm * psuml > 0.) {
+						psuml = psumm;
+						xl = xm;
+					} else {
+						xr = xm;
+					}
+				}
+
+				freq[j] = xm;
+				xl = xm;
+				flag = false;
+			} else {
+				psuml = temp_psumr;
+				xl = temp_xr;
+			}
+		}
+	}
+
+	for (int i = 0; i < order; i++)
+		freq[i] = ::acosf(freq[i]);
+
+	return roots;
+}
+
+// The LSPs found in double precision on a fine grid, ordered by frequency,
+// returns false if a pair of roots is too close for the grid to separate
+static bool reference_lsp(const float* a, int order, double* freq)
+{
+	int m = order / 2;
+
+	double P[ORDER + 1];
+	double Q[ORDER + 1];
+	P[0] = 1.0;
+	Q[0] = 1.0;
+	for (int i = 1; i <= m; i++) {
+		P[i] = double(a[i]) + double(a[order + 1 - i]) - P[i - 1];
+		Q[i] = double(a[i]) - double(a[order + 1 - i]) + Q[i - 1];
+	}
+	for (int i = 0; i < m; i++) {
+		P[i] *= 2.0;
+		Q[i] *= 2.0;
+	}
+
+	int roots = 0;
+
+	for (int n = 0; n < 2; n++) {
+		const double* coef = (n == 0) ? P : Q;
+
+		auto eval = [coef, m](double x) {
+			double t0 = 1.0, t1 = x;
+			double sum = coef[m] + coef[m - 1] * x;
+			for (int i = 2; i <= m; i++) {
+				double t2 = 2.0 * x * t1 - t0;
+				sum += coef[m - i] * t2;
+				t0 = t1;
+				t1 = t2;
+			}
+			return sum;
+		};
+
+		double xl = 1.0;
+		double fl = eval(xl);
+		for (int g = 1; g <= REFERENCE_GRID; g++) {
+			double xr = 1.0 - 2.0 * g / REFERENCE_GRID;
+			double fr = eval(xr);
+
+			if (fl * fr <= 0.0 && fl != 0.0) {
+				double lo = xl, hi = xr, flo = fl;
+				for (int k = 0; k < 60; k++) {
+					double mid = (lo + hi) / 2.0;
+					double fm = eval(mid);
+					if (fm * flo > 0.0) {
+						lo = mid;
+						flo = fm;
+					} else {
+						hi = mid;
+					}
+				}
+
+				if (roots == order)
+					return false;
+				freq[roots++] = ::acos((lo + hi) / 2.0);
+			}
+
+			xl = xr;
+			fl = fr;
+		}
+	}
+
+	if (roots != order)
+		return false;
+
+	for (int i = 1; i < order; i++) {
+		double f = freq[i];
+		int j = i;
+		for (; j > 0 && freq[j - 1] > f; j--)
+			freq[j] = freq[j - 1];
+		freq[j] = f;
+	}
+
+	return true;
+}
+
+// Finds the LSPs of random stable LPC filters with the old and current root
+// finders, counting the frames on which each misses a root and measuring
+// both against a double precision search
+int main()
+{
+	CQuantize quantize;
+	CScratch scratch(CODEC2_SCRATCH_SIZE);
+
+	// A fixed linear congruential generator, so every run sees the same frames
+	unsigned int seed = 28U;
+	auto next = [&seed]() {
+		seed = seed * 1103515245U + 12345U;
+		return float((seed >> 8) & 0xFFFFU) / 65535.0F * 2.0F - 1.0F;
+	};
+
+	unsigned int oldFailures = 0U;
+	unsigned int newFailures = 0U;
+	unsigned int unordered   = 0U;
+	unsigned int compared    = 0U;
+	unsigned int referenced  = 0U;
+
+	double maxDifference = 0.0;
+	double sumDifference = 0.0;
+	double maxOldError = 0.0;
+	double sumOldError = 0.0;
+	double maxNewError = 0.0;
+	double sumNewError = 0.0;
+
+	for (unsigned int n = 0U; n < FRAMES; n++) {
+		// Reflection coefficients below one in magnitude give a stable filter,
+		// the first two have the widest range as in speech
+		float k[ORDER + 1];
+		for (int i = 1; i <= ORDER; i++)
+			k[i] = next() * (i < 3 ? 0.97F : 0.68F);
+
+		float a[ORDER + 1] = {1.0F};
+		for (int i = 1; i <= ORDER; i++) {
+			float prev[ORDER + 1];
+			for (int j = 0; j <= ORDER; j++)
+				prev[j] = a[j];
+			a[i] = k[i];
+			for (int j = 1; j < i; j++)
+				a[j] = prev[j] + k[i] * prev[i - j];
+		}
+
+		float oldLSP[ORDER];
+		float newLSP[ORDER];
+		float ak[ORDER + 1];
+
+		for (int i = 0; i <= ORDER; i++)
+			ak[i] = a[i];
+		int oldRoots = old_lpc_to_lsp(ak, ORDER, oldLSP, NB, DELTA);
+
+		for (int i = 0; i <= ORDER; i++)
+			ak[i] = a[i];
+		int newRoots = quantize.lpc_to_lsp(ak, ORDER, newLSP, NB, DELTA, scratch);
+
+		if (oldRoots != ORDER)
+			oldFailures++;
+		if (newRoots != ORDER) {
+			newFailures++;
+			continue;
+		}
+
+		for (int i = 1; i < ORDER; i++) {
+			if (!(newLSP[i] > newLSP[i - 1])) {
+				unordered++;
+				break;
+			}
+		}
+
+		double refLSP[ORDER];
+		bool reference = reference_lsp(a, ORDER, refLSP);
+		if (reference)
+			referenced++;
+
+		if (oldRoots == ORDER)
+			compared++;
+
+		for (int i = 0; i < ORDER; i++) {
+			if (oldRoots == ORDER) {
+				double diff = ::fabs(double(newLSP[i]) - double(oldLSP[i]));
+				sumDifference += diff;
+				if (diff > maxDifference)
+					maxDifference = diff;
+			}
+
+			if (reference) {
+				double error = ::fabs(double(newLSP[i]) - refLSP[i]);
+				sumNewError += error;
+				if (error > maxNewError)
+					maxNewError = error;
+
+				if (oldRoots == ORDER) {
+					error = ::fabs(double(oldLSP[i]) - refLSP[i]);
+					sumOldError += error;
+					if (error > maxOldError)
+						maxOldError = error;
+				}
+			}
+		}
+	}
+
+	double meanDifference = compared > 0U ? sumDifference / (compared * ORDER) : 0.0;
+	double meanOldError   = referenced > 0U ? sumOldError / (referenced * ORDER) : 0.0;
+	double meanNewError   = referenced > 0U ? sumNewError / (referenced * ORDER) : 0.0;
+
+	::printf("{\"type\":\"lsp\",\"frames\":%u,\"failures_old\":%u,\"failures_new\":%u,\"unordered_new\":%u,\"max_difference\":%.3g,\"mean_difference\":%.3g,"
+		"\"max_error_old\":%.3g,\"mean_error_old\":%.3g,\"max_error_new\":%.3g,\"mean_error_new\":%.3g}\n",
+		FRAMES, oldFailures, newFailures, unordered, maxDifference, meanDifference, maxOldError, meanOldError, maxNewError, meanNewError);
+
+	return (newFailures == 0U && unordered == 0U && maxDifference <= MAX_DIFFERENCE && maxNewError <= MAX_ERROR) ? 0 : 1;
+}
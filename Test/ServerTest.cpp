@@ -0,0 +1,214 @@
+/*
+*   Copyright (C) 2026 by Jonathan Naylor G4KLX
+*
+*   This program is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program; if not, write to the Free Software
+*   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+
+const unsigned char DV3000_PRODID[] = {0x61U, 0x00U, 0x01U, 0x00U, 0x30U};
+const unsigned int  DV3000_PRODID_LEN = 5U;
+
+const unsigned char DV3000_AUDIO_HEADER[] = {0x61U, 0x01U, 0x42U, 0x02U, 0x00U, 0xA0U};
+const unsigned int  DV3000_AUDIO_HEADER_LEN = 6U;
+const unsigned int  DV3000_AMBE_HEADER_LEN  = 6U;
+
+const unsigned int AUDIO_BYTES = 320U;
+
+// How long a client waits for each answer, longer than the server waits for the chip
+const int ANSWER_TIMEOUT_MS = 2500;
+
+static std::atomic<unsigned int> answered(0U);
+static std::atomic<unsigned int> missing(0U);
+static std::atomic<unsigned int> stale(0U);
+static std::atomic<unsigned int> misrouted(0U);
+
+static int openClient(unsigned int port)
+{
+	int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return -1;
+
+	struct sockaddr_in addr;
+	::memset(&addr, 0x00, sizeof(struct sockaddr_in));
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (::connect(fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_in)) < 0) {
+		::close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+// Returns the length of the datagram, 0 on a timeout
+static int receive(int fd, unsigned char* buffer, unsigned int length, int ms)
+{
+	struct pollfd pfd;
+	pfd.fd      = fd;
+	pfd.events  = POLLIN;
+	pfd.revents = 0;
+
+	if (::poll(&pfd, 1, ms) <= 0)
+		return 0;
+
+	ssize_t n = ::recv(fd, buffer, length, 0);
+	return (n < 0) ? 0 : int(n);
+}
+
+// The server may still be starting, so the product id is asked for until it answers
+static bool waitServer(int fd)
+{
+	for (unsigned int i = 0U; i < 50U; i++) {
+		::send(fd, DV3000_PRODID, DV3000_PRODID_LEN, 0);
+
+		unsigned char buffer[400U];
+		if (receive(fd, buffer, 400U, 100) > 0)
+			return true;
+
+		// Until the port is open the send fails at once, rather than timing out
+		::usleep(100000U);
+	}
+
+	return false;
+}
+
+// The emulator makes an AMBE frame from the first bytes of the audio, which
+// here hold the client and the sequence number, so each answer identifies the
+// request that it belongs to
+static void client(int fd, unsigned int id, unsigned int packets)
+{
+	for (unsigned int seq = 0U; seq < packets; seq++) {
+		unsigned char packet[DV3000_AUDIO_HEADER_LEN + AUDIO_BYTES];
+		::memcpy(packet, DV3000_AUDIO_HEADER, DV3000_AUDIO_HEADER_LEN);
+		for (unsigned int i = 0U; i < AUDIO_BYTES; i += 3U) {
+			packet[DV3000_AUDIO_HEADER_LEN + i + 0U] = id;
+			packet[DV3000_AUDIO_HEADER_LEN + i + 1U] = seq >> 8;
+			if (i + 2U < AUDIO_BYTES)
+				packet[DV3000_AUDIO_HEADER_LEN + i + 2U] = seq & 0xFFU;
+		}
+
+		::send(fd, packet, DV3000_AUDIO_HEADER_LEN + AUDIO_BYTES, 0);
+
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ANSWER_TIMEOUT_MS);
+
+		for (;;) {
+			int ms = int(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count());
+
+			unsigned char buffer[400U];
+			int n = (ms > 0) ? receive(fd, buffer, 400U, ms) : 0;
+			if (n == 0) {
+				missing++;
+				break;
+			}
+
+			if (n < int(DV3000_AMBE_HEADER_LEN + 3U) || buffer[3U] != 0x01U) {
+				misrouted++;
+				continue;
+			}
+
+			const unsigned char* frame = buffer + DV3000_AMBE_HEADER_LEN;
+			unsigned int answerId  = frame[0U];
+			unsigned int answerSeq = (frame[1U] << 8) | frame[2U];
+
+			if (answerId != id) {
+				misrouted++;
+			} else if (answerSeq != seq) {
+				stale++;
+			} else {
+				answered++;
+				break;
+			}
+		}
+	}
+}
+
+// Several clients send audio to AMBESERVER at the same time, each waiting
+// for the answer to one packet before sending the next
+int main(int argc, char** argv)
+{
+	unsigned int clients    = 4U;
+	unsigned int packets    = 50U;
+	unsigned int maxMissing = 0U;
+
+	int c;
+	while ((c = ::getopt(argc, argv, "c:m:n:")) != -1) {
+		switch (c) {
+		case 'c':
+			clients = (unsigned int)::atoi(optarg);
+			break;
+		case 'm':
+			maxMissing = (unsigned int)::atoi(optarg);
+			break;
+		case 'n':
+			packets = (unsigned int)::atoi(optarg);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (optind != (argc - 1) || clients == 0U || clients > 255U) {
+		::fprintf(stderr, "Usage: ServerTest [-c <clients>] [-n <packets>] [-m <max missing>] <udp port>\n");
+		return 1;
+	}
+
+	unsigned int port = (unsigned int)::atoi(argv[optind]);
+
+	std::vector<int> fds;
+	for (unsigned int i = 0U; i < clients; i++) {
+		int fd = openClient(port);
+		if (fd < 0 || !waitServer(fd)) {
+			::fprintf(stderr, "ServerTest: no answer from the server on UDP port %u\n", port);
+			for (unsigned int j = 0U; j < fds.size(); j++)
+				::close(fds[j]);
+			if (fd >= 0)
+				::close(fd);
+			return 1;
+		}
+
+		fds.push_back(fd);
+	}
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0U; i < clients; i++)
+		threads.push_back(std::thread(client, fds[i], i, packets));
+
+	for (unsigned int i = 0U; i < clients; i++) {
+		threads[i].join();
+		::close(fds[i]);
+	}
+
+	::printf("{\"type\":\"server\",\"clients\":%u,\"packets\":%u,\"answered\":%u,\"missing\":%u,\"stale\":%u,\"misrouted\":%u}\n",
+		clients, packets, answered.load(), missing.load(), stale.load(), misrouted.load());
+
+	return (misrouted == 0U && stale == 0U && missing <= maxMissing) ? 0 : 1;
+}
@@ -20,29 +20,24 @@
 
 #include "WAVFileReader.h"
 #include "AMBEFileWriter.h"
-#include "Version.h"
+#include "BatchScheduler.h"
+#include "Codec2Vocoder.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "Utils.h"
-#if !defined(HAVE_USB3000_P25)
-#include "imbe_vocoder.h"
-#include "IMBEFEC.h"
-#endif
-#include "codec2/codec2.h"
+#include "VAD.h"
+#include "Version.h"
 
+#include <cassert>
 #include <cstring>
 
-const uint8_t  BIT_MASK_TABLE8[]  = { 0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02U, 0x01U };
-
-#define WRITE_BIT8(p,i,b)   p[(i)>>3] = (b) ? (p[(i)>>3] | BIT_MASK_TABLE8[(i)&7]) : (p[(i)>>3] & ~BIT_MASK_TABLE8[(i)&7])
-#define READ_BIT8(p,i)     (p[(i)>>3] & BIT_MASK_TABLE8[(i)&7])
-
-
 #if defined(_WIN32) || defined(_WIN64)
 char* optarg = NULL;
 int optind = 1;
 
 int getopt(int argc, char* const argv[], const char* optstring)
 {
-	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][0] == 0))
+	if ((optind >= argc) || (argv[optind][0] != '-') || (argv[optind][1] == 0))
 		return -1;
 
 	int opt = argv[optind][1];
@@ -68,23 +63,62 @@ int getopt(int argc, char* const argv[], const char* optstring)
 #include <unistd.h>
 #endif
 
+// The frames of silence encoded before the one used in place of silent frames
+const unsigned int SILENCE_FRAMES = 4U;
+
 int main(int argc, char** argv)
 {
 	float amplitude = 1.0F;
+	WAV_CHANNEL channel = CHANNEL_MIX;
+	bool channelOK = true;
 	std::string signature;
 	AMBE_MODE mode = MODE_DSTAR;
 	bool fec = true;
+	bool container = false;
+	bool append = false;
+	bool vad = false;
+	float vadLevel = VAD_DEFAULT_LEVEL;
+	bool drop = false;
 	std::string port = "/dev/ttyUSB0";
 	unsigned int speed = 460800U;
 	bool reset = false;
+	bool timing = false;
 	bool debug = false;
+	bool batch = false;
+	unsigned int jobs = 0U;
+	bool metrics = false;
+	std::string metricsLog;
+	std::string trace;
 
 	int c;
-	while ((c = ::getopt(argc, argv, "a:df:g:m:p:rs:v")) != -1) {
+	while ((c = ::getopt(argc, argv, "Aa:bCc:D:df:g:j:L:m:p:rSs:TV:vX")) != -1) {
 		switch (c) {
+		case 'A':
+			container = true;
+			append = true;
+			break;
 		case 'a':
 			amplitude = float(::atof(optarg));
 			break;
+		case 'b':
+			batch = true;
+			break;
+		case 'C':
+			container = true;
+			break;
+		case 'c':
+			if (::strcmp(optarg, "mix") == 0)
+				channel = CHANNEL_MIX;
+			else if (::strcmp(optarg, "left") == 0)
+				channel = CHANNEL_LEFT;
+			else if (::strcmp(optarg, "right") == 0)
+				channel = CHANNEL_RIGHT;
+			else
+				channelOK = false;
+			break;
+		case 'D':
+			trace = std::string(optarg);
+			break;
 		case 'd':
 			debug = true;
 			break;
@@ -94,6 +128,12 @@ int main(int argc, char** argv)
 		case 'g':
 			signature = std::string(optarg);
 			break;
+		case 'j':
+			jobs = (unsigned int)::atoi(optarg);
+			break;
+		case 'L':
+			metricsLog = std::string(optarg);
+			break;
 		case 'm':
 			if (::strcmp(optarg, "dstar") == 0)
 				mode = MODE_DSTAR;
@@ -116,22 +156,36 @@ int main(int argc, char** argv)
 		case 'r':
 			reset = true;
 			break;
+		case 'S':
+			metrics = true;
+			break;
 		case 's':
 			speed = (unsigned int)::atoi(optarg);
 			break;
+		case 'T':
+			timing = true;
+			break;
+		case 'V':
+			vad = true;
+			vadLevel = float(::atof(optarg));
+			break;
 		case 'v':
 			printf("Version: %s\n", version);
 			return 0;
+		case 'X':
+			vad = true;
+			drop = true;
+			break;
 		case '?':
 			break;
 		default:
-			fprintf(stderr, "Usage: WAV2AMBE [-v] [-a amplitude] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-p <port>] [-s <speed>] [-r] [-d] <input> <output>\n");
+			fprintf(stderr, "Usage: WAV2AMBE [-v] [-a amplitude] [-C|-A] [-b] [-j <jobs>] [-c mix|left|right] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-p <port>] [-s <speed>] [-r] [-T] [-V <level>] [-X] [-S] [-L <file>] [-D <file>] [-d] <input> <output>\n");
 			break;
 		}
 	}
 
 	if (optind > (argc - 2)) {
-		fprintf(stderr, "Usage: WAV2AMBE [-v] [-a amplitude] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-p <port>] [-s <speed>] [-r] [-d] <input> <output>\n");
+		fprintf(stderr, "Usage: WAV2AMBE [-v] [-a amplitude] [-C|-A] [-b] [-j <jobs>] [-c mix|left|right] [-g <signature>] [-m dstar|dmr|p25|nxdn|m17-3200|m17-1600] [-f 0|1] [-p <port>] [-s <speed>] [-r] [-T] [-V <level>] [-X] [-S] [-L <file>] [-D <file>] [-d] <input> <output>\n");
 		return 1;
 	}
 
@@ -140,23 +194,80 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
-	CWAV2AMBE* WAV2AMBE = new CWAV2AMBE(signature, mode, fec, port, speed, amplitude, reset, debug, std::string(argv[argc - 2]), std::string(argv[argc - 1]));
+	if (!channelOK) {
+		::fprintf(stderr, "WAV2AMBE: unknown channel specified\n");
+		return 1;
+	}
+
+	// The gaps are only known from the timestamps of a container, which
+	// can't be written to standard output
+	if (drop && (!container || ::strcmp(argv[argc - 1], STREAM_NAME) == 0)) {
+		::fprintf(stderr, "WAV2AMBE: -X needs the output to be an AMBE container file\n");
+		return 1;
+	}
+
+	if (metrics)
+		CMetrics::enable();
+
+	if (!metricsLog.empty() && !CMetrics::startLog(metricsLog, METRICS_LOG_INTERVAL_MS))
+		return 1;
+
+	if (!trace.empty() && !CTrace::open(trace)) {
+		CMetrics::finish();
+		return 1;
+	}
+
+	if (batch) {
+		// The hardware vocoder can only do one conversion at a time
+		std::string device;
+		if (CVocoder::usesHardware(mode))
+			device = port;
+
+		CBatchScheduler scheduler(jobs);
+		if (!scheduler.add(std::string(argv[argc - 2]), ".wav", std::string(argv[argc - 1]), ".ambe", device)) {
+			CTrace::close();
+			CMetrics::finish();
+			return 1;
+		}
+
+		unsigned int failed = scheduler.run([&](const std::string& input, const std::string& output) {
+			CWAV2AMBE wav2ambe(signature, mode, fec, container, append, port, speed, amplitude, channel, vad, vadLevel, drop, reset, timing, debug, input, output);
+			return wav2ambe.run();
+		});
+
+		CTrace::close();
+		CMetrics::finish();
+
+		return (failed > 0U) ? 1 : 0;
+	}
+
+	CWAV2AMBE* WAV2AMBE = new CWAV2AMBE(signature, mode, fec, container, append, port, speed, amplitude, channel, vad, vadLevel, drop, reset, timing, debug, std::string(argv[argc - 2]), std::string(argv[argc - 1]));
 
 	int ret = WAV2AMBE->run();
 
 	delete WAV2AMBE;
 
+	CTrace::close();
+	CMetrics::finish();
+
 	return ret;
 }
 
-CWAV2AMBE::CWAV2AMBE(const std::string& signature, AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, float amplitude, bool reset, bool debug, const std::string& input, const std::string& output) :
+CWAV2AMBE::CWAV2AMBE(const std::string& signature, AMBE_MODE mode, bool fec, bool container, bool append, const std::string& port, unsigned int speed, float amplitude, WAV_CHANNEL channel, bool vad, float vadLevel, bool drop, bool reset, bool timing, bool debug, const std::string& input, const std::string& output) :
 m_signature(signature),
 m_mode(mode),
 m_fec(fec),
+m_container(container),
+m_append(append),
 m_port(port),
 m_speed(speed),
 m_amplitude(amplitude),
+m_channel(channel),
+m_vad(vad),
+m_vadLevel(vadLevel),
+m_drop(drop),
 m_reset(reset),
+m_timing(timing),
 m_debug(debug),
 m_input(input),
 m_output(output)
@@ -174,145 +285,210 @@ int CWAV2AMBE::run()
 	if (!ret)
 		return 1;
 
-	if (reader.getSampleRate() != AUDIO_SAMPLE_RATE) {
-		::fprintf(stderr, "WAV2AMBE: input file has the wrong sample rate\n");
-		reader.close();
-		return 1;
+	// Any other sample rate or number of channels is converted as it is read
+	if (reader.getSampleRate() != AUDIO_SAMPLE_RATE || reader.getChannels() > 1U) {
+		::fprintf(stderr, "WAV2AMBE: converting %u channel %uHz input to mono %uHz\n", reader.getChannels(), reader.getSampleRate(), AUDIO_SAMPLE_RATE);
+		reader.setConversion(AUDIO_SAMPLE_RATE, m_channel);
 	}
 
-	if (reader.getChannels() > 1U) {
-		::fprintf(stderr, "WAV2AMBE: input file has too many channels\n");
+	CAMBEFileWriter writer(m_output, m_signature);
+	if (m_container)
+		writer.setContainer(m_mode, m_fec, (m_mode == MODE_M17_1600) ? 40U : 20U, m_append);
+
+	ret = writer.open();
+	if (!ret) {
 		reader.close();
 		return 1;
 	}
 
-	CAMBEFileWriter writer(m_output, m_signature);
-	ret = writer.open();
+	CVocoder* vocoder = CVocoder::create(m_mode, m_fec, m_port, m_speed, m_reset, m_debug);
+	assert(vocoder != NULL);
+
+	ret = vocoder->open();
 	if (!ret) {
+		delete vocoder;
+		writer.close();
 		reader.close();
 		return 1;
 	}
 
-	if (m_mode == MODE_M17_3200 || m_mode == MODE_M17_1600) {
-		CCodec2 codec2(m_mode == MODE_M17_3200);
+	unsigned int frameLength = vocoder->getFrameLength();
+	unsigned int frameBlocks = vocoder->getFrameBlocks();
+	unsigned int frameMs     = frameBlocks * 20U;
+
+	// The frame for silence is found by encoding a few blocks of it before
+	// the vocoder is started afresh, and is then written in place of the
+	// frames of every silent span without using the vocoder
+	uint8_t silence[VOCODER_MAX_FRAME_LENGTH];
+	CVAD* vad = NULL;
+	if (m_vad) {
+		ret = encodeSilence(vocoder, silence);
+
+		// A vocoder which can't be reset is opened again, so that the
+		// speech is encoded exactly as it would be without -V
+		if (ret && !vocoder->reset()) {
+			vocoder->close();
+			delete vocoder;
+
+			vocoder = CVocoder::create(m_mode, m_fec, m_port, m_speed, m_reset, m_debug);
+			assert(vocoder != NULL);
+
+			ret = vocoder->open();
+			if (!ret) {
+				delete vocoder;
+				writer.close();
+				reader.close();
+				return 1;
+			}
+		}
 
-		unsigned int count = 0U;
+		if (!ret) {
+			vocoder->close();
+			delete vocoder;
+			writer.close();
+			reader.close();
+			return 1;
+		}
 
-		unsigned int blockSize = (m_mode == MODE_M17_3200) ? 8U : 4U;
+		vad = new CVAD(m_vadLevel);
+	}
 
-		float audioFloat[AUDIO_BLOCK_SIZE];
-		while (reader.read(audioFloat, AUDIO_BLOCK_SIZE) == AUDIO_BLOCK_SIZE) {
-			short audioInt[AUDIO_BLOCK_SIZE];
-			for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++)
-				audioInt[i] = short(audioFloat[i] * 32767.0F * m_amplitude + 0.5F);
+	// Only Codec2 has timing
+	CCodec2Vocoder* codec2 = (m_mode == MODE_M17_3200 || m_mode == MODE_M17_1600) ? static_cast<CCodec2Vocoder*>(vocoder) : NULL;
+	if (codec2 != NULL)
+		codec2->setTiming(m_timing);
 
-			if (m_debug)
-				CUtils::dump("encodeIn", (unsigned char*)audioInt, AUDIO_BLOCK_SIZE * sizeof(short));
+	unsigned int count  = 0U;
+	unsigned int frames = 0U;
+	unsigned int silent = 0U;
+	bool failed = false;
 
-			unsigned char frame[8U];
-			codec2.codec2_encode(frame, audioInt);
+	for (;;) {
+		int16_t audioInt[VOCODER_MAX_FRAME_BLOCKS * AUDIO_BLOCK_SIZE];
 
-			if (m_debug)
-				CUtils::dump("encodeOut", frame, blockSize);
+		// A frame is only silent if all of its blocks are
+		bool speech = vad == NULL;
 
-			writer.write(frame, blockSize);
+		unsigned int blocks = 0U;
+		for (; blocks < frameBlocks; blocks++) {
+			uint64_t start = CMetrics::start();
 
-			count++;
-		}
+			float audioFloat[AUDIO_BLOCK_SIZE];
+			if (reader.read(audioFloat, AUDIO_BLOCK_SIZE) != AUDIO_BLOCK_SIZE)
+				break;
 
-		printf("Encoding: %u frames (%.2fs)\n", count, float(count) / 50.0F);
-#if !defined(HAVE_USB3000_P25)
-	} else if (m_mode == MODE_P25) {
-		printf("Using open source IMBE vocoder by Pavel Yazev\n");
+			CMetrics::stop(STAGE_READ, start);
+			CMetrics::add(COUNTER_FRAMES_IN);
 
-		imbe_vocoder vocoder;
-		unsigned int count = 0U;
+			int16_t* audio = audioInt + blocks * AUDIO_BLOCK_SIZE;
+			for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++) {
+				float sample = audioFloat[i] * 32767.0F * m_amplitude;
+				if (sample > 32767.0F)
+					sample = 32767.0F;
+				else if (sample < -32768.0F)
+					sample = -32768.0F;
 
-		float audioFloat[AUDIO_BLOCK_SIZE];
-		while (reader.read(audioFloat, AUDIO_BLOCK_SIZE) == AUDIO_BLOCK_SIZE) {
-			int16_t audioInt[AUDIO_BLOCK_SIZE];
-			for (unsigned int i = 0U; i < AUDIO_BLOCK_SIZE; i++)
-				audioInt[i] = int16_t(audioFloat[i] * 3000.0F * m_amplitude + 0.5F);
+				audio[i] = int16_t(sample + 0.5F);
+			}
 
-			if (m_debug)
-				CUtils::dump("encodeIn", (unsigned char*)audioInt, AUDIO_BLOCK_SIZE * sizeof(int16_t));
+			CTrace::event(TRACE_AUDIO_IN, (uint8_t*)audio, AUDIO_BLOCK_SIZE * sizeof(int16_t));
 
-			int16_t frameInt[8U];
-			vocoder.imbe_encode(frameInt, audioInt);
+			if (vad != NULL && vad->process(audio, AUDIO_BLOCK_SIZE))
+				speech = true;
 
-			unsigned char frame[11U];
-			unsigned int offset = 0U;
+			count++;
+		}
 
-			int16_t mask = 0x0800;
-			for (unsigned int i = 0U; i < 12U; i++, mask >>= 1, offset++)
-				WRITE_BIT8(frame, offset, (frameInt[0U] & mask) != 0);
+		// Any blocks left over at the end don't make up a frame
+		if (blocks < frameBlocks)
+			break;
 
-			mask = 0x0800;
-			for (unsigned int i = 0U; i < 12U; i++, mask >>= 1, offset++)
-				WRITE_BIT8(frame, offset, (frameInt[1U] & mask) != 0);
+		uint8_t frame[VOCODER_MAX_FRAME_LENGTH];
 
-			mask = 0x0800;
-			for (unsigned int i = 0U; i < 12U; i++, mask >>= 1, offset++)
-				WRITE_BIT8(frame, offset, (frameInt[2U] & mask) != 0);
+		if (speech) {
+			uint64_t start = CMetrics::start();
 
-			mask = 0x0800;
-			for (unsigned int i = 0U; i < 12U; i++, mask >>= 1, offset++)
-				WRITE_BIT8(frame, offset, (frameInt[3U] & mask) != 0);
+			ENCODE_RESULT result = ENCODE_MORE;
+			for (unsigned int i = 0U; i < frameBlocks && result != ENCODE_ERROR; i++)
+				result = vocoder->encode(audioInt + i * AUDIO_BLOCK_SIZE, frame);
 
-			mask = 0x0400;
-			for (unsigned int i = 0U; i < 11U; i++, mask >>= 1, offset++)
-				WRITE_BIT8(frame, offset, (frameInt[4U] & mask) != 0);
+			CMetrics::stop(STAGE_VOCODER, start);
 
-			mask = 0x0400;
-			for (unsigned int i = 0U; i < 11U; i++, mask >>= 1, offset++)
-				WRITE_BIT8(frame, offset, (frameInt[5U] & mask) != 0);
+			if (result == ENCODE_ERROR) {
+				::fprintf(stderr, "WAV2AMBE: unable to encode frame %u\n", frames);
+				failed = true;
+				break;
+			}
 
-			mask = 0x0400;
-			for (unsigned int i = 0U; i < 11U; i++, mask >>= 1, offset++)
-				WRITE_BIT8(frame, offset, (frameInt[6U] & mask) != 0);
+			if (result == ENCODE_MORE)
+				continue;
+		} else {
+			::memcpy(frame, silence, frameLength);
 
-			mask = 0x0040;
-			for (unsigned int i = 0U; i < 7U; i++, mask >>= 1, offset++)
-				WRITE_BIT8(frame, offset, (frameInt[7U] & mask) != 0);
+			CMetrics::add(COUNTER_VAD_SILENT);
+			silent++;
+		}
 
-			if (m_fec) {
-				uint8_t data[18U];
+		uint32_t timestamp = frames * frameMs;
+		frames++;
 
-				CIMBEFEC fec;
-				fec.encode(data, frame);
+		if (!speech && m_drop)
+			continue;
 
-				if (m_debug)
-					CUtils::dump("encodeOut", data, 18U);
+		CTrace::event(TRACE_FRAME_OUT, frame, frameLength);
 
-				writer.write(data, 18U);
-			} else {
-				if (m_debug)
-					CUtils::dump("encodeOut", frame, 11U);
+		uint64_t start = CMetrics::start();
 
-				writer.write(frame, 11U);
-			}
+		if (m_drop)
+			writer.write(frame, frameLength, timestamp);
+		else
+			writer.write(frame, frameLength);
 
-			count++;
-		}
+		CMetrics::stop(STAGE_WRITE, start);
+		CMetrics::add(COUNTER_FRAMES_OUT);
+	}
 
-		printf("Encoding: %u frames (%.2fs)\n", count, float(count) / 50.0F);
-#endif
-	} else {
-		CDV3000SerialController controller(m_port, m_speed, m_mode, m_fec, m_amplitude, m_reset, m_debug, &reader, &writer);
-		ret = controller.open();
-		if (!ret) {
-			writer.close();
-			reader.close();
-			return 1;
-		}
+	printf("Encoding: %u frames (%.2fs)\n", count, float(count) / 50.0F);
 
-		controller.process();
+	if (vad != NULL) {
+		printf("Silence: %u of %u frames (%.1f%%) %s\n", silent, frames, (frames > 0U) ? 100.0F * float(silent) / float(frames) : 0.0F, m_drop ? "dropped" : "not encoded");
+		delete vad;
+	}
 
-		controller.close();
+	if (codec2 != NULL && m_timing) {
+		const C2_TIMING& timing = codec2->getTiming();
+		for (int i = 0; i < C2_STAGE_COUNT; i++) {
+			if (timing.calls[i] > 0U)
+				printf("Timing: %-16s %6llu calls %8.2fus/call %8.2fms total\n", CCodec2::codec2_stage_name(i), timing.calls[i], double(timing.ns[i]) / 1000.0 / double(timing.calls[i]), double(timing.ns[i]) / 1000000.0);
+		}
 	}
 
+	vocoder->close();
+	delete vocoder;
+
 	writer.close();
 	reader.close();
 
-	return 0;
+	return failed ? 1 : 0;
+}
+
+bool CWAV2AMBE::encodeSilence(CVocoder* vocoder, uint8_t* frame) const
+{
+	assert(vocoder != NULL);
+	assert(frame != NULL);
+
+	int16_t audio[AUDIO_BLOCK_SIZE];
+	::memset(audio, 0x00, AUDIO_BLOCK_SIZE * sizeof(int16_t));
+
+	// Enough for the vocoder to settle and to end on a complete frame
+	ENCODE_RESULT result = ENCODE_MORE;
+	for (unsigned int i = 0U; i < SILENCE_FRAMES * vocoder->getFrameBlocks() && result != ENCODE_ERROR; i++)
+		result = vocoder->encode(audio, frame);
+
+	if (result != ENCODE_FRAME) {
+		::fprintf(stderr, "WAV2AMBE: unable to encode a frame of silence\n");
+		return false;
+	}
+
+	return true;
 }
@@ -19,14 +19,15 @@
 #if !defined(WAV2AMBE_H)
 #define	WAV2AMBE_H
 
-#include "DV3000SerialController.h"
+#include "Vocoder.h"
+#include "WAVFileReader.h"
 
 #include <string>
 
 class CWAV2AMBE
 {
 public:
-	CWAV2AMBE(const std::string& sugnature, AMBE_MODE mode, bool fec, const std::string& port, unsigned int speed, float amplitude, bool reset, bool debug, const std::string& input, const std::string& output);
+	CWAV2AMBE(const std::string& sugnature, AMBE_MODE mode, bool fec, bool container, bool append, const std::string& port, unsigned int speed, float amplitude, WAV_CHANNEL channel, bool vad, float vadLevel, bool drop, bool reset, bool timing, bool debug, const std::string& input, const std::string& output);
 	~CWAV2AMBE();
 
 	int run();
@@ -35,13 +36,22 @@ private:
 	std::string  m_signature;
 	AMBE_MODE    m_mode;
 	bool         m_fec;
+	bool         m_container;
+	bool         m_append;
 	std::string  m_port;
 	unsigned int m_speed;
 	float        m_amplitude;
+	WAV_CHANNEL  m_channel;
+	bool         m_vad;
+	float        m_vadLevel;
+	bool         m_drop;
 	bool         m_reset;
+	bool         m_timing;
 	bool         m_debug;
 	std::string  m_input;
 	std::string  m_output;
+
+	bool encodeSilence(CVocoder* vocoder, uint8_t* frame) const;
 };
 
 #endif